@@ -0,0 +1,45 @@
+#ifndef COUNTING_ENGINE_H
+#define COUNTING_ENGINE_H
+
+#include <cstdint>
+#include <random>
+
+/**
+ * Random engine adapter that counts its draws, for the RNG draws per sample counters.
+ * The count is per thread, so concurrent benchmarks do not share it.
+ */
+template <typename Engine = std::mt19937>
+class CountingEngine {
+public:
+	using result_type = typename Engine::result_type;
+
+	explicit CountingEngine(result_type seed = Engine::default_seed) :
+		m_engine {seed}
+	{}
+
+	static constexpr result_type min() {
+		return Engine::min();
+	}
+
+	static constexpr result_type max() {
+		return Engine::max();
+	}
+
+	result_type operator()() {
+		s_draws++;
+		return m_engine();
+	}
+
+	/**
+	 * @return Draws by all engines of this type on the calling thread.
+	 */
+	static std::int64_t getDraws() {
+		return s_draws;
+	}
+
+private:
+	Engine m_engine;
+	static inline thread_local std::int64_t s_draws {0};
+};
+
+#endif
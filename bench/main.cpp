@@ -0,0 +1,365 @@
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include "hwy/highway.h"
+
+#include "geometry/PolygonBatch.h"
+#include "simulation/Kernels.h"
+#include "simulation/Layouts.h"
+#include "simulation/SampleSource.h"
+#include "simulation/SlidingWindowSampleSource.h"
+#include "simulation/SobolSampleSource.h"
+#include "harness/SimulationAdrian1.h"
+#include "harness/SimulationConditionalTriangle.h"
+#include "harness/SimulationEugene1.h"
+#include "harness/SimulationEugene2.h"
+#include "harness/SimulationEugene3.h"
+#include "harness/SimulationEugene4.h"
+#include "harness/SimulationEugene5.h"
+#include "harness/SimulationSampled.h"
+#include "harness/SimulationVarianceReduced.h"
+#include "CountingEngine.h"
+
+/*
+ * Microbenchmarks of the simulations, their kernels and their sample sources.
+ * Names are "<group>/<name>/<float type>" with the arguments appended by Google Benchmark:
+ *   simulation/...: ngon, runs per run() call (the harness chunk size)
+ *   kernel/...:     ngon
+ *   source/...:     coordinates per sample
+ *   geometry/...:   ngon, threads
+ * Every benchmark reports, per sample: time_per_sample, samples_per_second_per_core (benchmarks
+ * run on one thread), bytes_per_sample (coordinate bytes written and read, see below) and
+ * rng_draws_per_sample (engine calls, counted by CountingEngine).  Use --benchmark_out=<file>
+ * --benchmark_out_format=json to keep the results for comparing commits.
+ */
+
+namespace {
+
+using Engine = CountingEngine<std::mt19937>;
+
+constexpr int kNgons[] {3, 5, 8};
+constexpr int kBlockSizes[] {1 << 12, 1 << 16, 1 << 20};
+// polygons in the kernel benchmarks' buffer, small enough to stay in L1/L2
+constexpr int kKernelPolygons {1 << 10};
+// polygons in the geometry benchmarks' columns, enough to split over threads
+constexpr int kGeometryPolygons {1 << 18};
+
+template <typename FloatType>
+const char* typeName() {
+	return sizeof(FloatType) == sizeof(float) ? "float" : "double";
+}
+
+/**
+ * Sets the per-sample counters.
+ * @param samples Samples over all iterations.
+ * @param bytesPerSample Coordinate bytes written and read per sample.
+ * @param draws Engine draws over all iterations.
+ */
+void setCounters(benchmark::State& state, std::int64_t samples, double bytesPerSample, std::int64_t draws) {
+	state.SetBytesProcessed(static_cast<std::int64_t>(samples * bytesPerSample));
+	state.counters["time_per_sample"] = benchmark::Counter(static_cast<double>(samples), benchmark::Counter::kIsRate | benchmark::Counter::kInvert);
+	state.counters["samples_per_second_per_core"] = benchmark::Counter(static_cast<double>(samples), benchmark::Counter::kIsRate);
+	state.counters["bytes_per_sample"] = bytesPerSample;
+	state.counters["rng_draws_per_sample"] = samples > 0 ? static_cast<double>(draws) / samples : 0.0;
+}
+
+/*
+ * Coordinate traffic per sample, in coordinates of a 2 * ngon point:
+ * - per sample layouts: the source writes the point, the kernel reads it (2),
+ * - row and column layouts: the source writes it, the layout copies it, the kernel reads it (4),
+ * - sliding windows: the source writes the new coordinates twice (the mirror), the kernel reads the window.
+ */
+double perSampleTraffic(int dimension) {
+	return 2.0 * dimension;
+}
+
+double copyLayoutTraffic(int dimension) {
+	return 4.0 * dimension;
+}
+
+double slidingWindowTraffic(int dimension, int stride) {
+	return 2.0 * stride + dimension;
+}
+
+/**
+ * Runs a simulation's run() repeatedly.
+ * @param makeSimulation Callable (int runs, int ngon) returning the simulation.
+ * @param traffic Coordinates written and read per sample, for an ngon.
+ */
+template <typename FloatType, typename MakeSimulation, typename Traffic>
+void benchSimulation(benchmark::State& state, MakeSimulation makeSimulation, Traffic traffic) {
+	const int ngon {static_cast<int>(state.range(0))};
+	const int runs {static_cast<int>(state.range(1))};
+	auto sim = makeSimulation(runs, ngon);
+	sim->prepare();
+
+	const std::int64_t drawsBefore {Engine::getDraws()};
+	for (auto _ : state) {
+		sim->run();
+		benchmark::DoNotOptimize(sim->getSumOfRatios());
+	}
+	const std::int64_t samples {static_cast<std::int64_t>(state.iterations()) * runs};
+	setCounters(state, samples, traffic(ngon) * sizeof(FloatType), Engine::getDraws() - drawsBefore);
+}
+
+/**
+ * Evaluates a kernel on kKernelPolygons independent polygons, interleaved as the sources hand them out.
+ */
+template <typename FloatType, typename Kernel>
+void benchKernel(benchmark::State& state) {
+	const int ngon {static_cast<int>(state.range(0))};
+	const int dimension {Kernel::dimension(ngon)};
+	simulation::UniformSampleSource<FloatType> source {dimension};
+	std::vector<FloatType> coords(static_cast<std::size_t>(kKernelPolygons) * dimension);
+	for (int p {0}; p < kKernelPolygons; p++) {
+		const FloatType* point {source.next()};
+		std::copy(point, point + dimension, coords.begin() + static_cast<std::ptrdiff_t>(p) * dimension);
+	}
+
+	const simulation::ScalarOps<FloatType> ops {};
+	for (auto _ : state) {
+		FloatType sum {0};
+		for (int p {0}; p < kKernelPolygons; p++) {
+			const FloatType* polygon {coords.data() + static_cast<std::ptrdiff_t>(p) * dimension};
+			sum += Kernel::evaluate(ops, polygon, polygon + 1, 2, ngon);
+		}
+		benchmark::DoNotOptimize(sum);
+	}
+	setCounters(state, static_cast<std::int64_t>(state.iterations()) * kKernelPolygons, static_cast<double>(dimension) * sizeof(FloatType), 0);
+}
+
+/**
+ * Evaluates a kernel on Highway vectors, one independent polygon per lane (gathered, as eugene5
+ * does for strides above 1).
+ */
+template <typename FloatType, typename Kernel>
+void benchKernelSimd(benchmark::State& state) {
+	namespace hn = hwy::HWY_NAMESPACE;
+	using D = hn::ScalableTag<FloatType>;
+	using Ops = simulation::HighwayOps<D, false>;
+	using IndexType = hn::TFromD<typename Ops::IndexTag>;
+	const D d;
+	const typename Ops::IndexTag di;
+	const int lanes {static_cast<int>(hn::Lanes(d))};
+
+	const int ngon {static_cast<int>(state.range(0))};
+	const int dimension {Kernel::dimension(ngon)};
+	simulation::UniformSampleSource<FloatType> source {dimension};
+	std::vector<FloatType> coords(static_cast<std::size_t>(kKernelPolygons) * dimension);
+	for (int p {0}; p < kKernelPolygons; p++) {
+		const FloatType* point {source.next()};
+		std::copy(point, point + dimension, coords.begin() + static_cast<std::ptrdiff_t>(p) * dimension);
+	}
+	std::vector<IndexType> laneOffsets(lanes);
+	for (int j {0}; j < lanes; j++) {
+		laneOffsets[j] = static_cast<IndexType>(j * dimension);
+	}
+	const Ops ops {d, hn::LoadU(di, laneOffsets.data())};
+
+	const int blocks {kKernelPolygons / lanes};
+	for (auto _ : state) {
+		auto sum = hn::Zero(d);
+		for (int b {0}; b < blocks; b++) {
+			const FloatType* block {coords.data() + static_cast<std::ptrdiff_t>(b) * lanes * dimension};
+			sum = hn::Add(sum, Kernel::evaluate(ops, block, block + 1, 2, ngon));
+		}
+		benchmark::DoNotOptimize(hn::GetLane(hn::SumOfLanes(d, sum)));
+	}
+	setCounters(state, static_cast<std::int64_t>(state.iterations()) * blocks * lanes, static_cast<double>(dimension) * sizeof(FloatType), 0);
+}
+
+/**
+ * Draws points from a sample source.
+ * @param makeSource Callable (int dimension) returning the source.
+ * @param traffic Coordinates written per sample, for a dimension.
+ */
+template <typename FloatType, typename MakeSource, typename Traffic>
+void benchSource(benchmark::State& state, MakeSource makeSource, Traffic traffic) {
+	const int dimension {static_cast<int>(state.range(0))};
+	auto source = makeSource(dimension);
+
+	const std::int64_t drawsBefore {Engine::getDraws()};
+	for (auto _ : state) {
+		benchmark::DoNotOptimize(source.next());
+	}
+	setCounters(state, static_cast<std::int64_t>(state.iterations()), traffic(dimension) * sizeof(FloatType), Engine::getDraws() - drawsBefore);
+}
+
+/**
+ * Runs the batch geometry API over kGeometryPolygons caller-owned SoA polygons.
+ * @param StoreResults Write every polygon's area, ratio and bounding box, or only sum the ratios.
+ */
+template <typename FloatType, bool StoreResults>
+void benchGeometry(benchmark::State& state) {
+	const int ngon {static_cast<int>(state.range(0))};
+	const int threads {static_cast<int>(state.range(1))};
+	const std::size_t vertices {static_cast<std::size_t>(kGeometryPolygons) * ngon};
+	std::vector<FloatType> xs(vertices);
+	std::vector<FloatType> ys(vertices);
+	simulation::UniformSampleSource<FloatType> source {2};
+	for (std::size_t v {0}; v < vertices; v++) {
+		const FloatType* point {source.next()};
+		xs[v] = point[0];
+		ys[v] = point[1];
+	}
+	const geometry::PolygonColumns<FloatType> polygons {xs, ys, {}, ngon};
+
+	std::vector<FloatType> areas(StoreResults ? kGeometryPolygons : 0);
+	std::vector<FloatType> ratios(areas.size());
+	std::vector<FloatType> minXs(areas.size());
+	std::vector<FloatType> minYs(areas.size());
+	std::vector<FloatType> maxXs(areas.size());
+	std::vector<FloatType> maxYs(areas.size());
+	const geometry::PolygonResults<FloatType> results {areas, ratios, minXs, minYs, maxXs, maxYs};
+
+	for (auto _ : state) {
+		if constexpr (StoreResults) {
+			benchmark::DoNotOptimize(geometry::computePolygons(polygons, results, threads));
+			benchmark::ClobberMemory();
+		} else {
+			benchmark::DoNotOptimize(geometry::sumRatios(polygons, threads));
+		}
+	}
+	// 2 * ngon coordinates read, plus 6 values written per polygon
+	const double bytesPerSample {(2.0 * ngon + (StoreResults ? 6.0 : 0.0)) * sizeof(FloatType)};
+	setCounters(state, static_cast<std::int64_t>(state.iterations()) * kGeometryPolygons, bytesPerSample, 0);
+}
+
+template <typename FloatType>
+void registerSimulations() {
+	using Ptr = std::unique_ptr<simulation::ISimulation<FloatType>>;
+	const std::string suffix {std::string {"/"} + typeName<FloatType>()};
+	struct Entry {
+		const char* name;
+		std::function<Ptr(int, int)> make;
+		std::function<double(int)> traffic;
+		bool trianglesOnly;
+	};
+	const auto perSample = [](int ngon) { return perSampleTraffic(2 * ngon); };
+	const std::vector<Entry> entries {
+		{"adrian1", [](int runs, int ngon) -> Ptr { return std::make_unique<SimulationAdrian1<FloatType, Engine>>(runs, ngon); }, perSample, false},
+		{"eugene1", [](int runs, int ngon) -> Ptr { return std::make_unique<SimulationEugene1<FloatType, Engine>>(runs, ngon); }, perSample, false},
+		{"eugene2", [](int runs, int ngon) -> Ptr { return std::make_unique<SimulationEugene2<FloatType, Engine>>(runs, ngon); },
+			[](int ngon) { return copyLayoutTraffic(2 * ngon); }, false},
+		{"eugene3", [](int runs, int ngon) -> Ptr { return std::make_unique<SimulationEugene3<FloatType, Engine>>(runs, ngon); },
+			[](int ngon) { return copyLayoutTraffic(2 * ngon); }, false},
+		{"eugene4", [](int runs, int ngon) -> Ptr { return std::make_unique<SimulationEugene4<FloatType, Engine>>(runs, ngon); },
+			[](int ngon) { return slidingWindowTraffic(2 * ngon, 1); }, true},
+		{"eugene5", [](int runs, int ngon) -> Ptr { return std::make_unique<SimulationEugene5<FloatType, Engine>>(runs, ngon); },
+			[](int ngon) { return slidingWindowTraffic(2 * ngon, 1); }, false},
+		{"mc", [](int runs, int ngon) -> Ptr {
+			return std::make_unique<SimulationSampled<FloatType, simulation::UniformSampleSource<FloatType, Engine>>>(runs, ngon);
+		}, perSample, false},
+		{"sobol", [](int runs, int ngon) -> Ptr {
+			return std::make_unique<SimulationSampled<FloatType, simulation::SobolSampleSource<FloatType>>>(runs, ngon);
+		}, perSample, false},
+		{"vr", [](int runs, int ngon) -> Ptr { return std::make_unique<SimulationVarianceReduced<FloatType, Engine>>(runs, ngon); }, perSample, false},
+		{"conditional", [](int runs, int ngon) -> Ptr {
+			return std::make_unique<SimulationConditionalTriangle<FloatType, simulation::UniformSampleSource<FloatType, Engine>>>(runs, ngon);
+		}, [](int) { return perSampleTraffic(4); }, true},
+	};
+
+	for (const auto& entry : entries) {
+		auto* bench = benchmark::RegisterBenchmark(("simulation/" + std::string {entry.name} + suffix).c_str(),
+			[make = entry.make, traffic = entry.traffic](benchmark::State& state) { benchSimulation<FloatType>(state, make, traffic); });
+		for (int ngon : kNgons) {
+			if (entry.trianglesOnly && ngon != 3) {
+				continue;
+			}
+			for (int blockSize : kBlockSizes) {
+				bench->Args({ngon, blockSize});
+			}
+		}
+		bench->ArgNames({"ngon", "runs"});
+	}
+}
+
+template <typename FloatType>
+void registerKernels() {
+	const std::string suffix {std::string {"/"} + typeName<FloatType>()};
+	auto* shoelace = benchmark::RegisterBenchmark(("kernel/shoelace" + suffix).c_str(), benchKernel<FloatType, simulation::ShoelaceKernel>);
+	auto* shoelaceSimd = benchmark::RegisterBenchmark(("kernel/shoelace_simd" + suffix).c_str(), benchKernelSimd<FloatType, simulation::ShoelaceKernel>);
+	for (int ngon : kNgons) {
+		shoelace->Arg(ngon);
+		shoelaceSimd->Arg(ngon);
+	}
+	auto* triangle = benchmark::RegisterBenchmark(("kernel/triangle" + suffix).c_str(), benchKernel<FloatType, simulation::TriangleKernel>);
+	auto* triangleSimd = benchmark::RegisterBenchmark(("kernel/triangle_simd" + suffix).c_str(), benchKernelSimd<FloatType, simulation::TriangleKernel>);
+	auto* conditional = benchmark::RegisterBenchmark(("kernel/conditional" + suffix).c_str(), benchKernel<FloatType, simulation::ConditionalTriangleKernel>);
+	for (auto* bench : {triangle, triangleSimd, conditional}) {
+		bench->Arg(3);
+	}
+	for (auto* bench : {shoelace, shoelaceSimd, triangle, triangleSimd, conditional}) {
+		bench->ArgName("ngon");
+	}
+}
+
+template <typename FloatType>
+void registerSources() {
+	const std::string suffix {std::string {"/"} + typeName<FloatType>()};
+	auto* uniform = benchmark::RegisterBenchmark(("source/uniform" + suffix).c_str(), [](benchmark::State& state) {
+		benchSource<FloatType>(state, [](int dimension) { return simulation::UniformSampleSource<FloatType, Engine> {dimension}; },
+			[](int dimension) { return static_cast<double>(dimension); });
+	});
+	auto* slidingWindow = benchmark::RegisterBenchmark(("source/sliding_window" + suffix).c_str(), [](benchmark::State& state) {
+		benchSource<FloatType>(state, [](int dimension) { return simulation::SlidingWindowSampleSource<FloatType, Engine> {dimension}; },
+			[](int) { return 2.0; });
+	});
+	auto* sobol = benchmark::RegisterBenchmark(("source/sobol" + suffix).c_str(), [](benchmark::State& state) {
+		benchSource<FloatType>(state, [](int dimension) { return simulation::SobolSampleSource<FloatType> {dimension}; },
+			[](int dimension) { return static_cast<double>(dimension); });
+	});
+	for (auto* bench : {uniform, slidingWindow, sobol}) {
+		for (int ngon : kNgons) {
+			bench->Arg(2 * ngon);
+		}
+		bench->ArgName("dimension");
+	}
+}
+
+template <typename FloatType>
+void registerGeometry() {
+	const std::string suffix {std::string {"/"} + typeName<FloatType>()};
+	auto* compute = benchmark::RegisterBenchmark(("geometry/compute" + suffix).c_str(), benchGeometry<FloatType, true>);
+	auto* sum = benchmark::RegisterBenchmark(("geometry/sum_ratios" + suffix).c_str(), benchGeometry<FloatType, false>);
+	for (auto* bench : {compute, sum}) {
+		for (int ngon : kNgons) {
+			for (int threads : {1, 4}) {
+				bench->Args({ngon, threads});
+			}
+		}
+		bench->ArgNames({"ngon", "threads"})->UseRealTime();
+	}
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+	registerSimulations<double>();
+	registerSimulations<float>();
+	registerKernels<double>();
+	registerKernels<float>();
+	registerSources<double>();
+	registerSources<float>();
+	registerGeometry<double>();
+	registerGeometry<float>();
+
+	benchmark::AddCustomContext("simd_lanes_double", std::to_string(simulation::SimdLaneLayout<double>::lanes()));
+	benchmark::AddCustomContext("simd_lanes_float", std::to_string(simulation::SimdLaneLayout<float>::lanes()));
+
+	benchmark::Initialize(&argc, argv);
+	if (benchmark::ReportUnrecognizedArguments(argc, argv)) {
+		return 1;
+	}
+	benchmark::RunSpecifiedBenchmarks();
+	benchmark::Shutdown();
+	return 0;
+}
@@ -0,0 +1,41 @@
+#include <cstdlib>
+#include <new>
+
+#include "AllocationCounter.h"
+
+// Replacements of the global allocation functions; the array and nothrow forms of the standard
+// library forward to these.
+
+void* operator new(std::size_t size) {
+	allocation_counter::record(size);
+	if (void* p = std::malloc(size ? size : 1)) {
+		return p;
+	}
+	throw std::bad_alloc {};
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment) {
+	allocation_counter::record(size);
+	const std::size_t align {static_cast<std::size_t>(alignment)};
+	// aligned_alloc wants a nonzero multiple of the alignment
+	if (void* p = std::aligned_alloc(align, ((size ? size : 1) + align - 1) / align * align)) {
+		return p;
+	}
+	throw std::bad_alloc {};
+}
+
+void operator delete(void* p) noexcept {
+	std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept {
+	std::free(p);
+}
+
+void operator delete(void* p, std::align_val_t) noexcept {
+	std::free(p);
+}
+
+void operator delete(void* p, std::size_t, std::align_val_t) noexcept {
+	std::free(p);
+}
@@ -0,0 +1,131 @@
+#ifndef ALLOCATION_COUNTER_H
+#define ALLOCATION_COUNTER_H
+
+#include <atomic>
+#include <cstdint>
+#include <iostream>
+#include <memory_resource>
+
+/**
+ * Counts the allocations of the harness per phase, for `--count-allocations`: the global operator
+ * new is replaced (AllocationCounter.cpp) and, once enabled, charges every allocation to the calling
+ * thread's current phase, and so does the CountingResource over each worker's arena, which sees the
+ * allocations an arena serves without going to the heap.  The point is to show that the "run"
+ * phase, the simulations' run() calls, allocates nothing; setup belongs in "construct" and "prepare".
+ */
+namespace allocation_counter {
+
+enum class Phase { Other, Construct, Prepare, Run };
+constexpr int kPhaseCount {4};
+
+inline const char* getPhaseName(Phase phase) {
+	static constexpr const char* names[kPhaseCount] {"other", "construct", "prepare", "run"};
+	return names[static_cast<int>(phase)];
+}
+
+struct alignas(64) PhaseCounts {
+	std::atomic<std::int64_t> allocations {0};
+	std::atomic<std::int64_t> bytes {0};
+};
+
+inline std::atomic<bool> enabled {false};
+inline PhaseCounts counts[kPhaseCount] {};
+inline thread_local Phase currentPhase {Phase::Other};
+// set while a CountingResource forwards upstream, so that its refills from the heap are not counted twice
+inline thread_local bool forwarding {false};
+
+/**
+ * Called by the replaced operator new and by CountingResource.
+ */
+inline void record(std::size_t size) {
+	if (enabled.load(std::memory_order_relaxed) && !forwarding) {
+		auto& phase = counts[static_cast<int>(currentPhase)];
+		phase.allocations.fetch_add(1, std::memory_order_relaxed);
+		phase.bytes.fetch_add(static_cast<std::int64_t>(size), std::memory_order_relaxed);
+	}
+}
+
+inline void enable() {
+	for (auto& phase : counts) {
+		phase.allocations.store(0, std::memory_order_relaxed);
+		phase.bytes.store(0, std::memory_order_relaxed);
+	}
+	enabled.store(true, std::memory_order_relaxed);
+}
+
+/**
+ * Charges the calling thread's allocations to a phase until the end of the scope.
+ */
+class PhaseScope {
+public:
+	explicit PhaseScope(Phase phase) :
+		m_previous {currentPhase}
+	{
+		currentPhase = phase;
+	}
+
+	~PhaseScope() {
+		currentPhase = m_previous;
+	}
+
+	PhaseScope(const PhaseScope&) = delete;
+	PhaseScope& operator=(const PhaseScope&) = delete;
+
+private:
+	Phase m_previous;
+};
+
+/**
+ * Memory resource that counts the allocations made from it and forwards them upstream, e.g. to a
+ * worker's pool, which serves most of them from blocks it already holds.
+ */
+class CountingResource : public std::pmr::memory_resource {
+public:
+	explicit CountingResource(std::pmr::memory_resource* upstream) :
+		m_upstream {upstream}
+	{}
+
+private:
+	std::pmr::memory_resource* m_upstream;
+
+	void* do_allocate(std::size_t bytes, std::size_t alignment) override {
+		record(bytes);
+		const bool previous {forwarding};
+		forwarding = true;
+		try {
+			void* p {m_upstream->allocate(bytes, alignment)};
+			forwarding = previous;
+			return p;
+		} catch (...) {
+			forwarding = previous;
+			throw;
+		}
+	}
+
+	void do_deallocate(void* p, std::size_t bytes, std::size_t alignment) override {
+		m_upstream->deallocate(p, bytes, alignment);
+	}
+
+	bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+		return this == &other;
+	}
+};
+
+/**
+ * @param runCalls Number of run() calls, to report allocations per call.
+ */
+inline void printReport(std::ostream& out, std::int64_t runCalls) {
+	out << "Allocations:";
+	for (int p {0}; p < kPhaseCount; p++) {
+		out << " " << getPhaseName(static_cast<Phase>(p)) << " " << counts[p].allocations.load(std::memory_order_relaxed)
+			<< " (" << counts[p].bytes.load(std::memory_order_relaxed) << " bytes)" << (p + 1 < kPhaseCount ? "," : "");
+	}
+	out << std::endl;
+	const std::int64_t runAllocations {counts[static_cast<int>(Phase::Run)].allocations.load(std::memory_order_relaxed)};
+	out << "Allocations per run() call: " << (runCalls > 0 ? static_cast<double>(runAllocations) / runCalls : 0.0)
+		<< (runAllocations == 0 ? " (hot loop allocation-free)" : "") << std::endl;
+}
+
+} // namespace allocation_counter
+
+#endif
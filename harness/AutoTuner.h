@@ -0,0 +1,320 @@
+#ifndef AUTO_TUNER_H
+#define AUTO_TUNER_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <elf.h>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <latch>
+#include <link.h>
+#include <memory>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <sys/stat.h>
+#include <thread>
+#include <vector>
+
+#include "common/Concurrency.h"
+#include "common/Timer.h"
+#include "simulation/Estimators.h"
+#include "simulation/ISimulation.h"
+
+/**
+ * Auto-tuner for `--simulation auto`: runs short trials of every eligible simulation, then sweeps the
+ * thread count and chunk size of the best one, and caches the result per CPU model and binary.
+ *
+ * Simulations are ranked on time to a given precision, variance per sample / samples per second,
+ * rather than on raw throughput, since they do not all have the same variance (conditional, vr) or
+ * independent samples (the sliding windows of eugene4 and eugene5).  The variance comes from batch
+ * means: the spread of the chunk averages, times the chunk size, which also accounts for the
+ * correlation between consecutive samples.
+ */
+namespace autotune {
+
+struct Configuration {
+	std::string simulation {};
+	int threads {1};
+	int chunk {0};
+	double variance {0}; // per-sample variance of the simulation's estimate
+	double samplesPerSecond {0};
+};
+
+struct TrialResult {
+	double samplesPerSecond {0};
+	double variance {0};
+
+	/**
+	 * @return Seconds to reach a standard error of 1 (scale by 1 / precision^2 for any other).
+	 */
+	double getTimeToPrecision() const {
+		return variance / samplesPerSecond;
+	}
+};
+
+// each trial aims at this much wall time, with at least kMinChunksPerThread chunks for the batch means
+constexpr double kTrialSeconds {0.2};
+constexpr int kMinChunksPerThread {32};
+// simulations are compared with small chunks, which give many batches for the variance, but still
+// far longer than the correlation length of the sliding windows
+constexpr int kDefaultChunk {1 << 12};
+constexpr int kChunks[] {1 << 12, 1 << 14, 1 << 16, 1 << 18, 1 << 20};
+
+/**
+ * @return The CPU model name from /proc/cpuinfo, or "unknown".
+ */
+inline std::string getCpuModel() {
+	std::ifstream cpuinfo("/proc/cpuinfo");
+	std::string line;
+	while (std::getline(cpuinfo, line)) {
+		if (line.rfind("model name", 0) == 0 || line.rfind("Model", 0) == 0) {
+			const auto colon = line.find(':');
+			if (colon != std::string::npos) {
+				return line.substr(line.find_first_not_of(' ', colon + 1));
+			}
+		}
+	}
+	return "unknown";
+}
+
+/**
+ * @return The GNU build ID of the running executable as hex, or its size and modification time if
+ *         it was linked without one.
+ */
+inline std::string getBuildId() {
+	std::string buildId {};
+	dl_iterate_phdr([](dl_phdr_info* info, size_t, void* data) {
+		auto& id = *static_cast<std::string*>(data);
+		for (int i {0}; i < info->dlpi_phnum && id.empty(); i++) {
+			const auto& header = info->dlpi_phdr[i];
+			if (header.p_type != PT_NOTE) {
+				continue;
+			}
+			const char* note {reinterpret_cast<const char*>(info->dlpi_addr + header.p_vaddr)};
+			const char* end {note + header.p_memsz};
+			while (note + sizeof(ElfW(Nhdr)) <= end) {
+				const auto* nhdr = reinterpret_cast<const ElfW(Nhdr)*>(note);
+				const char* name {note + sizeof(ElfW(Nhdr))};
+				const auto* desc = reinterpret_cast<const unsigned char*>(name + ((nhdr->n_namesz + 3) & ~3u));
+				if (nhdr->n_type == NT_GNU_BUILD_ID && nhdr->n_namesz == 4 && std::memcmp(name, "GNU", 4) == 0) {
+					char hex[3];
+					for (unsigned j {0}; j < nhdr->n_descsz; j++) {
+						std::snprintf(hex, sizeof(hex), "%02x", desc[j]);
+						id += hex;
+					}
+					break;
+				}
+				note = reinterpret_cast<const char*>(desc) + ((nhdr->n_descsz + 3) & ~3u);
+			}
+		}
+		return 1; // the executable is always the first object
+	}, &buildId);
+
+	if (buildId.empty()) {
+		struct stat status {};
+		if (stat("/proc/self/exe", &status) == 0) {
+			buildId = "exe-" + std::to_string(status.st_size) + "-" + std::to_string(status.st_mtime);
+		}
+	}
+	return buildId;
+}
+
+/**
+ * @return The cache file, under $XDG_CACHE_HOME or ~/.cache.
+ */
+inline std::filesystem::path getCachePath() {
+	std::filesystem::path base {};
+	if (const char* xdg = std::getenv("XDG_CACHE_HOME"); xdg && *xdg) {
+		base = xdg;
+	} else if (const char* home = std::getenv("HOME"); home && *home) {
+		base = std::filesystem::path {home} / ".cache";
+	} else {
+		base = std::filesystem::temp_directory_path();
+	}
+	return base / "axis_aligned_bb_sim" / "autotune.tsv";
+}
+
+/**
+ * Everything a tuning decision depends on besides the simulations themselves.
+ */
+inline std::string makeCacheKey(int ngon, int maxThreads, const std::string& estimatorName) {
+	std::ostringstream key;
+	key << "cpu=" << getCpuModel() << ";build=" << getBuildId() << ";ngon=" << ngon << ";threads=" << maxThreads << ";estimator=" << estimatorName;
+	return key.str();
+}
+
+/**
+ * Cache lines are "key \t simulation \t threads \t chunk \t variance \t samplesPerSecond".
+ * @return The cached configuration for the key, if any.
+ */
+inline std::optional<Configuration> loadCached(const std::string& key) {
+	std::ifstream file(getCachePath());
+	std::string line;
+	while (std::getline(file, line)) {
+		std::istringstream fields(line);
+		std::string lineKey;
+		Configuration configuration {};
+		if (std::getline(fields, lineKey, '\t') && lineKey == key
+				&& std::getline(fields, configuration.simulation, '\t')
+				&& fields >> configuration.threads >> configuration.chunk >> configuration.variance >> configuration.samplesPerSecond) {
+			return configuration;
+		}
+	}
+	return std::nullopt;
+}
+
+/**
+ * Adds (or replaces) the configuration for the key; the file is replaced atomically.
+ * @return True if the cache was written.
+ */
+inline bool storeCached(const std::string& key, const Configuration& configuration) {
+	const auto path = getCachePath();
+	std::error_code error {};
+	std::filesystem::create_directories(path.parent_path(), error);
+
+	std::vector<std::string> lines {};
+	{
+		std::ifstream file(path);
+		std::string line;
+		while (std::getline(file, line)) {
+			if (line.rfind(key + '\t', 0) != 0) {
+				lines.push_back(line);
+			}
+		}
+	}
+	std::ostringstream entry;
+	entry << key << '\t' << configuration.simulation << '\t' << configuration.threads << '\t' << configuration.chunk
+		<< '\t' << configuration.variance << '\t' << configuration.samplesPerSecond;
+	lines.push_back(entry.str());
+
+	auto temporary = path;
+	temporary += ".tmp" + std::to_string(getpid());
+	{
+		std::ofstream file(temporary);
+		for (const auto& line : lines) {
+			file << line << '\n';
+		}
+		if (!file) {
+			return false;
+		}
+	}
+	std::filesystem::rename(temporary, path, error);
+	return !error;
+}
+
+/**
+ * Runs one trial: each thread runs its simulation chunksPerThread times, a chunk of samples each.
+ * @param makeSimulation Callable (const std::string& name, int runs) returning the simulation.
+ */
+template <typename MakeSimulation>
+TrialResult runTrial(const std::string& simulationName, int threads, int chunk, int chunksPerThread,
+		const std::vector<int>& workerCpus, MakeSimulation& makeSimulation) {
+	std::vector<std::vector<double>> chunkMeans(threads);
+	std::latch prepared {threads};
+	std::latch start {1};
+	std::vector<std::thread> workers {};
+	for (int i {0}; i < threads; i++) {
+		workers.emplace_back([&, i]() {
+			if (!workerCpus.empty()) {
+				Concurrency::pin_to_core(workerCpus[i % workerCpus.size()]);
+			}
+			auto sim = makeSimulation(simulationName, chunk);
+			sim->prepare();
+			chunkMeans[i].reserve(chunksPerThread);
+			prepared.count_down();
+			start.wait();
+			for (int c {0}; c < chunksPerThread; c++) {
+				sim->run();
+				chunkMeans[i].push_back(sim->getSumOfRatios() / chunk);
+			}
+		});
+	}
+	prepared.wait();
+	Timer timer {};
+	start.count_down();
+	for (auto& worker : workers) {
+		worker.join();
+	}
+	timer.stop();
+
+	simulation::RunningStats<double> stats {};
+	for (const auto& means : chunkMeans) {
+		for (double mean : means) {
+			stats.add(mean);
+		}
+	}
+	TrialResult result {};
+	result.samplesPerSecond = static_cast<double>(threads) * chunksPerThread * chunk / timer.getTimeElapsed().count();
+	result.variance = stats.getVariance() * chunk;
+	return result;
+}
+
+/**
+ * @return Chunks per thread for a trial of about kTrialSeconds, from a single-threaded samples per second estimate.
+ */
+inline int getChunksPerThread(double samplesPerSecond, int chunk) {
+	return std::max(kMinChunksPerThread, static_cast<int>(std::ceil(kTrialSeconds * samplesPerSecond / chunk)));
+}
+
+/**
+ * Picks the simulation with the lowest time to precision at full thread count, then the thread
+ * count and chunk size with the highest throughput for it.
+ * @param candidates The simulations that support the requested ngon.
+ * @param maxThreads The most worker threads to try.
+ * @param workerCpus CPUs to pin the trial threads to, as for the real run.
+ * @param makeSimulation Callable (const std::string& name, int runs) returning the simulation.
+ */
+template <typename MakeSimulation>
+Configuration tune(const std::vector<std::string>& candidates, int maxThreads, const std::vector<int>& workerCpus,
+		MakeSimulation makeSimulation, bool verbose) {
+	Configuration best {};
+	double bestTimeToPrecision {0};
+	double bestSingleThreadRate {0};
+	for (const auto& candidate : candidates) {
+		// a short single-threaded probe sizes the trial
+		const auto probe = runTrial(candidate, 1, kDefaultChunk, 1, workerCpus, makeSimulation);
+		const auto trial = runTrial(candidate, maxThreads, kDefaultChunk,
+			getChunksPerThread(probe.samplesPerSecond, kDefaultChunk), workerCpus, makeSimulation);
+		if (verbose) {
+			std::cout << "Auto-tuner: " << candidate << ", " << trial.samplesPerSecond << " samples/sec, variance per sample "
+				<< trial.variance << ", seconds to a 1e-5 standard error " << trial.getTimeToPrecision() * 1e10 << std::endl;
+		}
+		if (best.simulation.empty() || trial.getTimeToPrecision() < bestTimeToPrecision) {
+			best = {candidate, maxThreads, kDefaultChunk, trial.variance, trial.samplesPerSecond};
+			bestTimeToPrecision = trial.getTimeToPrecision();
+			bestSingleThreadRate = probe.samplesPerSecond;
+		}
+	}
+
+	std::vector<int> threadCounts {};
+	for (int threads {1}; threads < maxThreads; threads *= 2) {
+		threadCounts.push_back(threads);
+	}
+	threadCounts.push_back(maxThreads);
+	for (int threads : threadCounts) {
+		for (int chunk : kChunks) {
+			const auto trial = runTrial(best.simulation, threads, chunk,
+				getChunksPerThread(bestSingleThreadRate, chunk), workerCpus, makeSimulation);
+			if (verbose) {
+				std::cout << "Auto-tuner: " << best.simulation << ", threads " << threads << ", chunk " << chunk << ", "
+					<< trial.samplesPerSecond << " samples/sec" << std::endl;
+			}
+			if (trial.samplesPerSecond > best.samplesPerSecond) {
+				best.threads = threads;
+				best.chunk = chunk;
+				best.samplesPerSecond = trial.samplesPerSecond;
+			}
+		}
+	}
+	return best;
+}
+
+} // namespace autotune
+
+#endif
@@ -0,0 +1,88 @@
+#ifndef ENTROPY_GENERATOR_H
+#define ENTROPY_GENERATOR_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <random>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include "common/MappedFile.h"
+#include "simulation/ReplaySource.h"
+
+/**
+ * `main generate <file>`: writes an entropy file for --replay (simulation/ReplaySource.h).
+ * The values are generated in blocks, block b from an engine seeded with (seed, b), and the blocks
+ * are shared out over the threads; so the file depends on the seed only, not on the thread count,
+ * and the same command always writes the same file.
+ */
+namespace entropy_generator {
+
+constexpr std::uint64_t kBlockValues {std::uint64_t {1} << 20};
+
+/**
+ * Fills values [first, last) of block b.
+ */
+template <typename T>
+void generateBlock(T* values, std::uint64_t first, std::uint64_t last, std::uint64_t seed, std::uint64_t block) {
+	std::seed_seq seedSequence {static_cast<std::uint32_t>(seed), static_cast<std::uint32_t>(seed >> 32),
+		static_cast<std::uint32_t>(block), static_cast<std::uint32_t>(block >> 32)};
+	if constexpr (std::is_same_v<T, std::uint32_t>) {
+		// the words a std::mt19937 would hand the distributions, so replays see the same kind of input
+		std::mt19937 engine {seedSequence};
+		for (std::uint64_t v {first}; v < last; v++) {
+			values[v] = engine();
+		}
+	} else {
+		std::mt19937_64 engine {seedSequence};
+		std::uniform_real_distribution<T> distribution {1.0, 2.0};
+		for (std::uint64_t v {first}; v < last; v++) {
+			values[v] = distribution(engine);
+		}
+	}
+}
+
+/**
+ * @param count Values to write: 32-bit words, or double coordinates in [1, 2].
+ * @return An empty string, or what went wrong.
+ */
+inline std::string generate(const std::string& path, simulation::EntropyFileHeader::Kind kind, std::uint64_t count,
+		std::uint64_t seed, int threads) {
+	using Kind = simulation::EntropyFileHeader::Kind;
+	const std::uint32_t valueBytes {static_cast<std::uint32_t>(kind == Kind::Words ? sizeof(std::uint32_t) : sizeof(double))};
+	const auto header = simulation::EntropyFileHeader::make(kind, valueBytes, count, seed);
+	MappedFile file {path, static_cast<std::size_t>(header.getFileSize())};
+	if (!file.isOpen()) {
+		return file.getError();
+	}
+	std::memcpy(file.data(), &header, sizeof(header));
+	std::byte* values {file.data() + header.dataStart};
+
+	const std::uint64_t blocks {(count + kBlockValues - 1) / kBlockValues};
+	std::vector<std::thread> workers {};
+	for (int t {0}; t < threads; t++) {
+		workers.emplace_back([=] {
+			for (std::uint64_t b {blocks * t / threads}; b < blocks * (t + 1) / threads; b++) {
+				const std::uint64_t first {b * kBlockValues};
+				const std::uint64_t last {std::min(count, first + kBlockValues)};
+				if (kind == Kind::Words) {
+					generateBlock(reinterpret_cast<std::uint32_t*>(values), first, last, seed, b);
+				} else {
+					generateBlock(reinterpret_cast<double*>(values), first, last, seed, b);
+				}
+			}
+		});
+	}
+	for (auto& worker : workers) {
+		worker.join();
+	}
+	return file.sync() ? std::string {} : file.getError();
+}
+
+} // namespace entropy_generator
+
+#endif
@@ -0,0 +1,300 @@
+#ifndef LIVE_STATS_H
+#define LIVE_STATS_H
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <csignal>
+#include <cstdint>
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <new>
+#include <string>
+#include <sys/mman.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+/**
+ * Live progress of a harness run in a POSIX shared-memory segment, /axis_aligned_bb_sim.<pid>.
+ *
+ * Every worker owns one cache-line padded slot and publishes into it after each chunk with relaxed
+ * atomic stores: no lock, no syscall and no shared cache line in the timed loop.  Readers (the
+ * harness's main thread, or `main stats <pid>` from another shell) sum the slots without
+ * synchronizing, so a snapshot may mix two chunks of one worker; that is fine for progress.
+ * The error bar comes from batch means: every chunk's average ratio is one batch.
+ */
+namespace live_stats {
+
+constexpr std::uint64_t kMagic {0x5441545342424141}; // "AABBSTAT"
+
+struct alignas(64) Slot {
+	std::atomic<std::int64_t> samples {0};
+	std::atomic<double> sumOfRatios {0};
+	std::atomic<std::int64_t> batches {0};
+	std::atomic<double> sumOfBatchMeans {0};
+	std::atomic<double> sumOfSquaredBatchMeans {0};
+
+	/**
+	 * Adds one finished chunk; only the slot's own worker may call this.
+	 */
+	void publish(std::int64_t runCount, double chunkSumOfRatios) {
+		if (runCount == 0) {
+			return;
+		}
+		const double batchMean {chunkSumOfRatios / static_cast<double>(runCount)};
+		// single writer, so load + store instead of a locked read-modify-write
+		samples.store(samples.load(std::memory_order_relaxed) + runCount, std::memory_order_relaxed);
+		sumOfRatios.store(sumOfRatios.load(std::memory_order_relaxed) + chunkSumOfRatios, std::memory_order_relaxed);
+		batches.store(batches.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+		sumOfBatchMeans.store(sumOfBatchMeans.load(std::memory_order_relaxed) + batchMean, std::memory_order_relaxed);
+		sumOfSquaredBatchMeans.store(sumOfSquaredBatchMeans.load(std::memory_order_relaxed) + batchMean * batchMean, std::memory_order_relaxed);
+	}
+};
+
+struct alignas(64) Header {
+	std::uint64_t magic {kMagic};
+	std::int32_t slotCount {0};
+	std::int32_t workerCount {0};   // threads times repeats
+	std::int64_t targetSamples {0};
+	char simulation[32] {};
+	std::atomic<std::int64_t> startNanoseconds {0}; // steady_clock, which is CLOCK_MONOTONIC and so the same for all processes
+	std::atomic<std::int64_t> endNanoseconds {0};   // set by finish()
+	std::atomic<std::int32_t> finishedWorkers {0};
+	std::atomic<bool> done {false};
+};
+
+static_assert(std::atomic<double>::is_always_lock_free && std::atomic<std::int64_t>::is_always_lock_free,
+	"the slots are read from other processes, which needs address-free atomics");
+
+struct Snapshot {
+	std::string simulation {};
+	std::int64_t samples {0};
+	std::int64_t targetSamples {0};
+	double seconds {0};
+	double estimate {0};
+	double standardError {0}; // NaN below two batches
+	std::int64_t batches {0};
+	int finishedWorkers {0};
+	int workerCount {0};
+	bool done {false};
+
+	double getSamplesPerSecond() const {
+		return seconds > 0 ? samples / seconds : 0;
+	}
+
+	/**
+	 * @return Seconds to the target at the average rate so far, NaN before the first chunk.
+	 */
+	double getEtaSeconds() const {
+		return samples > 0 ? static_cast<double>(targetSamples - samples) / getSamplesPerSecond() : std::nan("");
+	}
+};
+
+inline std::int64_t getSteadyNanoseconds() {
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+class Segment {
+public:
+	static std::string getName(pid_t pid) {
+		return "/axis_aligned_bb_sim." + std::to_string(pid);
+	}
+
+	/**
+	 * Creates the segment of this process, removed again by the destructor.
+	 * @param slotCount Threads of a repeat; a repeat's worker i publishes into slot i.
+	 * @param targetSamples Samples the whole run will take, for the ETA.
+	 */
+	Segment(int slotCount, int repeats, std::int64_t targetSamples, const std::string& simulationName) :
+		m_name {getName(getpid())},
+		m_owner {true}
+	{
+		const int fd {shm_open(m_name.c_str(), O_CREAT | O_RDWR | O_TRUNC, 0600)};
+		if (fd < 0) {
+			m_error = std::string {"shm_open: "} + std::strerror(errno);
+			return;
+		}
+		m_size = sizeof(Header) + slotCount * sizeof(Slot);
+		if (ftruncate(fd, static_cast<off_t>(m_size)) != 0) {
+			m_error = std::string {"ftruncate: "} + std::strerror(errno);
+			close(fd);
+			shm_unlink(m_name.c_str());
+			return;
+		}
+		map(fd, PROT_READ | PROT_WRITE);
+		if (!m_memory) {
+			shm_unlink(m_name.c_str());
+			return;
+		}
+		auto* header = new (m_memory) Header {};
+		header->slotCount = slotCount;
+		header->workerCount = slotCount * repeats;
+		header->targetSamples = targetSamples;
+		simulationName.copy(header->simulation, sizeof(header->simulation) - 1);
+		for (int i {0}; i < slotCount; i++) {
+			new (&getSlot(i)) Slot {};
+		}
+	}
+
+	/**
+	 * Opens the segment of another harness process, read only.
+	 */
+	explicit Segment(pid_t pid) :
+		m_name {getName(pid)},
+		m_owner {false}
+	{
+		const int fd {shm_open(m_name.c_str(), O_RDONLY, 0)};
+		if (fd < 0) {
+			m_error = m_name + ": " + std::strerror(errno);
+			return;
+		}
+		m_size = sizeof(Header);
+		map(fd, PROT_READ);
+		if (!m_memory || getHeader().magic != kMagic) {
+			m_error = m_name + ": not a harness stats segment";
+			unmap();
+			return;
+		}
+		const int slotCount {getHeader().slotCount};
+		unmap();
+		// the slot count is only known from the header, so map again with the slots
+		const int slotsFd {shm_open(m_name.c_str(), O_RDONLY, 0)};
+		if (slotsFd < 0) {
+			m_error = m_name + ": " + std::strerror(errno);
+			return;
+		}
+		m_size = sizeof(Header) + slotCount * sizeof(Slot);
+		map(slotsFd, PROT_READ);
+	}
+
+	~Segment() {
+		unmap();
+		if (m_owner && m_error.empty()) {
+			shm_unlink(m_name.c_str());
+		}
+	}
+
+	Segment(const Segment&) = delete;
+	Segment& operator=(const Segment&) = delete;
+
+	bool isOpen() const {
+		return m_memory != nullptr;
+	}
+
+	const std::string& getError() const {
+		return m_error;
+	}
+
+	const std::string& getName() const {
+		return m_name;
+	}
+
+	Header& getHeader() const {
+		return *static_cast<Header*>(m_memory);
+	}
+
+	Slot& getSlot(int i) const {
+		return reinterpret_cast<Slot*>(static_cast<char*>(m_memory) + sizeof(Header))[i];
+	}
+
+	/**
+	 * Starts the clock of the samples/sec and ETA; the first call wins.
+	 */
+	void start() {
+		std::int64_t unset {0};
+		getHeader().startNanoseconds.compare_exchange_strong(unset, getSteadyNanoseconds(), std::memory_order_relaxed);
+	}
+
+	/**
+	 * Marks the run as done and stops its clock.
+	 */
+	void finish() {
+		getHeader().endNanoseconds.store(getSteadyNanoseconds(), std::memory_order_relaxed);
+		getHeader().done.store(true, std::memory_order_relaxed);
+	}
+
+	Snapshot read() const {
+		const Header& header = getHeader();
+		Snapshot snapshot {};
+		snapshot.simulation = header.simulation;
+		snapshot.targetSamples = header.targetSamples;
+		snapshot.workerCount = header.workerCount;
+		snapshot.finishedWorkers = header.finishedWorkers.load(std::memory_order_relaxed);
+		snapshot.done = header.done.load(std::memory_order_relaxed);
+		const std::int64_t start {header.startNanoseconds.load(std::memory_order_relaxed)};
+		const std::int64_t end {header.endNanoseconds.load(std::memory_order_relaxed)};
+		snapshot.seconds = start > 0 ? ((end > 0 ? end : getSteadyNanoseconds()) - start) * 1e-9 : 0;
+		double sumOfRatios {0};
+		double sumOfBatchMeans {0};
+		double sumOfSquaredBatchMeans {0};
+		for (int i {0}; i < header.slotCount; i++) {
+			const Slot& slot = getSlot(i);
+			snapshot.samples += slot.samples.load(std::memory_order_relaxed);
+			sumOfRatios += slot.sumOfRatios.load(std::memory_order_relaxed);
+			snapshot.batches += slot.batches.load(std::memory_order_relaxed);
+			sumOfBatchMeans += slot.sumOfBatchMeans.load(std::memory_order_relaxed);
+			sumOfSquaredBatchMeans += slot.sumOfSquaredBatchMeans.load(std::memory_order_relaxed);
+		}
+		snapshot.estimate = snapshot.samples > 0 ? sumOfRatios / snapshot.samples : std::nan("");
+		snapshot.standardError = std::nan("");
+		if (snapshot.batches > 1) {
+			const double n {static_cast<double>(snapshot.batches)};
+			const double mean {sumOfBatchMeans / n};
+			const double variance {std::max(0.0, (sumOfSquaredBatchMeans - n * mean * mean) / (n - 1))};
+			snapshot.standardError = std::sqrt(variance / n);
+		}
+		return snapshot;
+	}
+
+private:
+	std::string m_name;
+	bool m_owner;
+	void* m_memory {nullptr};
+	std::size_t m_size {0};
+	std::string m_error {};
+
+	void map(int fd, int protection) {
+		void* memory {mmap(nullptr, m_size, protection, MAP_SHARED, fd, 0)};
+		close(fd);
+		if (memory == MAP_FAILED) {
+			m_error = std::string {"mmap: "} + std::strerror(errno);
+			return;
+		}
+		m_memory = memory;
+	}
+
+	void unmap() {
+		if (m_memory) {
+			munmap(m_memory, m_size);
+			m_memory = nullptr;
+		}
+	}
+};
+
+inline void printSnapshot(std::ostream& out, const Snapshot& snapshot) {
+	out << "[" << snapshot.simulation << "] " << snapshot.samples << " / " << snapshot.targetSamples << " samples ("
+		<< (snapshot.targetSamples > 0 ? 100.0 * snapshot.samples / snapshot.targetSamples : 0) << "%), "
+		<< snapshot.getSamplesPerSecond() << " samples/sec, ETA " << snapshot.getEtaSeconds() << " s, estimate " << snapshot.estimate;
+	if (!std::isnan(snapshot.standardError)) {
+		out << " +- " << snapshot.standardError << " (" << snapshot.batches << " chunks)";
+	}
+	out << ", " << snapshot.finishedWorkers << " / " << snapshot.workerCount << " workers done" << std::endl;
+}
+
+// set by SIGUSR1, cleared by whoever prints the snapshot
+inline volatile std::sig_atomic_t snapshotRequested {0};
+
+inline void installSnapshotHandler() {
+	struct sigaction action {};
+	action.sa_handler = [](int) { snapshotRequested = 1; };
+	sigemptyset(&action.sa_mask);
+	action.sa_flags = SA_RESTART;
+	sigaction(SIGUSR1, &action, nullptr);
+}
+
+} // namespace live_stats
+
+#endif
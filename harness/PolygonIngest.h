@@ -0,0 +1,176 @@
+#ifndef POLYGON_INGEST_H
+#define POLYGON_INGEST_H
+
+#include <algorithm>
+#include <cmath>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <latch>
+#include <span>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "common/Concurrency.h"
+#include "common/MappedFile.h"
+#include "common/Timer.h"
+#include "geometry/PolygonBatch.h"
+#include "geometry/PolygonFile.h"
+#include "simulation/Estimators.h"
+#include "simulation/SampleSource.h"
+
+/**
+ * `main ingest <file>`: runs the area and bounding box kernels over a columnar polygon file
+ * (geometry/PolygonFile.h) instead of random polygons.  The file is mapped, not read: the workers
+ * evaluate the columns in place, each over its own contiguous range of polygons, split so that
+ * every worker gets about the same number of vertices.  Each worker walks its range in chunks,
+ * asking the kernel to read the next chunk ahead (MADV_WILLNEED) while it evaluates the current
+ * one, and reuses one chunk of scratch results, so nothing is allocated per polygon.
+ */
+namespace polygon_ingest {
+
+// polygons per chunk: a few MB of coordinates, enough for readahead to stay ahead of the kernels
+constexpr std::size_t kChunkPolygons {std::size_t {1} << 16};
+
+struct Result {
+	simulation::RunningStats<double> ratios {};
+	double totalArea {0};
+	double seconds {0};
+	std::vector<double> workerSeconds {};
+};
+
+/**
+ * Splits polygons into ranges of about equal vertex counts, on polygon boundaries.
+ * @return ranges + 1 polygon indices, the first 0 and the last the polygon count.
+ */
+template <std::floating_point FloatType>
+std::vector<std::size_t> splitByVertices(const geometry::PolygonColumns<FloatType>& polygons, int ranges) {
+	const std::size_t count {polygons.size()};
+	std::vector<std::size_t> bounds(ranges + 1, count);
+	bounds[0] = 0;
+	for (int i {1}; i < ranges; i++) {
+		if (polygons.offsets.empty()) {
+			bounds[i] = count * i / ranges;
+			continue;
+		}
+		const std::int64_t first {polygons.offsets.front()};
+		const std::int64_t target {first + (polygons.offsets.back() - first) * i / ranges};
+		const auto it = std::lower_bound(polygons.offsets.begin(), polygons.offsets.end(), target);
+		bounds[i] = std::min(count, static_cast<std::size_t>(it - polygons.offsets.begin()));
+	}
+	for (int i {1}; i <= ranges; i++) {
+		bounds[i] = std::max(bounds[i], bounds[i - 1]);
+	}
+	return bounds;
+}
+
+/**
+ * Evaluates every polygon of the file.
+ * @param cpus CPUs to pin the workers to, in order; empty to leave them unpinned.
+ * @param ratioColumn Where to write each polygon's ratio, one entry per polygon, or empty.
+ */
+template <std::floating_point FloatType>
+Result run(const geometry::PolygonFile& file, int threads, const std::vector<int>& cpus, std::span<FloatType> ratioColumn) {
+	const geometry::PolygonColumns<FloatType> polygons {file.template getColumns<FloatType>()};
+	const std::vector<std::size_t> bounds {splitByVertices(polygons, threads)};
+
+	std::vector<simulation::RunningStats<double>> workerRatios(threads);
+	std::vector<double> workerAreas(threads, 0.0);
+	std::vector<double> workerSeconds(threads, 0.0);
+	std::latch prepared {threads};
+	std::latch start {1};
+	std::vector<std::thread> workers {};
+	for (int i {0}; i < threads; i++) {
+		workers.emplace_back([&, i] {
+			if (!cpus.empty() && !Concurrency::pin_to_core(cpus[i % cpus.size()])) {
+				std::cerr << "Failed to pin ingest worker " << i << " to core " << cpus[i % cpus.size()] << std::endl;
+			}
+			std::vector<FloatType> areas(kChunkPolygons);
+			std::vector<FloatType> ratios(ratioColumn.empty() ? kChunkPolygons : 0);
+			simulation::RunningStats<double> stats {};
+			double totalArea {0};
+			const std::size_t last {bounds[i + 1]};
+			file.prefetch(polygons, bounds[i], std::min(last, bounds[i] + kChunkPolygons));
+			prepared.count_down();
+			start.wait();
+
+			Timer timer {false};
+			timer.start();
+			for (std::size_t first {bounds[i]}; first < last; first += kChunkPolygons) {
+				const std::size_t end {std::min(last, first + kChunkPolygons)};
+				file.prefetch(polygons, end, std::min(last, end + kChunkPolygons));
+				const std::size_t count {end - first};
+				const std::span<FloatType> chunkRatios {ratioColumn.empty() ? std::span<FloatType> {ratios}.first(count) : ratioColumn.subspan(first, count)};
+				geometry::PolygonResults<FloatType> results {};
+				results.areas = std::span<FloatType> {areas}.first(count);
+				results.ratios = chunkRatios;
+				geometry::computePolygons(polygons.slice(first, end), results);
+				stats.addBatch(std::span<const FloatType> {chunkRatios});
+				for (std::size_t p {0}; p < count; p++) {
+					totalArea += areas[p];
+				}
+			}
+			timer.stop();
+			workerRatios[i] = stats;
+			workerAreas[i] = totalArea;
+			workerSeconds[i] = timer.getTimeElapsed().count();
+		});
+	}
+	prepared.wait();
+	Timer timer {false};
+	timer.start();
+	start.count_down();
+	for (auto& worker : workers) {
+		worker.join();
+	}
+	timer.stop();
+
+	Result result {};
+	for (int i {0}; i < threads; i++) {
+		result.ratios.merge(workerRatios[i]);
+		result.totalArea += workerAreas[i];
+	}
+	result.seconds = timer.getTimeElapsed().count();
+	result.workerSeconds = std::move(workerSeconds);
+	return result;
+}
+
+/**
+ * Writes a file of random polygons with uniform vertices in [1, 2]^2, for trying out ingestion.
+ * @return An empty string, or what went wrong.
+ */
+template <std::floating_point FloatType>
+std::string createRandomFile(const std::string& path, std::uint64_t polygonCount, int vertexCount) {
+	const auto header = geometry::PolygonFileHeader::make(polygonCount, polygonCount * vertexCount, static_cast<std::uint32_t>(vertexCount), sizeof(FloatType));
+	geometry::PolygonFile file {path, header};
+	if (!file.isOpen()) {
+		return file.getError();
+	}
+	simulation::UniformSampleSource<FloatType> source {2};
+	const std::span<FloatType> xs {file.template getXs<FloatType>()};
+	const std::span<FloatType> ys {file.template getYs<FloatType>()};
+	for (std::size_t v {0}; v < xs.size(); v++) {
+		const FloatType* point {source.next()};
+		xs[v] = point[0];
+		ys[v] = point[1];
+	}
+	return file.sync() ? std::string {} : file.getError();
+}
+
+inline void printResult(std::ostream& out, const Result& result, const geometry::PolygonFile& file) {
+	const double gigabytes {static_cast<double>(file.getFileSize()) / 1e9};
+	out << "Polygons: " << result.ratios.getCount() << ", vertices: " << file.getHeader().totalVertexCount
+		<< ", coordinates: " << (file.getHeader().floatBytes == sizeof(float) ? "float" : "double") << std::endl;
+	out << "Average ratio: " << std::setprecision(10) << result.ratios.getMean()
+		<< ", standard deviation: " << std::sqrt(result.ratios.getVariance()) << std::setprecision(6) << std::endl;
+	out << "Total area: " << result.totalArea << std::endl;
+	out << "Time: " << result.seconds << " s, " << gigabytes / result.seconds << " GB/s, "
+		<< static_cast<double>(result.ratios.getCount()) / result.seconds / 1e6 << " M polygons/s" << std::endl;
+}
+
+} // namespace polygon_ingest
+
+#endif
@@ -0,0 +1,125 @@
+#ifndef RATIO_DISTRIBUTION_H
+#define RATIO_DISTRIBUTION_H
+
+#include <array>
+#include <cstdint>
+#include <fstream>
+#include <iomanip>
+#include <ostream>
+#include <string>
+
+#include "common/AmbientScope.h"
+#include "common/MemoryResource.h"
+#include "simulation/Distributions.h"
+
+/**
+ * `--distribution`: the distribution of the ratios rather than their mean, a histogram over [0, 1]
+ * and quantiles from a KLL sketch (simulation/Distributions.h).
+ *
+ * Each worker fills a Sink of its own, in its own memory, without any synchronisation; when the
+ * worker is done, finish() merges it into the worker's slot of the result, and the main thread
+ * merges the slots after joining the workers.
+ */
+namespace ratio_distribution {
+
+constexpr std::array<double, 9> kQuantiles {0.001, 0.01, 0.05, 0.25, 0.5, 0.75, 0.95, 0.99, 0.999};
+// degenerate polygons pile up near 0
+constexpr std::array<double, 3> kTailThresholds {0.001, 0.01, 0.05};
+
+using Distribution = simulation::RatioDistribution<double>;
+
+class Sink {
+public:
+	/**
+	 * @param result Where finish() merges the worker's ratios into.
+	 */
+	explicit Sink(Distribution& result) :
+		m_result {result},
+		m_distribution {ThreadMemoryResource::get()}
+	{}
+
+	~Sink() {
+		finish();
+	}
+
+	Sink(const Sink&) = delete;
+	Sink& operator=(const Sink&) = delete;
+
+	/**
+	 * @return The calling thread's sink, nullptr if it has none.
+	 */
+	static Sink* get() {
+		return ThreadLocalSlot<Sink>::get();
+	}
+
+	void add(double ratio) {
+		m_distribution.add(ratio);
+	}
+
+	void addBatch(const double* ratios, int count) {
+		m_distribution.addBatch(ratios, count);
+	}
+
+	/**
+	 * Merges the ratios into the result.  Idempotent.
+	 */
+	void finish() {
+		if (m_finished) {
+			return;
+		}
+		m_finished = true;
+		m_result.merge(m_distribution);
+	}
+
+	/**
+	 * Makes a sink the calling thread's until the end of the scope.
+	 */
+	using Scope = AmbientScope<Sink>;
+
+private:
+	Distribution& m_result;
+	Distribution m_distribution;
+	bool m_finished {false};
+};
+
+inline void printDistribution(std::ostream& out, const Distribution& distribution) {
+	const auto& sketch = distribution.getSketch();
+	out << "Ratio quantiles:";
+	for (std::size_t q {0}; q < kQuantiles.size(); q++) {
+		out << " p" << 100 * kQuantiles[q] << " " << sketch.getQuantile(kQuantiles[q]) << (q + 1 < kQuantiles.size() ? "," : "");
+	}
+	out << std::endl;
+	out << "Ratio tail:";
+	for (std::size_t t {0}; t < kTailThresholds.size(); t++) {
+		out << " below " << kTailThresholds[t] << " " << 100 * distribution.getHistogram().getMassBelow(kTailThresholds[t]) << "%"
+			<< (t + 1 < kTailThresholds.size() ? "," : "");
+	}
+	out << " (" << distribution.getCount() << " ratios, " << sketch.getCount() << " sampled into the sketch, " << sketch.getRetained()
+		<< " kept by it)" << std::endl;
+}
+
+/**
+ * Writes the histogram as CSV: one line per bin with its bounds, count and cumulative fraction.
+ * @return false if the file cannot be written.
+ */
+inline bool writeCsv(const std::string& path, const Distribution& distribution) {
+	std::ofstream out {path};
+	if (!out) {
+		return false;
+	}
+	using Histogram = simulation::RatioHistogram<double>;
+	const auto& histogram = distribution.getHistogram();
+	const double total {static_cast<double>(histogram.getTotal())};
+	out << "low,high,count,cumulative\n";
+	std::int64_t cumulative {0};
+	for (int b {0}; b < Histogram::kBins; b++) {
+		cumulative += histogram.getCount(b);
+		out << std::setprecision(10) << Histogram::getBinLow(b) << "," << Histogram::getBinLow(b + 1) << ","
+			<< histogram.getCount(b) << "," << (total > 0 ? static_cast<double>(cumulative) / total : 0.0) << "\n";
+	}
+	return static_cast<bool>(out);
+}
+
+} // namespace ratio_distribution
+
+#endif
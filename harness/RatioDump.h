@@ -0,0 +1,351 @@
+#ifndef RATIO_DUMP_H
+#define RATIO_DUMP_H
+
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <fcntl.h>
+#include <memory_resource>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+#include "common/AmbientScope.h"
+#include "common/MemoryResource.h"
+
+/**
+ * `--dump <file>`: every ratio of the timed runs, written to a columnar file.
+ *
+ * Each worker has a Sink with two aligned blocks: it fills one while the Writer's background thread
+ * writes the other to the file with one large pwrite, through O_DIRECT where the file system allows
+ * it, so the dump neither goes through the page cache nor competes with the workers for memory
+ * bandwidth twice.  A worker only waits if it fills a block before the previous one is written,
+ * i.e. if the disk is slower than the simulation; that wait is reported as the dump's stall time.
+ *
+ * The file is a Header padded to kDataStart bytes, then the ratios as one column of doubles.  Full
+ * blocks land in the order they were written, the partial last block of every worker after them, so
+ * the column is sample order within a block but not across workers.
+ */
+namespace ratio_dump {
+
+constexpr std::size_t kDataStart {4096};
+// 128 K ratios: large enough for the disk, small enough that two per worker stay out of the way
+constexpr std::size_t kBlockValues {std::size_t {1} << 17};
+constexpr std::size_t kBlockBytes {kBlockValues * sizeof(double)};
+
+struct Header {
+	static constexpr char kMagic[8] {'R', 'A', 'T', 'I', 'O', 'C', 'O', 'L'};
+	static constexpr std::uint32_t kVersion {1};
+
+	char magic[8] {};
+	std::uint32_t version {kVersion};
+	std::uint32_t floatBytes {sizeof(double)};
+	std::uint64_t count {0};        // ratios in the column
+	std::uint64_t dataStart {kDataStart};
+	std::uint32_t workerCount {0};  // sinks that wrote into the file
+	std::uint32_t ngon {0};
+	char simulation[24] {};
+};
+
+static_assert(sizeof(Header) == 64);
+
+/**
+ * The file and its background writing thread, shared by all sinks.
+ */
+class Writer {
+public:
+	/**
+	 * Creates the file and starts the writing thread.
+	 * @param maxSinks Sinks alive at the same time, which bounds the blocks in flight.
+	 */
+	Writer(const std::string& path, int maxSinks, int ngon, const std::string& simulationName) :
+		m_path {path},
+		m_queue(2 * static_cast<std::size_t>(maxSinks))
+	{
+		m_header.ngon = static_cast<std::uint32_t>(ngon);
+		std::memcpy(m_header.magic, Header::kMagic, sizeof(Header::kMagic));
+		simulationName.copy(m_header.simulation, sizeof(m_header.simulation) - 1);
+
+		m_fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+		if (m_fd < 0) {
+			setError("open");
+			return;
+		}
+		// O_DIRECT is refused by some file systems (tmpfs); the dump then goes through the page cache
+		m_directFd = open(path.c_str(), O_WRONLY | O_DIRECT | O_CLOEXEC);
+		m_direct = m_directFd >= 0;
+		m_thread = std::thread {[this] { writeBlocks(); }};
+	}
+
+	~Writer() {
+		close();
+	}
+
+	Writer(const Writer&) = delete;
+	Writer& operator=(const Writer&) = delete;
+
+	bool isOpen() const {
+		return m_fd >= 0;
+	}
+
+	bool isDirect() const {
+		return m_direct;
+	}
+
+	const std::string& getError() const {
+		return m_error;
+	}
+
+	/**
+	 * Queues a full block; busy is cleared (and notified) once it is written.
+	 */
+	void submit(const double* values, std::size_t count, std::atomic<bool>& busy) {
+		{
+			std::lock_guard lock {m_mutex};
+			m_queue[(m_head + m_size) % m_queue.size()] = {values, count, &busy};
+			m_size++;
+		}
+		m_ready.notify_one();
+	}
+
+	/**
+	 * Keeps the partial last block of a sink, written after all full blocks by close().
+	 */
+	void addTail(const double* values, std::size_t count) {
+		std::lock_guard lock {m_mutex};
+		m_tail.insert(m_tail.end(), values, values + count);
+		m_sinkCount++;
+	}
+
+	void addStall(std::chrono::steady_clock::duration stall) {
+		m_stallNanoseconds.fetch_add(std::chrono::duration_cast<std::chrono::nanoseconds>(stall).count(), std::memory_order_relaxed);
+	}
+
+	/**
+	 * Writes what is queued, then the tails and the header, and closes the file.
+	 * @return false if anything could not be written, with the reason in getError().
+	 */
+	bool close() {
+		if (m_fd < 0) {
+			return false;
+		}
+		{
+			std::lock_guard lock {m_mutex};
+			m_stopping = true;
+		}
+		m_ready.notify_one();
+		if (m_thread.joinable()) {
+			m_thread.join();
+		}
+		if (m_directFd >= 0) {
+			::close(m_directFd);
+			m_directFd = -1;
+		}
+		writeAll(m_fd, m_tail.data(), m_tail.size() * sizeof(double), m_nextOffset);
+		m_nextOffset += m_tail.size() * sizeof(double);
+		m_header.count = (m_nextOffset - kDataStart) / sizeof(double);
+		m_header.workerCount = static_cast<std::uint32_t>(m_sinkCount);
+		writeAll(m_fd, &m_header, sizeof(m_header), 0);
+		if (fsync(m_fd) != 0) {
+			setError("fsync");
+		}
+		::close(m_fd);
+		m_fd = -1;
+		return m_error.empty();
+	}
+
+	std::uint64_t getCount() const {
+		return m_header.count;
+	}
+
+	std::uint64_t getBytes() const {
+		return m_nextOffset;
+	}
+
+	/**
+	 * @return Seconds the writing thread spent in pwrite.
+	 */
+	double getWriteSeconds() const {
+		return std::chrono::duration<double>(m_writeTime).count();
+	}
+
+	/**
+	 * @return Seconds the workers waited for a free block, summed over workers.
+	 */
+	double getStallSeconds() const {
+		return static_cast<double>(m_stallNanoseconds.load(std::memory_order_relaxed)) / 1e9;
+	}
+
+	const std::string& getPath() const {
+		return m_path;
+	}
+
+private:
+	struct Request {
+		const double* values {nullptr};
+		std::size_t count {0};
+		std::atomic<bool>* busy {nullptr};
+	};
+
+	std::string m_path;
+	std::string m_error {};
+	int m_fd {-1};
+	int m_directFd {-1};
+	bool m_direct {false};
+	Header m_header {};
+	std::thread m_thread {};
+
+	std::mutex m_mutex {};
+	std::condition_variable m_ready {};
+	std::vector<Request> m_queue; // ring, never more than two blocks per sink in it
+	std::size_t m_head {0};
+	std::size_t m_size {0};
+	bool m_stopping {false};
+	std::vector<double> m_tail {};
+	int m_sinkCount {0};
+
+	// only touched by the writing thread until it is joined
+	std::uint64_t m_nextOffset {kDataStart};
+	std::chrono::steady_clock::duration m_writeTime {};
+	std::atomic<std::int64_t> m_stallNanoseconds {0};
+
+	void setError(const char* call) {
+		if (m_error.empty()) {
+			m_error = m_path + ": " + call + ": " + std::strerror(errno);
+		}
+	}
+
+	void writeAll(int fd, const void* data, std::size_t bytes, std::uint64_t offset) {
+		const auto* p = static_cast<const char*>(data);
+		while (bytes > 0) {
+			const ssize_t written {pwrite(fd, p, bytes, static_cast<off_t>(offset))};
+			if (written < 0) {
+				if (errno == EINTR) {
+					continue;
+				}
+				setError("pwrite");
+				return;
+			}
+			p += written;
+			bytes -= static_cast<std::size_t>(written);
+			offset += static_cast<std::uint64_t>(written);
+		}
+	}
+
+	void writeBlocks() {
+		while (true) {
+			Request request {};
+			{
+				std::unique_lock lock {m_mutex};
+				m_ready.wait(lock, [this] { return m_size > 0 || m_stopping; });
+				if (m_size == 0) {
+					return;
+				}
+				request = m_queue[m_head];
+				m_head = (m_head + 1) % m_queue.size();
+				m_size--;
+			}
+			const auto writeStart = std::chrono::steady_clock::now();
+			const std::size_t bytes {request.count * sizeof(double)};
+			writeAll(m_directFd >= 0 ? m_directFd : m_fd, request.values, bytes, m_nextOffset);
+			m_writeTime += std::chrono::steady_clock::now() - writeStart;
+			m_nextOffset += bytes;
+			request.busy->store(false, std::memory_order_release);
+			request.busy->notify_one();
+		}
+	}
+};
+
+/**
+ * A worker's double buffer.  The blocks come from the worker's memory resource, aligned for
+ * O_DIRECT.
+ */
+class Sink {
+public:
+	explicit Sink(Writer& writer) :
+		m_writer {writer},
+		m_memory {ThreadMemoryResource::get()}
+	{
+		for (auto& block : m_blocks) {
+			block = static_cast<double*>(m_memory->allocate(kBlockBytes, kDataStart));
+			// touch the pages before the timed part
+			std::memset(static_cast<void*>(block), 0, kBlockBytes);
+		}
+	}
+
+	~Sink() {
+		finish();
+		for (auto* block : m_blocks) {
+			m_memory->deallocate(block, kBlockBytes, kDataStart);
+		}
+	}
+
+	Sink(const Sink&) = delete;
+	Sink& operator=(const Sink&) = delete;
+
+	/**
+	 * @return The calling thread's sink, nullptr if it has none.
+	 */
+	static Sink* get() {
+		return ThreadLocalSlot<Sink>::get();
+	}
+
+	void add(double ratio) {
+		m_blocks[m_active][m_size++] = ratio;
+		if (m_size == kBlockValues) {
+			flush();
+		}
+	}
+
+	/**
+	 * Waits for the blocks in flight and hands the partial block to the writer.  Idempotent.
+	 */
+	void finish() {
+		if (m_finished) {
+			return;
+		}
+		m_finished = true;
+		for (auto& busy : m_busy) {
+			busy.wait(true, std::memory_order_acquire);
+		}
+		m_writer.addTail(m_blocks[m_active], m_size);
+		m_size = 0;
+	}
+
+	/**
+	 * Makes a sink the calling thread's until the end of the scope.
+	 */
+	using Scope = AmbientScope<Sink>;
+
+private:
+	Writer& m_writer;
+	std::pmr::memory_resource* m_memory;
+	double* m_blocks[2] {};
+	std::atomic<bool> m_busy[2] {};
+	int m_active {0};
+	std::size_t m_size {0};
+	bool m_finished {false};
+
+	void flush() {
+		const int next {1 - m_active};
+		if (m_busy[next].load(std::memory_order_acquire)) {
+			const auto stallStart = std::chrono::steady_clock::now();
+			m_busy[next].wait(true, std::memory_order_acquire);
+			m_writer.addStall(std::chrono::steady_clock::now() - stallStart);
+		}
+		m_busy[m_active].store(true, std::memory_order_relaxed);
+		m_writer.submit(m_blocks[m_active], m_size, m_busy[m_active]);
+		m_active = next;
+		m_size = 0;
+	}
+};
+
+} // namespace ratio_dump
+
+#endif
@@ -0,0 +1,232 @@
+#ifndef SCALING_DRIVER_H
+#define SCALING_DRIVER_H
+
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <latch>
+#include <map>
+#include <optional>
+#include <set>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "common/Concurrency.h"
+#include "common/Timer.h"
+#include "simulation/ISimulation.h"
+
+/**
+ * Scaling sweeps for `--scaling`: runs a simulation at every thread count from 1 to the usable core
+ * count, with the same total number of simulations (strong scaling) or the same number per thread
+ * (weak scaling), and reports the parallel efficiency.  Every thread count is annotated with what
+ * its last worker added (a new physical core, an SMT sibling of a used core, or a new socket), so
+ * the knees can be told apart: SMT and memory bandwidth limits show as efficiency drops at "smt"
+ * rows or at a steady thread count regardless of placement, socket effects at "socket" rows.
+ */
+namespace scaling {
+
+enum class Mode { Strong, Weak };
+
+/**
+ * @param name "strong", "weak" or "both".
+ * @return The modes to sweep, or nullopt if the name is invalid.
+ */
+inline std::optional<std::vector<Mode>> parseModes(const std::string& name) {
+	if (name == "strong") {
+		return std::vector<Mode> {Mode::Strong};
+	} else if (name == "weak") {
+		return std::vector<Mode> {Mode::Weak};
+	} else if (name == "both") {
+		return std::vector<Mode> {Mode::Strong, Mode::Weak};
+	}
+	return std::nullopt;
+}
+
+inline const char* getModeName(Mode mode) {
+	return mode == Mode::Strong ? "strong" : "weak";
+}
+
+struct Point {
+	int threads {0};
+	std::string added {};        // what the last worker's CPU adds: "core", "smt" or "socket"
+	std::vector<double> seconds {}; // wall time of every trial
+	std::int64_t samples {0};    // simulations per trial, over all threads
+
+	double getMedianSeconds() const {
+		std::vector<double> sorted {seconds};
+		std::sort(sorted.begin(), sorted.end());
+		const std::size_t middle {sorted.size() / 2};
+		return sorted.size() % 2 ? sorted[middle] : (sorted[middle - 1] + sorted[middle]) / 2;
+	}
+
+	double getMinSeconds() const {
+		return *std::min_element(seconds.begin(), seconds.end());
+	}
+
+	double getSamplesPerSecond() const {
+		return samples / getMedianSeconds();
+	}
+};
+
+/**
+ * Describes what each worker's CPU adds to the ones before it in the worker order.
+ * @param workerCpus Logical CPUs of the workers, worker i on workerCpus[i % size].
+ * @param coreMapping (socket, core) to logical CPU mapping, from Concurrency::get_allowed_physical_core_mapping().
+ * @return "core", "smt" or "socket" per worker.
+ */
+inline std::vector<std::string> describeWorkerCpus(int maxThreads, const std::vector<int>& workerCpus,
+		const std::map<std::pair<int, int>, std::vector<int>>& coreMapping) {
+	std::map<int, std::pair<int, int>> coreOfCpu {};
+	for (const auto& [core, logicalCpus] : coreMapping) {
+		for (int cpu : logicalCpus) {
+			coreOfCpu[cpu] = core;
+		}
+	}
+	std::set<std::pair<int, int>> usedCores {};
+	std::set<int> usedSockets {};
+	std::vector<std::string> added {};
+	for (int i {0}; i < maxThreads; i++) {
+		const int cpu {workerCpus.empty() ? -1 : workerCpus[i % workerCpus.size()]};
+		const auto found = coreOfCpu.find(cpu);
+		if (found == coreOfCpu.end() || usedCores.contains(found->second)) {
+			// unpinned workers, or more workers than CPUs, share cores like SMT siblings do
+			added.push_back(found == coreOfCpu.end() && i == 0 ? "core" : "smt");
+			continue;
+		}
+		const auto [socket, core] = found->second;
+		added.push_back(!usedSockets.empty() && !usedSockets.contains(socket) ? "socket" : "core");
+		usedCores.insert(found->second);
+		usedSockets.insert(socket);
+	}
+	return added;
+}
+
+/**
+ * Runs one timed trial: every worker runs its share of the simulations, in chunks if chunk > 0.
+ * @param makeSimulation Callable (int runs) returning the simulation.
+ * @return Wall time in seconds, from the moment all workers are prepared.
+ */
+template <typename MakeSimulation>
+double runTrial(int threads, const std::vector<int>& runsPerThread, int chunk, const std::vector<int>& workerCpus, MakeSimulation& makeSimulation) {
+	std::latch prepared {threads};
+	std::latch start {1};
+	std::vector<std::thread> workers {};
+	for (int i {0}; i < threads; i++) {
+		workers.emplace_back([&, i]() {
+			if (!workerCpus.empty()) {
+				Concurrency::pin_to_core(workerCpus[i % workerCpus.size()]);
+			}
+			const int runs {runsPerThread[i]};
+			const int chunkRuns {(chunk > 0 && chunk < runs) ? chunk : runs};
+			const int chunkCount {chunkRuns > 0 ? runs / chunkRuns : 0};
+			const int tailRuns {runs - chunkCount * chunkRuns};
+			auto sim = chunkRuns > 0 ? makeSimulation(chunkRuns) : nullptr;
+			auto tail = tailRuns > 0 ? makeSimulation(tailRuns) : nullptr;
+			if (sim) {
+				sim->prepare();
+			}
+			if (tail) {
+				tail->prepare();
+			}
+			prepared.count_down();
+			start.wait();
+			for (int c {0}; c < chunkCount; c++) {
+				sim->run();
+			}
+			if (tail) {
+				tail->run();
+			}
+		});
+	}
+	prepared.wait();
+	Timer timer {false};
+	timer.start();
+	start.count_down();
+	for (auto& worker : workers) {
+		worker.join();
+	}
+	timer.stop();
+	return timer.getTimeElapsed().count();
+}
+
+/**
+ * Sweeps the thread count from 1 to maxThreads.
+ * @param numSims Total simulations (strong) or simulations per thread (weak).
+ * @param trials Timed trials per thread count; the median is reported.
+ * @param makeSimulation Callable (int runs) returning the simulation.
+ */
+template <typename MakeSimulation>
+std::vector<Point> sweep(Mode mode, int maxThreads, int numSims, int chunk, int trials, const std::vector<int>& workerCpus,
+		const std::vector<std::string>& added, MakeSimulation makeSimulation) {
+	std::vector<Point> points {};
+	for (int threads {1}; threads <= maxThreads; threads++) {
+		std::vector<int> runsPerThread(threads, numSims);
+		if (mode == Mode::Strong) {
+			for (int i {0}; i < threads; i++) {
+				runsPerThread[i] = numSims / threads + (i == 0 ? numSims % threads : 0);
+			}
+		}
+		Point point {threads, added[threads - 1], {}, 0};
+		for (int runs : runsPerThread) {
+			point.samples += runs;
+		}
+		for (int trial {0}; trial < trials; trial++) {
+			point.seconds.push_back(runTrial(threads, runsPerThread, chunk, workerCpus, makeSimulation));
+		}
+		points.push_back(point);
+	}
+	return points;
+}
+
+/**
+ * @return The speedup over one thread: T1 / Tp for strong scaling, throughput ratio for weak scaling.
+ */
+inline double getSpeedup(Mode mode, const Point& base, const Point& point) {
+	return mode == Mode::Strong ? base.getMedianSeconds() / point.getMedianSeconds() : point.getSamplesPerSecond() / base.getSamplesPerSecond();
+}
+
+/**
+ * @return The parallel efficiency, speedup / threads (T1 / Tp for weak scaling).
+ */
+inline double getEfficiency(Mode mode, const Point& base, const Point& point) {
+	return getSpeedup(mode, base, point) / point.threads;
+}
+
+// an efficiency drop of this much from one thread count to the next is flagged as a knee
+constexpr double kKneeDrop {0.1};
+
+inline void printTable(std::ostream& out, const std::string& simulationName, Mode mode, const std::vector<Point>& points) {
+	out << "Scaling (" << getModeName(mode) << ") of " << simulationName << ":" << std::endl;
+	out << std::setw(8) << "threads" << std::setw(8) << "added" << std::setw(14) << "median s" << std::setw(14) << "min s"
+		<< std::setw(16) << "samples/sec" << std::setw(16) << "per thread" << std::setw(10) << "speedup" << std::setw(12) << "efficiency" << std::endl;
+	double previousEfficiency {1};
+	for (const auto& point : points) {
+		const double efficiency {getEfficiency(mode, points.front(), point)};
+		out << std::setw(8) << point.threads << std::setw(8) << point.added << std::setw(14) << point.getMedianSeconds() << std::setw(14) << point.getMinSeconds()
+			<< std::setw(16) << point.getSamplesPerSecond() << std::setw(16) << point.getSamplesPerSecond() / point.threads
+			<< std::setw(10) << getSpeedup(mode, points.front(), point) << std::setw(12) << efficiency
+			<< (previousEfficiency - efficiency > kKneeDrop ? "  <- knee" : "") << std::endl;
+		previousEfficiency = efficiency;
+	}
+}
+
+inline void writeCsvHeader(std::ostream& out) {
+	out << "simulation,mode,threads,added,trials,median_seconds,min_seconds,samples,samples_per_second,samples_per_second_per_thread,speedup,efficiency\n";
+}
+
+inline void writeCsvRows(std::ostream& out, const std::string& simulationName, Mode mode, const std::vector<Point>& points) {
+	for (const auto& point : points) {
+		out << simulationName << ',' << getModeName(mode) << ',' << point.threads << ',' << point.added << ',' << point.seconds.size()
+			<< ',' << point.getMedianSeconds() << ',' << point.getMinSeconds() << ',' << point.samples << ',' << point.getSamplesPerSecond()
+			<< ',' << point.getSamplesPerSecond() / point.threads << ',' << getSpeedup(mode, points.front(), point)
+			<< ',' << getEfficiency(mode, points.front(), point) << '\n';
+	}
+}
+
+} // namespace scaling
+
+#endif
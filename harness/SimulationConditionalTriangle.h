@@ -0,0 +1,25 @@
+#ifndef SIMULATION_CONDITIONAL_TRIANGLE_H
+#define SIMULATION_CONDITIONAL_TRIANGLE_H
+
+#include <concepts>
+
+#include "simulation/Accumulators.h"
+#include "simulation/Kernels.h"
+#include "simulation/Layouts.h"
+#include "simulation/SampleSource.h"
+#include "simulation/Simulation.h"
+
+/**
+ * @brief Conditional Monte Carlo triangle simulation
+ * Works on exactly 3 point polygons, like Eugene4.  Only two vertices are sampled; the expected
+ * ratio over the third, uniform vertex is computed in closed form (conditionalTriangleRatio).
+ * This is the Rao-Blackwellization of the plain estimator: same mean, lower variance per sample,
+ * and 4 instead of 6 random numbers per sample.
+ */
+template <std::floating_point FloatType, typename Source = simulation::UniformSampleSource<FloatType>,
+	typename Accumulator = simulation::SumAccumulator<FloatType>>
+	requires simulation::SampleSource<Source, FloatType>
+using SimulationConditionalTriangle = simulation::Simulation<FloatType, Source, simulation::PerSampleLayout<FloatType>,
+	simulation::ConditionalTriangleKernel, Accumulator>;
+
+#endif
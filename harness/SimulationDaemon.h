@@ -0,0 +1,619 @@
+#ifndef SIMULATION_DAEMON_H
+#define SIMULATION_DAEMON_H
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cerrno>
+#include <cmath>
+#include <csignal>
+#include <cstdint>
+#include <cstring>
+#include <fcntl.h>
+#include <iomanip>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <poll.h>
+#include <sstream>
+#include <string>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <type_traits>
+#include <unistd.h>
+#include <utility>
+#include <vector>
+
+#include "simulation/AsyncEngine.h"
+
+/**
+ * `main serve <socket>`: a long-running simulator that takes jobs over a Unix domain socket, so
+ * that callers with many small jobs pay neither the process start nor the topology parsing and
+ * thread creation of `main` for every one.
+ *
+ * The protocol is JSON lines: one flat object per line in each direction, e.g.
+ *   {"id": 7, "simulation": "mc", "ngon": 3, "n": 100000, "seed": 42}
+ *   {"id": 7, "ok": true, "mean": 0.3055..., "standardError": null, "n": 100000, "slices": 2, "seconds": 0.0009}
+ * A connection may have several jobs in flight; their results come back as they finish, tagged
+ * with the id.  {"command": "stats"} returns the pool's job count and latency percentiles.
+ *
+ * The jobs run on simulation::AsyncEngine, with workers started once, pinned, each with its own
+ * memory pool.  Jobs are cut into slices that the workers take in turn, so every job in flight gets
+ * an equal share of the pool: a small job waits for at most one slice per worker, however large the
+ * jobs ahead of it.  With a seed the result does not depend on the worker count or the other jobs;
+ * with a precision the job stops once its standard error is below it, and n is only the upper bound
+ * (the stopping point, and so the result, then depends on the timing even with a seed).
+ */
+namespace simulation_daemon {
+
+constexpr std::size_t kMaxLineBytes {4096};
+// a job keeps one sum per slice
+constexpr std::int64_t kMaxRuns {std::int64_t {1} << 40};
+constexpr std::size_t kLatencyWindow {4096};
+
+struct Request {
+	std::int64_t id {0};
+	std::string command {};
+	std::string simulation {"adrian1"};
+	int ngon {3};
+	std::int64_t n {1000000};
+	std::optional<std::uint64_t> seed {};
+	double precision {0};
+};
+
+/**
+ * Parses one flat JSON object of string, number, boolean and null values.
+ * @return The request, or std::nullopt with the reason in error.
+ */
+inline std::optional<Request> parseRequest(const std::string& line, std::string& error) {
+	Request request {};
+	std::size_t i {0};
+	auto skipSpace = [&] {
+		while (i < line.size() && std::isspace(static_cast<unsigned char>(line[i]))) {
+			i++;
+		}
+	};
+	auto parseString = [&](std::string& out) {
+		if (i >= line.size() || line[i] != '"') {
+			return false;
+		}
+		for (i++; i < line.size() && line[i] != '"'; i++) {
+			if (line[i] == '\\' && i + 1 < line.size()) {
+				i++;
+			}
+			out += line[i];
+		}
+		return i++ < line.size();
+	};
+	skipSpace();
+	if (i >= line.size() || line[i++] != '{') {
+		error = "expected a JSON object";
+		return std::nullopt;
+	}
+	skipSpace();
+	while (i < line.size() && line[i] != '}') {
+		std::string key {};
+		if (!parseString(key)) {
+			error = "expected a key";
+			return std::nullopt;
+		}
+		skipSpace();
+		if (i >= line.size() || line[i++] != ':') {
+			error = "expected ':' after \"" + key + "\"";
+			return std::nullopt;
+		}
+		skipSpace();
+		std::string text {};
+		bool isString {i < line.size() && line[i] == '"'};
+		if (isString) {
+			if (!parseString(text)) {
+				error = "unterminated string for \"" + key + "\"";
+				return std::nullopt;
+			}
+		} else {
+			while (i < line.size() && line[i] != ',' && line[i] != '}' && !std::isspace(static_cast<unsigned char>(line[i]))) {
+				text += line[i++];
+			}
+		}
+		try {
+			if (key == "id") {
+				request.id = std::stoll(text);
+			} else if (key == "command") {
+				request.command = text;
+			} else if (key == "simulation") {
+				request.simulation = text;
+			} else if (key == "ngon") {
+				request.ngon = std::stoi(text);
+			} else if (key == "n") {
+				// read as a double, so that 1e6 works; the conversion is only defined for an integer in range
+				const double n {std::stod(text)};
+				if (!std::isfinite(n) || n != std::floor(n) || std::fabs(n) >= 0x1p63) {
+					error = "invalid value for \"n\": " + text + " (not a 64-bit integer)";
+					return std::nullopt;
+				}
+				request.n = static_cast<std::int64_t>(n);
+			} else if (key == "seed") {
+				if (text != "null") {
+					request.seed = std::stoull(text);
+				}
+			} else if (key == "precision") {
+				request.precision = std::stod(text);
+			} else {
+				error = "unknown key \"" + key + "\"";
+				return std::nullopt;
+			}
+		} catch (const std::exception&) {
+			error = "invalid value for \"" + key + "\": " + text;
+			return std::nullopt;
+		}
+		skipSpace();
+		if (i < line.size() && line[i] == ',') {
+			i++;
+			skipSpace();
+		}
+	}
+	if (i >= line.size()) {
+		error = "unterminated object";
+		return std::nullopt;
+	}
+	return request;
+}
+
+/**
+ * Appends "key": value to a JSON object under construction; NaN becomes null.
+ */
+class JsonWriter {
+public:
+	JsonWriter() {
+		m_out << std::setprecision(15) << '{';
+	}
+
+	template <typename T>
+	JsonWriter& add(const std::string& key, const T& value) {
+		m_out << (m_first ? "" : ", ") << '"' << key << "\": ";
+		m_first = false;
+		if constexpr (std::is_same_v<T, bool>) {
+			m_out << (value ? "true" : "false");
+		} else if constexpr (std::is_floating_point_v<T>) {
+			if (std::isfinite(value)) {
+				m_out << value;
+			} else {
+				m_out << "null";
+			}
+		} else if constexpr (std::is_arithmetic_v<T>) {
+			m_out << value;
+		} else {
+			m_out << '"';
+			for (char c : std::string {value}) {
+				if (c == '"' || c == '\\') {
+					m_out << '\\';
+				}
+				m_out << c;
+			}
+			m_out << '"';
+		}
+		return *this;
+	}
+
+	std::string str() const {
+		return m_out.str() + "}\n";
+	}
+
+private:
+	std::ostringstream m_out {};
+	bool m_first {true};
+};
+
+inline std::string formatError(std::int64_t id, const std::string& message) {
+	return JsonWriter {}.add("id", id).add("ok", false).add("error", message).str();
+}
+
+/**
+ * A client connection.  The daemon never writes from a worker: responses are queued in the
+ * connection's outbox and the server thread writes them when the socket takes them, so a client that
+ * reads slowly holds up neither the workers nor the other clients.  The descriptor stays open until
+ * the last job of the connection has answered.
+ */
+class Connection {
+public:
+	/**
+	 * @param wakeFd Written a byte whenever the outbox fills, to wake the server thread's poll(); -1
+	 *        for a client, which only uses send().
+	 */
+	explicit Connection(int fd, int wakeFd = -1) :
+		m_fd {fd},
+		m_wakeFd {wakeFd}
+	{}
+
+	~Connection() {
+		close(m_fd);
+	}
+
+	Connection(const Connection&) = delete;
+	Connection& operator=(const Connection&) = delete;
+
+	int getFd() const {
+		return m_fd;
+	}
+
+	/**
+	 * Writes the whole message, blocking until the socket has taken it.
+	 * @return false once the peer is gone.
+	 */
+	bool send(const std::string& message) {
+		std::lock_guard lock {m_outputMutex};
+		const char* p {message.data()};
+		std::size_t left {message.size()};
+		while (left > 0) {
+			const ssize_t written {::send(m_fd, p, left, MSG_NOSIGNAL)};
+			if (written < 0) {
+				if (errno == EINTR) {
+					continue;
+				}
+				return false;
+			}
+			p += written;
+			left -= static_cast<std::size_t>(written);
+		}
+		return true;
+	}
+
+	/**
+	 * Queues the message for the server thread, from any thread.  Once the server has stopped (detach)
+	 * it is written straight away as far as the socket takes it without blocking, and the rest dropped.
+	 */
+	void post(const std::string& message) {
+		std::lock_guard lock {m_outputMutex};
+		if (m_peerGone) {
+			return;
+		}
+		const bool wasEmpty {m_output.empty()};
+		m_output += message;
+		if (m_wakeFd < 0) {
+			writeOutput();
+			m_output.clear();
+		} else if (wasEmpty) {
+			const char byte {0};
+			// the pipe is non-blocking; if it is full the server is awake anyway
+			[[maybe_unused]] const ssize_t written {write(m_wakeFd, &byte, 1)};
+		}
+	}
+
+	/**
+	 * Writes as much of the outbox as the socket takes without blocking.
+	 * @return false once the peer is gone.
+	 */
+	bool flush() {
+		std::lock_guard lock {m_outputMutex};
+		return writeOutput();
+	}
+
+	bool hasOutput() {
+		std::lock_guard lock {m_outputMutex};
+		return !m_output.empty();
+	}
+
+	/**
+	 * Stops waking the server, which is about to close its end of the pipe, and flushes what it can.
+	 */
+	void detach() {
+		std::lock_guard lock {m_outputMutex};
+		m_wakeFd = -1;
+		writeOutput();
+		m_output.clear();
+	}
+
+	/**
+	 * A job of the connection was submitted; finishJob() once its response is posted.
+	 */
+	void startJob() {
+		m_jobsInFlight++;
+	}
+
+	void finishJob() {
+		m_jobsInFlight--;
+	}
+
+	/**
+	 * @return Whether the connection can go: nothing more to read, no job to answer, nothing to write.
+	 */
+	bool isDone() {
+		// jobs first: a job posts before it finishes, so its response shows in the outbox
+		return m_readClosed && m_jobsInFlight == 0 && !hasOutput();
+	}
+
+	/**
+	 * Stops reading; the jobs in flight still answer.
+	 */
+	void closeRead() {
+		shutdown(m_fd, SHUT_RD);
+		m_readClosed = true;
+	}
+
+	bool isReadClosed() const {
+		return m_readClosed;
+	}
+
+	std::string& getInput() {
+		return m_input;
+	}
+
+private:
+	int m_fd;
+	std::mutex m_outputMutex {};
+	// guarded by m_outputMutex
+	int m_wakeFd;
+	std::string m_output {};
+	bool m_peerGone {false};
+	std::atomic<int> m_jobsInFlight {0};
+	// only touched by the server thread
+	std::string m_input {};
+	bool m_readClosed {false};
+
+	// with m_outputMutex held
+	bool writeOutput() {
+		std::size_t done {0};
+		while (done < m_output.size()) {
+			const ssize_t written {::send(m_fd, m_output.data() + done, m_output.size() - done, MSG_NOSIGNAL | MSG_DONTWAIT)};
+			if (written < 0) {
+				if (errno == EINTR) {
+					continue;
+				}
+				if (errno == EAGAIN || errno == EWOULDBLOCK) {
+					break;
+				}
+				m_peerGone = true;
+				m_output.clear();
+				return false;
+			}
+			done += static_cast<std::size_t>(written);
+		}
+		m_output.erase(0, done);
+		return true;
+	}
+};
+
+/**
+ * The daemon's side of the engine (simulation/AsyncEngine.h), which runs the jobs on its own pinned
+ * workers: requests go in, responses go out on the connection, and the job latencies are kept for
+ * the stats command.
+ * @tparam MakeSimulation Callable (const std::string& name, int runs, int ngon) returning the simulation.
+ */
+template <typename MakeSimulation>
+class Pool {
+public:
+	using Engine = simulation::AsyncEngine<MakeSimulation>;
+
+	/**
+	 * Starts the workers.
+	 * @param cpus CPUs to pin the workers to, in order; empty to leave them unpinned.
+	 */
+	Pool(int threads, const std::vector<int>& cpus, MakeSimulation makeSimulation) :
+		m_threads {threads},
+		m_engine {threads, cpus, std::move(makeSimulation)}
+	{}
+
+	Pool(const Pool&) = delete;
+	Pool& operator=(const Pool&) = delete;
+
+	/**
+	 * Runs the job; the worker that finishes it posts the response to the connection's outbox.
+	 */
+	void submit(const Request& request, std::shared_ptr<Connection> connection) {
+		const simulation::JobSpec spec {request.simulation, request.ngon, request.n, request.seed, request.precision};
+		connection->startJob();
+		m_engine.submit(spec, {}, [this, request, connection = std::move(connection)](const simulation::JobResult& result) {
+			addLatency(result.seconds);
+			if (result.status == simulation::JobStatus::Failed) {
+				connection->post(formatError(request.id, result.error));
+			} else {
+				connection->post(JsonWriter {}.add("id", request.id).add("ok", true).add("simulation", request.simulation)
+					.add("ngon", request.ngon).add("n", result.runs).add("mean", result.mean).add("standardError", result.standardError)
+					.add("slices", result.slices).add("seconds", result.seconds).str());
+			}
+			connection->finishJob();
+		});
+	}
+
+	std::string getStats() {
+		std::int64_t finishedJobs {0};
+		std::vector<double> latencies {};
+		{
+			std::lock_guard lock {m_mutex};
+			finishedJobs = m_finishedJobs;
+			latencies = m_latencies;
+		}
+		std::sort(latencies.begin(), latencies.end());
+		auto percentile = [&](double p) {
+			return latencies.empty() ? std::numeric_limits<double>::quiet_NaN()
+				: latencies[static_cast<std::size_t>(p * static_cast<double>(latencies.size() - 1))];
+		};
+		return JsonWriter {}.add("ok", true).add("workers", m_threads).add("jobs", finishedJobs)
+			.add("activeJobs", m_engine.getActiveJobs()).add("p50Ms", percentile(0.5)).add("p99Ms", percentile(0.99)).str();
+	}
+
+private:
+	int m_threads;
+	std::mutex m_mutex {};
+	std::int64_t m_finishedJobs {0};
+	std::vector<double> m_latencies {}; // milliseconds, ring of the last kLatencyWindow jobs
+	// last, so that it is destroyed first and the jobs still running report while the latencies are there
+	Engine m_engine;
+
+	void addLatency(double seconds) {
+		std::lock_guard lock {m_mutex};
+		if (m_latencies.size() < kLatencyWindow) {
+			m_latencies.push_back(seconds * 1e3);
+		} else {
+			m_latencies[m_finishedJobs % kLatencyWindow] = seconds * 1e3;
+		}
+		m_finishedJobs++;
+	}
+};
+
+inline volatile std::sig_atomic_t stopRequested {0};
+
+inline void installStopHandler() {
+	struct sigaction action {};
+	action.sa_handler = [](int) { stopRequested = 1; };
+	sigemptyset(&action.sa_mask);
+	// no SA_RESTART: poll() returns, so the server notices
+	action.sa_flags = 0;
+	sigaction(SIGINT, &action, nullptr);
+	sigaction(SIGTERM, &action, nullptr);
+}
+
+/**
+ * Binds a listening Unix domain socket, replacing a stale socket file.
+ * @return The descriptor, or -1 with the reason in error.
+ */
+inline int listenOn(const std::string& path, std::string& error) {
+	sockaddr_un address {};
+	address.sun_family = AF_UNIX;
+	if (path.size() >= sizeof(address.sun_path)) {
+		error = path + ": socket path too long";
+		return -1;
+	}
+	path.copy(address.sun_path, sizeof(address.sun_path) - 1);
+	const int fd {socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0)};
+	if (fd < 0) {
+		error = std::string {"socket: "} + std::strerror(errno);
+		return -1;
+	}
+	unlink(path.c_str());
+	if (bind(fd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0 || listen(fd, SOMAXCONN) != 0) {
+		error = path + ": " + std::strerror(errno);
+		close(fd);
+		return -1;
+	}
+	return fd;
+}
+
+/**
+ * @return A connected descriptor, or -1 with the reason in error.
+ */
+inline int connectTo(const std::string& path, std::string& error) {
+	sockaddr_un address {};
+	address.sun_family = AF_UNIX;
+	if (path.size() >= sizeof(address.sun_path)) {
+		error = path + ": socket path too long";
+		return -1;
+	}
+	path.copy(address.sun_path, sizeof(address.sun_path) - 1);
+	const int fd {socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0)};
+	if (fd < 0 || connect(fd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0) {
+		error = path + ": " + std::strerror(errno);
+		if (fd >= 0) {
+			close(fd);
+		}
+		return -1;
+	}
+	return fd;
+}
+
+/**
+ * Accepts connections and reads requests until SIGINT or SIGTERM; the pool answers them.  Only this
+ * thread writes to the sockets, never blocking: it flushes the outboxes when poll() says they can
+ * take more, and the workers wake it through a pipe when they post a response.
+ * @param validate Callable (const Request&) returning an empty string or why the job cannot run.
+ * @return false, with the reason in error, if the server could not start.
+ */
+template <typename MakeSimulation, typename Validate>
+bool serve(int listenFd, Pool<MakeSimulation>& pool, Validate validate, std::string& error) {
+	int wakePipe[2];
+	if (pipe2(wakePipe, O_NONBLOCK | O_CLOEXEC) != 0) {
+		error = std::string {"pipe: "} + std::strerror(errno);
+		return false;
+	}
+	std::vector<std::shared_ptr<Connection>> connections {};
+	std::vector<pollfd> fds {};
+	while (!stopRequested) {
+		fds.assign({pollfd {listenFd, POLLIN, 0}, pollfd {wakePipe[0], POLLIN, 0}});
+		for (const auto& connection : connections) {
+			const short events = static_cast<short>((connection->isReadClosed() ? 0 : POLLIN) | (connection->hasOutput() ? POLLOUT : 0));
+			// a negative descriptor is skipped: once a connection is only waiting for its jobs, a hung-up
+			// peer would otherwise wake poll() on every pass
+			fds.push_back(pollfd {events != 0 ? connection->getFd() : -1, events, 0});
+		}
+		// with a timeout, for a signal that lands between the check and poll()
+		if (poll(fds.data(), fds.size(), 500) < 0) {
+			continue;
+		}
+		if (fds[1].revents & POLLIN) {
+			char drained[256];
+			while (read(wakePipe[0], drained, sizeof(drained)) > 0) {
+			}
+		}
+		std::vector<bool> gone(connections.size(), false);
+		for (std::size_t c {0}; c < connections.size(); c++) {
+			Connection& connection {*connections[c]};
+			if (connection.isReadClosed() || !(fds[c + 2].revents & (POLLIN | POLLHUP | POLLERR))) {
+				continue;
+			}
+			char buffer[4096];
+			const ssize_t received {recv(connection.getFd(), buffer, sizeof(buffer), 0)};
+			if (received <= 0) {
+				if (received == 0 || errno != EINTR) {
+					connection.closeRead();
+				}
+				continue;
+			}
+			std::string& input {connection.getInput()};
+			input.append(buffer, static_cast<std::size_t>(received));
+			for (std::size_t end {input.find('\n')}; end != std::string::npos; end = input.find('\n')) {
+				const std::string line {input.substr(0, end)};
+				input.erase(0, end + 1);
+				if (line.find_first_not_of(" \t\r") == std::string::npos) {
+					continue;
+				}
+				std::string requestError {};
+				auto request = parseRequest(line, requestError);
+				if (request && request->command == "stats") {
+					connection.post(pool.getStats());
+					continue;
+				}
+				if (request && !request->command.empty()) {
+					requestError = "unknown command \"" + request->command + "\"";
+				} else if (request) {
+					requestError = validate(*request);
+				}
+				if (!requestError.empty()) {
+					connection.post(formatError(request ? request->id : 0, requestError));
+					continue;
+				}
+				pool.submit(*request, connections[c]);
+			}
+			if (input.size() > kMaxLineBytes) {
+				connection.post(formatError(0, "request line too long"));
+				connection.closeRead();
+			}
+		}
+		// every outbox, not only those poll() reported writable: most responses go out on the pass that queued them
+		for (std::size_t c {0}; c < connections.size(); c++) {
+			gone[c] = !connections[c]->flush();
+		}
+		for (std::size_t c {connections.size()}; c-- > 0;) {
+			// jobs still in flight keep the Connection alive, and post nothing once the peer is gone
+			if (gone[c] || connections[c]->isDone()) {
+				connections.erase(connections.begin() + static_cast<std::ptrdiff_t>(c));
+			}
+		}
+		if (fds[0].revents & POLLIN) {
+			const int fd {accept4(listenFd, nullptr, nullptr, SOCK_CLOEXEC)};
+			if (fd >= 0) {
+				connections.push_back(std::make_shared<Connection>(fd, wakePipe[1]));
+			}
+		}
+	}
+	for (const auto& connection : connections) {
+		connection->detach();
+	}
+	close(wakePipe[0]);
+	close(wakePipe[1]);
+	return true;
+}
+
+} // namespace simulation_daemon
+
+#endif
@@ -0,0 +1,23 @@
+#ifndef SIMULATION_SAMPLED_H
+#define SIMULATION_SAMPLED_H
+
+#include <concepts>
+
+#include "simulation/Accumulators.h"
+#include "simulation/Kernels.h"
+#include "simulation/Layouts.h"
+#include "simulation/SampleSource.h"
+#include "simulation/Simulation.h"
+
+/**
+ * @brief Sample-source driven simulation
+ * Pulls one 2*ngon-dimensional point per polygon from a SampleSource and evaluates it with the
+ * Eugene4 triangle formula (ngon == 3) or the shoelace path (any other ngon).  Swapping the source
+ * switches between plain Monte Carlo and quasi-Monte Carlo without touching the kernels.
+ */
+template <std::floating_point FloatType, typename Source, typename Accumulator = simulation::SumAccumulator<FloatType>>
+	requires simulation::SampleSource<Source, FloatType>
+using SimulationSampled = simulation::Simulation<FloatType, Source, simulation::PerSampleLayout<FloatType>,
+	simulation::PolygonKernel, Accumulator>;
+
+#endif
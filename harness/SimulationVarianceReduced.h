@@ -0,0 +1,151 @@
+#ifndef SIMULATION_VARIANCE_REDUCED_H
+#define SIMULATION_VARIANCE_REDUCED_H
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <concepts>
+#include <random>
+
+#include "common/PhaseProfiler.h"
+#include "simulation/Estimators.h"
+#include "simulation/ISimulation.h"
+#include "simulation/SampleSource.h"
+
+/**
+ * @brief Variance-reduced simulation
+ * Same polygons as the shoelace path, but the mean is formed by a selectable estimator:
+ *  - mean: the raw sample mean, for reference.
+ *  - antithetic: every polygon is paired with a copy whose vertex 0 is reflected to (3 - x, 3 - y);
+ *    the bounding box of the other vertices is shared by the pair.  Reflecting all coordinates
+ *    would be useless here, since a point reflection leaves the ratio unchanged.
+ *  - control: the polygon area is the control, with E[area] = 11/144 for triangles and
+ *    E[area^2] = ngon/288 otherwise (unit box); beta is estimated online per thread.
+ *    The bounding box extents are no use as a control, the ratio is uncorrelated with them.
+ */
+template <std::floating_point FloatType, typename Engine = std::mt19937>
+class SimulationVarianceReduced : public simulation::ISimulation<FloatType> {
+public:
+
+	SimulationVarianceReduced(int runCount, int polygonPointCount = 3, simulation::Estimator estimator = simulation::Estimator::Mean) :
+		simulation::ISimulation<FloatType>(runCount, polygonPointCount),
+		m_estimator {estimator},
+		m_source {2 * polygonPointCount}
+	{}
+
+
+	FloatType getAverageRatio() const override {
+		assert(simulation::ISimulation<FloatType>::getRunCount() > 0 && "Must run at least once.");
+		return m_stats.estimate;
+	}
+
+	void run() override {
+		switch (m_estimator) {
+			case simulation::Estimator::Mean:
+				runWith<simulation::Estimator::Mean>();
+				break;
+			case simulation::Estimator::Antithetic:
+				runWith<simulation::Estimator::Antithetic>();
+				break;
+			case simulation::Estimator::ControlVariate:
+				runWith<simulation::Estimator::ControlVariate>();
+				break;
+		}
+	}
+
+	FloatType getSumOfRatios() const override {
+		return m_stats.estimate * m_stats.count;
+	}
+
+	const simulation::EstimatorStats& getEstimatorStats() const {
+		return m_stats;
+	}
+
+private:
+	simulation::Estimator m_estimator;
+	simulation::UniformSampleSource<FloatType, Engine> m_source;
+	simulation::EstimatorStats m_stats {};
+
+	/**
+	 * Signed doubled shoelace contribution of vertex i with its neighbours.
+	 */
+	static FloatType vertexCross(FloatType prevX, FloatType prevY, FloatType x, FloatType y, FloatType nextX, FloatType nextY) {
+		return (prevX * y - x * prevY) + (x * nextY - nextX * y);
+	}
+
+	template <simulation::Estimator E>
+	void runWith() {
+		// the source's "rng" and the "reduce" below nest inside
+		PROFILE_PHASE("kernel");
+		const auto runCount {simulation::ISimulation<FloatType>::getRunCount()};
+		const auto pointCount {simulation::ISimulation<FloatType>::getPolygonPointCount()};
+
+		simulation::RunningStats<FloatType> plain {};
+		simulation::RunningStats<FloatType> pairs {};
+		simulation::ControlVariateStats<FloatType> control {};
+		const FloatType expectedControl {static_cast<FloatType>(pointCount == 3 ? simulation::kExpectedTriangleArea : simulation::expectedSquaredPolygonArea(pointCount))};
+
+		for (int r {0}; r < runCount; ++r) {
+			const FloatType* coords {m_source.next()};
+
+			// bounding box of vertices 1..n-1, shared by an antithetic pair
+			FloatType bottomLeftX {coords[2]};
+			FloatType bottomLeftY {coords[3]};
+			FloatType topRightX {coords[2]};
+			FloatType topRightY {coords[3]};
+			FloatType area {0};
+			for (int i {0}; i < pointCount; i++) {
+				const int next {i + 1 == pointCount ? 0 : i + 1};
+				area += coords[2 * i] * coords[2 * next + 1] - coords[2 * next] * coords[2 * i + 1];
+				if (i > 0) {
+					bottomLeftX = std::min(bottomLeftX, coords[2 * i]);
+					bottomLeftY = std::min(bottomLeftY, coords[2 * i + 1]);
+					topRightX = std::max(topRightX, coords[2 * i]);
+					topRightY = std::max(topRightY, coords[2 * i + 1]);
+				}
+			}
+
+			const FloatType x0 {coords[0]};
+			const FloatType y0 {coords[1]};
+			const FloatType boundingBoxArea {(std::max(topRightX, x0) - std::min(bottomLeftX, x0)) * (std::max(topRightY, y0) - std::min(bottomLeftY, y0))};
+			const FloatType polygonArea {std::abs(area) / static_cast<FloatType>(2.0)};
+			const FloatType ratio {polygonArea / boundingBoxArea};
+
+			if constexpr (E == simulation::Estimator::Mean) {
+				plain.add(ratio);
+			} else if constexpr (E == simulation::Estimator::Antithetic) {
+				const FloatType prevX {coords[2 * (pointCount - 1)]};
+				const FloatType prevY {coords[2 * (pointCount - 1) + 1]};
+				const FloatType x0Reflected {static_cast<FloatType>(3.0) - x0};
+				const FloatType y0Reflected {static_cast<FloatType>(3.0) - y0};
+				const FloatType reflectedArea {area - vertexCross(prevX, prevY, x0, y0, coords[2], coords[3])
+					+ vertexCross(prevX, prevY, x0Reflected, y0Reflected, coords[2], coords[3])};
+				const FloatType reflectedBoundingBoxArea {(std::max(topRightX, x0Reflected) - std::min(bottomLeftX, x0Reflected))
+					* (std::max(topRightY, y0Reflected) - std::min(bottomLeftY, y0Reflected))};
+				const FloatType reflectedRatio {std::abs(reflectedArea) / static_cast<FloatType>(2.0) / reflectedBoundingBoxArea};
+				plain.add(ratio);
+				pairs.add((ratio + reflectedRatio) / static_cast<FloatType>(2.0));
+			} else {
+				control.add(ratio, pointCount == 3 ? polygonArea : polygonArea * polygonArea);
+			}
+		}
+
+		PROFILE_PHASE("reduce");
+		m_stats.count = runCount;
+		if constexpr (E == simulation::Estimator::Mean) {
+			m_stats.estimate = plain.getMean();
+			m_stats.plainVariance = plain.getVariance();
+			m_stats.estimatorVariance = plain.getVariance();
+		} else if constexpr (E == simulation::Estimator::Antithetic) {
+			m_stats.estimate = pairs.getMean();
+			m_stats.plainVariance = plain.getVariance();
+			m_stats.estimatorVariance = pairs.getVariance();
+		} else {
+			m_stats.estimate = control.getEstimate(expectedControl);
+			m_stats.plainVariance = control.getPlainVariance();
+			m_stats.estimatorVariance = control.getVariance();
+		}
+	}
+};
+
+#endif
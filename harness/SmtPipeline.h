@@ -0,0 +1,115 @@
+#ifndef SMT_PIPELINE_H
+#define SMT_PIPELINE_H
+
+#include <cstdint>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "common/Concurrency.h"
+#include "common/SpscRing.h"
+#include "common/Timer.h"
+#include "simulation/ISimulation.h"
+#include "simulation/RingSampleSource.h"
+
+/**
+ * Producer/consumer split of a simulation across the two hardware threads of a core: the SMT
+ * sibling runs the (integer heavy) random number generator and streams uniform coordinates through
+ * an SpscRing, while the primary runs the (floating point heavy) geometry kernel.
+ */
+namespace smt_pipeline {
+
+// 8 blocks of 1024 doubles: 64 KB in flight, which stays within the L2 the two siblings share
+constexpr std::size_t kRingBlockCount {8};
+constexpr std::size_t kRingBlockSize {1024};
+
+/**
+ * Returns the (primary, sibling) logical CPU of every physical core, in physical core order.
+ * The sibling is -1 for cores without SMT (or whose sibling is not allowed).
+ * @param coreMapping Physical core to allowed logical CPU mapping, from Concurrency::get_allowed_physical_core_mapping().
+ */
+inline std::vector<std::pair<int, int>> get_smt_cpu_pairs(const std::map<std::pair<int, int>, std::vector<int>>& coreMapping) {
+	std::vector<std::pair<int, int>> pairs {};
+	for (const auto& [core, logicalCpus] : coreMapping) {
+		pairs.emplace_back(logicalCpus.front(), logicalCpus.size() > 1 ? logicalCpus[1] : -1);
+	}
+	return pairs;
+}
+
+struct ThroughputResult {
+	double ratiosSum {0};
+	std::int64_t runCount {0};
+	double seconds {0};
+
+	double getSamplesPerSecond() const {
+		return runCount / seconds;
+	}
+};
+
+/**
+ * Runs one simulation per worker, worker i on the primary of physical core i + 1 (core 0 is left
+ * to the OS, as in the harness), optionally with an RNG producer on that core's sibling.
+ * @param makeSimulation Callable (int runs, SpscRing<double>* ring) returning the simulation;
+ *        ring is nullptr when running without producers.
+ */
+template <typename MakeSimulation>
+ThroughputResult run(int numThreads, int numRuns, const std::vector<std::pair<int, int>>& cpuPairs, bool split, MakeSimulation makeSimulation) {
+	std::vector<std::unique_ptr<SpscRing<double>>> rings {};
+	std::vector<std::thread> producers {};
+	std::vector<std::thread> workers {};
+	std::vector<std::pair<double, int>> results(numThreads);
+
+	const auto cpuPair = [&cpuPairs](int i) {
+		return cpuPairs.empty() ? std::make_pair(-1, -1) : cpuPairs[(i + 1) % cpuPairs.size()];
+	};
+
+	Timer timer {};
+	if (split) {
+		for (int i {0}; i < numThreads; i++) {
+			rings.push_back(std::make_unique<SpscRing<double>>(kRingBlockCount, kRingBlockSize));
+			producers.emplace_back([ring = rings.back().get(), sibling = cpuPair(i).second]() {
+				if (sibling >= 0) {
+					Concurrency::pin_to_core(sibling);
+				}
+				simulation::produceUniformBlocks<double>(*ring);
+			});
+		}
+	}
+	for (int i {0}; i < numThreads; i++) {
+		const int runs {numRuns / numThreads + (i == 0 ? numRuns % numThreads : 0)};
+		workers.emplace_back([i, runs, split, primary = cpuPair(i).first, &rings, &results, &makeSimulation]() {
+			if (primary >= 0) {
+				Concurrency::pin_to_core(primary);
+			}
+			auto sim = makeSimulation(runs, split ? rings[i].get() : nullptr);
+			sim->run();
+			results[i] = std::make_pair(sim->getSumOfRatios(), sim->getRunCount());
+		});
+	}
+	for (auto& worker : workers) {
+		worker.join();
+	}
+	timer.stop();
+
+	for (auto& ring : rings) {
+		ring->close();
+	}
+	for (auto& producer : producers) {
+		producer.join();
+	}
+
+	ThroughputResult result {};
+	for (const auto& [sum, count] : results) {
+		result.ratiosSum += sum;
+		result.runCount += count;
+	}
+	result.seconds = timer.getTimeElapsed().count();
+	return result;
+}
+
+} // namespace smt_pipeline
+
+#endif
@@ -1,30 +1,67 @@
 #include <algorithm>
 #include <array>
+#include <cmath>
+#include <chrono>
+#include <condition_variable>
 #include <cstdlib>
+#include <fstream>
 #include <iostream>
+#include <latch>
+#include <limits>
 #include <map>
 #include <memory>
+#include <memory_resource>
+#include <mutex>
+#include <optional>
 #include <pthread.h>
+#include <random>
 #include <sched.h>
 #include <stdexcept>
 #include <string>
 #include <string_view>
 #include <thread>
+#include <type_traits>
 #include <utility>
 #include <vector>
 
 #include <argparse/argparse.hpp>
 
 #include "common/Concurrency.h"
+#include "common/HugePageResource.h"
+#include "common/MemoryResource.h"
+#include "common/PerfCounters.h"
+#include "common/PhaseProfiler.h"
 #include "common/Timer.h"
+#include "common/TraceRecorder.h"
+#include "simulation/Accumulators.h"
+#include "simulation/Estimators.h"
 #include "simulation/ISimulation.h"
+#include "simulation/Layouts.h"
+#include "simulation/ParallelBackends.h"
+#include "simulation/ReplaySource.h"
+#include "simulation/SampleSource.h"
+#include "simulation/SlidingWindowSampleSource.h"
+#include "simulation/SobolSampleSource.h"
 
+#include "AllocationCounter.h"
+#include "AutoTuner.h"
+#include "EntropyGenerator.h"
+#include "LiveStats.h"
+#include "PolygonIngest.h"
+#include "RatioDistribution.h"
+#include "RatioDump.h"
+#include "ScalingDriver.h"
+#include "SimulationDaemon.h"
 #include "SimulationAdrian1.h"
+#include "SimulationConditionalTriangle.h"
 #include "SimulationEugene1.h"
 #include "SimulationEugene2.h"
 #include "SimulationEugene3.h"
 #include "SimulationEugene4.h"
 #include "SimulationEugene5.h"
+#include "SimulationSampled.h"
+#include "SimulationVarianceReduced.h"
+#include "SmtPipeline.h"
 
 // TODO: Change this to a constexpr function instead of macro for better safety
 #define VERBOSE_OUTPUT(msg) if (verbose) { std::cout << msg << std::endl; }
@@ -33,19 +70,226 @@
 
 #define ERROR_OUTPUT(msg) { std::cerr << msg << std::endl; }
 
+/**
+ * Options that only some of the simulations take.
+ */
+struct SimulationOptions {
+	simulation::Estimator estimator {simulation::Estimator::Mean}; // vr
+	int stride {1};                                                // eugene5
+	bool trackAutocorrelation {false};                             // eugene5
+	bool dump {false};                                             // all but vr: hand every ratio to the thread's dump sink
+	bool distribution {false};                                     // all but vr: hand every ratio to the thread's distribution sink
+	std::optional<simulation::EntropyFileHeader::Kind> replay {};  // draw from the thread's replay stream: words for all, coordinates for mc and conditional
+};
+
+/**
+ * Creates one of the policy-composed simulations with the given engine and accumulator.
+ * @return The simulation, or nullptr if the name is unknown or not composed of policies (vr).
+ */
+template <typename Engine, typename Accumulator>
+std::unique_ptr<simulation::ISimulation<double>> makeComposedSimulation(const std::string& simulationName, int numRuns, int ngon,
+		const SimulationOptions& options) {
+	if (simulationName == "adrian1") {
+		return std::make_unique<SimulationAdrian1<double, Engine, Accumulator>>(numRuns, ngon);
+	} else if (simulationName == "eugene1") {
+		return std::make_unique<SimulationEugene1<double, Engine, Accumulator>>(numRuns, ngon);
+	} else if (simulationName == "eugene2") {
+		return std::make_unique<SimulationEugene2<double, Engine, Accumulator>>(numRuns, ngon);
+	} else if (simulationName == "eugene3") {
+		return std::make_unique<SimulationEugene3<double, Engine, Accumulator>>(numRuns, ngon);
+	} else if (simulationName == "eugene4") {
+		return std::make_unique<SimulationEugene4<double, Engine, Accumulator>>(numRuns, ngon);
+	} else if (simulationName == "eugene5") {
+		simulation::SlidingWindowSampleSource<double, Engine> source {2 * ngon, options.stride, simulation::SimdLaneLayout<double>::lanes()};
+		return std::make_unique<SimulationEugene5<double, Engine, Accumulator>>(numRuns, ngon, std::move(source));
+	} else if (simulationName == "mc") {
+		return std::make_unique<SimulationSampled<double, simulation::UniformSampleSource<double, Engine>, Accumulator>>(numRuns, ngon);
+	} else if (simulationName == "sobol") {
+		// the scramble is all the randomness sobol has, so a replayed run takes its seed from the stream
+		std::uint32_t scrambleSeed {};
+		if constexpr (std::is_same_v<Engine, simulation::ReplayEngine>) {
+			scrambleSeed = simulation::ReplayEngine {}();
+		} else {
+			scrambleSeed = simulation::drawSeed();
+		}
+		return std::make_unique<SimulationSampled<double, simulation::SobolSampleSource<double>, Accumulator>>(numRuns, ngon,
+			simulation::SobolSampleSource<double> {simulation::PolygonKernel::dimension(ngon), scrambleSeed});
+	} else if (simulationName == "conditional") {
+		return std::make_unique<SimulationConditionalTriangle<double, simulation::UniformSampleSource<double, Engine>, Accumulator>>(numRuns, ngon);
+	}
+	return nullptr;
+}
+
+/**
+ * Creates a simulation drawing from the given engine.
+ * @return The simulation, or nullptr if the name is unknown.
+ */
+template <typename Engine>
+std::unique_ptr<simulation::ISimulation<double>> makeSimulationWithEngine(const std::string& simulationName, int numRuns, int ngon,
+		const SimulationOptions& options) {
+	if (simulationName == "vr") {
+		return std::make_unique<SimulationVarianceReduced<double, Engine>>(numRuns, ngon, options.estimator);
+	} else if (simulationName == "eugene5" && options.trackAutocorrelation) {
+		// windows k apart share coordinates as long as k * stride < 2 * ngon
+		simulation::SlidingWindowSampleSource<double, Engine> source {2 * ngon, options.stride, simulation::SimdLaneLayout<double>::lanes()};
+		return std::make_unique<SimulationEugene5<double, Engine, simulation::AutocorrelationAccumulator<double>>>(numRuns, ngon,
+			std::move(source), simulation::AutocorrelationAccumulator<double> {(2 * ngon - 1) / options.stride});
+	} else if (options.dump) {
+		return makeComposedSimulation<Engine, simulation::SinkAccumulator<double, ratio_dump::Sink>>(simulationName, numRuns, ngon, options);
+	} else if (options.distribution) {
+		return makeComposedSimulation<Engine, simulation::SinkAccumulator<double, ratio_distribution::Sink>>(simulationName, numRuns, ngon, options);
+	}
+	return makeComposedSimulation<Engine, simulation::SumAccumulator<double>>(simulationName, numRuns, ngon, options);
+}
+
+/**
+ * Creates a simulation that draws its points from replayed coordinates; only the per-sample
+ * simulations take a sample source of their own.
+ * @return The simulation, or nullptr if the name is unknown or the simulation cannot replay coordinates.
+ */
+template <typename Accumulator>
+std::unique_ptr<simulation::ISimulation<double>> makeCoordinateReplaySimulation(const std::string& simulationName, int numRuns, int ngon) {
+	if (simulationName == "mc") {
+		return std::make_unique<SimulationSampled<double, simulation::ReplaySampleSource<double>, Accumulator>>(numRuns, ngon);
+	} else if (simulationName == "conditional") {
+		return std::make_unique<SimulationConditionalTriangle<double, simulation::ReplaySampleSource<double>, Accumulator>>(numRuns, ngon);
+	}
+	return nullptr;
+}
+
+/**
+ * Creates a simulation that takes its points from an SMT producer's ring, for --smt-pipeline.  Only
+ * the simulations that draw one independent uniform point per polygon have such a form: eugene4
+ * and eugene5 reuse coordinates across polygons, sobol's points are not random and vr draws
+ * antithetic and control pairs.
+ * @return The simulation, or nullptr if the name is unknown or the simulation has no pipeline form.
+ */
+std::unique_ptr<simulation::ISimulation<double>> makeRingSimulation(const std::string& simulationName, int numRuns, int ngon,
+		SpscRing<double>& ring) {
+	using Ring = simulation::RingSampleSource<double>;
+	const int dimension {simulation::ShoelaceKernel::dimension(ngon)};
+	if (simulationName == "adrian1" || simulationName == "eugene1") {
+		return std::make_unique<simulation::Simulation<double, Ring, simulation::PerSampleLayout<double>, simulation::ShoelaceKernel>>(numRuns, ngon,
+			Ring {dimension, ring});
+	} else if (simulationName == "eugene2") {
+		return std::make_unique<simulation::Simulation<double, Ring, simulation::RowLayout<double>, simulation::ShoelaceKernel>>(numRuns, ngon,
+			Ring {dimension, ring});
+	} else if (simulationName == "eugene3") {
+		return std::make_unique<simulation::Simulation<double, Ring, simulation::ColumnLayout<double>, simulation::ShoelaceKernel>>(numRuns, ngon,
+			Ring {dimension, ring});
+	} else if (simulationName == "mc") {
+		return std::make_unique<SimulationSampled<double, Ring>>(numRuns, ngon, Ring {2 * ngon, ring});
+	} else if (simulationName == "conditional") {
+		return std::make_unique<SimulationConditionalTriangle<double, Ring>>(numRuns, ngon, Ring {4, ring});
+	}
+	return nullptr;
+}
+
+/**
+ * Creates the simulation registered under the given harness name.
+ * @return The simulation, or nullptr if the name is unknown.
+ */
+std::unique_ptr<simulation::ISimulation<double>> makeSimulation(const std::string& simulationName, int numRuns, int ngon,
+		const SimulationOptions& options = {}) {
+	using ReplayKind = simulation::EntropyFileHeader::Kind;
+	if (options.replay == ReplayKind::Coordinates) {
+		if (options.dump) {
+			return makeCoordinateReplaySimulation<simulation::SinkAccumulator<double, ratio_dump::Sink>>(simulationName, numRuns, ngon);
+		} else if (options.distribution) {
+			return makeCoordinateReplaySimulation<simulation::SinkAccumulator<double, ratio_distribution::Sink>>(simulationName, numRuns, ngon);
+		}
+		return makeCoordinateReplaySimulation<simulation::SumAccumulator<double>>(simulationName, numRuns, ngon);
+	} else if (options.replay == ReplayKind::Words) {
+		return makeSimulationWithEngine<simulation::ReplayEngine>(simulationName, numRuns, ngon, options);
+	}
+	return makeSimulationWithEngine<std::mt19937>(simulationName, numRuns, ngon, options);
+}
+
+/**
+ * Adds the extra statistics of the vr and the autocorrelated eugene5 simulations, if sim is one of them.
+ */
+template <typename Engine>
+void collectSimulationStats(simulation::ISimulation<double>& sim, simulation::EstimatorStats& estimatorStats,
+		simulation::AutocorrelationStats<double>& autocorrelation) {
+	if (auto* vr = dynamic_cast<SimulationVarianceReduced<double, Engine>*>(&sim)) {
+		estimatorStats.merge(vr->getEstimatorStats());
+	}
+	// the accumulator starts over with every chunk; the first one sets the lag count
+	using AutocorrelatedEugene5 = SimulationEugene5<double, Engine, simulation::AutocorrelationAccumulator<double>>;
+	if (auto* eugene5 = dynamic_cast<AutocorrelatedEugene5*>(&sim)) {
+		if (autocorrelation.getCount() == 0) {
+			autocorrelation = eugene5->getAccumulator().getAutocorrelation();
+		} else {
+			autocorrelation.merge(eugene5->getAccumulator().getAutocorrelation());
+		}
+	}
+}
+
 int main1(int argc, char* argv[]) {
 	// handle command line argument options
 	int nsims = 1'000'000'000;
 	int mxthreads = 30;
 	int ngon = 3;
+	int replicates = 1;
+	int chunk = 0;
+	double precision = 0;
 	std::string simulationName = "adrian1";
+	std::string estimatorName = "mean";
+	int stride = 1;
+	bool autocorrelation = false;
+	bool smtPipeline = false;
+	std::string placementName = "compact";
+	bool lowJitter = false;
+	bool schedFifo = false;
+	bool mlock = false;
+	int repeats = 1;
+	std::string scalingName = "";
+	std::string csvPrefix = "scaling_";
+	bool counters = false;
+	std::string tracePath = "";
+	bool live = false;
+	int progressSeconds = 0;
+	std::string memoryName = "pool";
+	bool countAllocations = false;
+	bool prefault = false;
+	std::string dumpPath = "";
+	bool distribution = false;
+	std::string distributionCsv = "";
+	std::string replayPath = "";
+	std::string backendName = "";
 	bool verbose = false;
 
 	argparse::ArgumentParser program("eugene2");
 	program.add_argument("-n", "--nsims").help("number of simulations").default_value(nsims).scan<'i', int>();
 	program.add_argument("-t", "--mxthreads").help("maximum number of threads").default_value(mxthreads).scan<'i', int>();
 	program.add_argument("-g", "--ngon").help("number of points of the polygon").default_value(ngon).scan<'i', int>();
-	program.add_argument("-s", "--simulation").help("simulation name, e.g. adrian1 or eugene1").default_value(simulationName);
+	program.add_argument("-s", "--simulation").help("simulation name, e.g. adrian1 or eugene1, or auto to pick the fastest").default_value(simulationName);
+	program.add_argument("-r", "--replicates").help("independent randomizations per thread, used for the error bar").default_value(replicates).scan<'i', int>();
+	program.add_argument("-c", "--chunk").help("runs per simulation call, 0 for a thread's whole share").default_value(chunk).scan<'i', int>();
+	program.add_argument("--precision").help("with auto, target standard error that sets the number of simulations").default_value(precision).scan<'g', double>();
+	program.add_argument("-e", "--estimator").help("estimator for the vr simulation: mean, antithetic or control").default_value(estimatorName);
+	program.add_argument("--stride").help("new coordinates per polygon for the eugene5 sliding window, 1 to 2 * ngon").default_value(stride).scan<'i', int>();
+	program.add_argument("--autocorr").help("report the autocorrelation of the eugene5 ratio sequence").default_value(autocorrelation).implicit_value(true);
+	program.add_argument("--smt-pipeline").help("compare a run with the RNG on each core's SMT sibling against the plain run: adrian1, eugene1-3, mc or conditional").default_value(smtPipeline).implicit_value(true);
+	program.add_argument("--placement").help("thread placement over the allowed CPUs: compact, scatter or smt").default_value(placementName);
+	program.add_argument("--low-jitter").help("run the workers on isolated (isolcpus / nohz_full) CPUs first").default_value(lowJitter).implicit_value(true);
+	program.add_argument("--sched-fifo").help("run the workers under the SCHED_FIFO real-time policy").default_value(schedFifo).implicit_value(true);
+	program.add_argument("--mlock").help("lock the prepared simulation memory before the timer starts").default_value(mlock).implicit_value(true);
+	program.add_argument("--repeat").help("number of timed repeats, reports the run-to-run spread").default_value(repeats).scan<'i', int>();
+	program.add_argument("--scaling").help("sweep 1 to the usable cores: strong (fixed total n), weak (fixed n per thread) or both; -s may list several simulations").default_value(scalingName);
+	program.add_argument("--csv").help("with --scaling, CSV file prefix, one file per simulation").default_value(csvPrefix);
+	program.add_argument("--counters").help("count cycles, instructions, cache and branch misses of every worker with perf_event_open").default_value(counters).implicit_value(true);
+	program.add_argument("--trace").help("write a Chrome trace-event JSON timeline of the workers to this file, for Perfetto").default_value(tracePath);
+	program.add_argument("--live").help("publish live progress to shared memory, for `stats <pid>` and SIGUSR1 snapshots").default_value(live).implicit_value(true);
+	program.add_argument("--progress").help("print live progress every this many seconds, implies --live").default_value(progressSeconds).scan<'i', int>();
+	program.add_argument("--memory").help("per-thread memory resource of the simulations: pool, monotonic or new (global heap)").default_value(memoryName);
+	program.add_argument("--count-allocations").help("count heap allocations per phase: construct, prepare, run and other").default_value(countAllocations).implicit_value(true);
+	program.add_argument("--prefault").help("with --memory huge or huge1g, populate the large buffers when they are allocated").default_value(prefault).implicit_value(true);
+	program.add_argument("--dump").help("write every ratio of the timed runs to this columnar file, from a background writer").default_value(dumpPath);
+	program.add_argument("--distribution").help("report quantiles and the tail near 0 of the ratios, from per-thread histograms and sketches").default_value(distribution).implicit_value(true);
+	program.add_argument("--distribution-csv").help("write the ratio histogram to this CSV file, implies --distribution").default_value(distributionCsv);
+	program.add_argument("--replay").help("draw from an entropy file written by `generate` instead of a live RNG, for bit-exact reruns").default_value(replayPath);
+	program.add_argument("--backend").help("run the counter-based mc sample loop on an execution backend instead: threads (pinned std::threads), pstl (par_unseq) or openmp").default_value(backendName);
 	program.add_argument("-v", "--verbose").help("verbose output").default_value(verbose).implicit_value(true);
 
 	try {
@@ -60,43 +304,221 @@ int main1(int argc, char* argv[]) {
 	mxthreads = program.get<int>("--mxthreads");
 	ngon = program.get<int>("--ngon");
 	simulationName = program.get<std::string>("--simulation");
+	replicates = std::max(1, program.get<int>("--replicates"));
+	chunk = std::max(0, program.get<int>("--chunk"));
+	precision = program.get<double>("--precision");
+	estimatorName = program.get<std::string>("--estimator");
+	stride = program.get<int>("--stride");
+	autocorrelation = program.get<bool>("--autocorr");
+	smtPipeline = program.get<bool>("--smt-pipeline");
+	placementName = program.get<std::string>("--placement");
+	lowJitter = program.get<bool>("--low-jitter");
+	schedFifo = program.get<bool>("--sched-fifo");
+	mlock = program.get<bool>("--mlock");
+	repeats = std::max(1, program.get<int>("--repeat"));
+	scalingName = program.get<std::string>("--scaling");
+	csvPrefix = program.get<std::string>("--csv");
+	counters = program.get<bool>("--counters");
+	tracePath = program.get<std::string>("--trace");
+	progressSeconds = std::max(0, program.get<int>("--progress"));
+	live = program.get<bool>("--live") || progressSeconds > 0;
+	memoryName = program.get<std::string>("--memory");
+	countAllocations = program.get<bool>("--count-allocations");
+	prefault = program.get<bool>("--prefault");
+	dumpPath = program.get<std::string>("--dump");
+	distributionCsv = program.get<std::string>("--distribution-csv");
+	distribution = program.get<bool>("--distribution") || !distributionCsv.empty();
+	replayPath = program.get<std::string>("--replay");
+	backendName = program.get<std::string>("--backend");
 	verbose = program.get<bool>("--verbose");
 
-	constexpr std::array<const char*, 6> validSimulations = {"adrian1", "eugene1", "eugene2", "eugene3", "eugene4", "eugene5"};
-    if (std::find(validSimulations.begin(), validSimulations.end(), simulationName) == validSimulations.end()) {
-		ERROR_OUTPUT("Invalid simulation name: " << simulationName);
+	constexpr std::array<const char*, 11> validSimulations = {"adrian1", "eugene1", "eugene2", "eugene3", "eugene4", "eugene5", "mc", "sobol", "vr", "conditional", "auto"};
+	// scaling sweeps take a comma separated list of simulations
+	std::vector<std::string> simulationNames {};
+	for (std::size_t begin {0}; begin <= simulationName.size();) {
+		std::size_t end {std::min(simulationName.find(',', begin), simulationName.size())};
+		simulationNames.push_back(simulationName.substr(begin, end - begin));
+		begin = end + 1;
+	}
+	for (const auto& name : simulationNames) {
+		if (std::find(validSimulations.begin(), validSimulations.end(), name) == validSimulations.end()) {
+			ERROR_OUTPUT("Invalid simulation name: " << name);
+			return 1;
+		}
+	}
+	std::optional<std::vector<scaling::Mode>> scalingModes {};
+	if (!scalingName.empty()) {
+		scalingModes = scaling::parseModes(scalingName);
+		if (!scalingModes) {
+			ERROR_OUTPUT("Invalid scaling mode: " << scalingName);
+			return 1;
+		}
+		if (std::find(simulationNames.begin(), simulationNames.end(), "auto") != simulationNames.end()) {
+			ERROR_OUTPUT("Scaling sweeps need explicit simulation names");
+			return 1;
+		}
+	} else if (simulationNames.size() > 1) {
+		ERROR_OUTPUT("Only scaling sweeps take several simulations");
 		return 1;
 	}
+	auto estimator = simulation::parseEstimator(estimatorName);
+	if (!estimator) {
+		ERROR_OUTPUT("Invalid estimator name: " << estimatorName);
+		return 1;
+	}
+	if (stride < 1 || stride > 2 * ngon) {
+		ERROR_OUTPUT("Invalid stride: " << stride << ", must be in [1, " << 2 * ngon << "]");
+		return 1;
+	}
+	auto placement = Concurrency::parse_placement(placementName);
+	if (!placement) {
+		ERROR_OUTPUT("Invalid placement: " << placementName);
+		return 1;
+	}
+	if (smtPipeline && simulationName != "adrian1" && simulationName != "eugene1" && simulationName != "eugene2" && simulationName != "eugene3"
+			&& simulationName != "mc" && simulationName != "conditional") {
+		ERROR_OUTPUT("The SMT pipeline needs a simulation that draws one uniform point per polygon: adrian1, eugene1, eugene2, eugene3, mc or conditional");
+		return 1;
+	}
+	if (scalingModes && (!dumpPath.empty() || distribution || !replayPath.empty())) {
+		ERROR_OUTPUT("--dump, --distribution and --replay do not work with --scaling");
+		return 1;
+	}
+	if (!dumpPath.empty() && distribution) {
+		// a simulation has one accumulator and so one sink; the dump holds every ratio anyway
+		ERROR_OUTPUT("--dump and --distribution do not work together");
+		return 1;
+	}
+	auto memoryKind = ThreadMemoryResource::parseKind(memoryName);
+	if (!memoryKind) {
+		ERROR_OUTPUT("Invalid memory resource: " << memoryName);
+		return 1;
+	}
+	std::optional<simulation::ParallelBackend> backend {};
+	if (!backendName.empty()) {
+		backend = simulation::parseParallelBackend(backendName);
+		if (!backend) {
+			ERROR_OUTPUT("Invalid backend: " << backendName);
+			return 1;
+		}
+		std::string backendError = simulation::getParallelBackendError(*backend);
+		if (!backendError.empty()) {
+			ERROR_OUTPUT("Backend " << backendName << " unavailable: " << backendError);
+			return 1;
+		}
+		// the backends run one loop of their own, mc's: asking for another simulation would report mc's numbers under its name
+		if (simulationName != "mc") {
+			ERROR_OUTPUT("--backend runs the plain Monte Carlo loop of mc and needs -s mc, not " << simulationName);
+			return 1;
+		}
+		if (ngon > simulation::kMaxBackendPoints) {
+			ERROR_OUTPUT("--backend takes polygons of up to " << simulation::kMaxBackendPoints << " points");
+			return 1;
+		}
+		if (scalingModes || smtPipeline || autocorrelation || !dumpPath.empty() || distribution || !replayPath.empty() || live || counters
+				|| replicates > 1 || !tracePath.empty() || countAllocations) {
+			ERROR_OUTPUT("--backend only takes -n, -t, -g, -s, --repeat and --placement");
+			return 1;
+		}
+	}
+	SimulationOptions options {*estimator, stride, autocorrelation};
 
-		int numSockets = Concurrency::get_num_physical_cpus();
+	// the CPUs we may use: the affinity mask and cgroup cpuset, capped by the cgroup CPU quota
+	// (must be read before any pinning, which narrows the affinity mask)
+	int numSockets = Concurrency::get_num_physical_cpus();
 	int numOfPhysicalCores = Concurrency::get_num_physical_cores();
 	int numAvailableCores = Concurrency::get_num_available_cores();
-	int coresToUse = std::min(numAvailableCores, numOfPhysicalCores);
+	std::vector<int> allowedCpus = Concurrency::get_allowed_cpus();
+	double cpuQuota = Concurrency::get_cpu_quota();
+	int numUsableCpus = Concurrency::get_usable_cpu_count();
+	auto allowedCoreMapping = Concurrency::get_allowed_physical_core_mapping();
+	int numAllowedPhysicalCores = allowedCoreMapping.empty() ? numUsableCpus : static_cast<int>(allowedCoreMapping.size());
+	// one thread per physical core, unless the placement asks for the SMT siblings too
+	int coresToUse = (*placement == Concurrency::Placement::Smt) ? numUsableCpus : std::min(numUsableCpus, numAllowedPhysicalCores);
 	VERBOSE_OUTPUT("CPU sockets: " << numSockets << ", physical cores: " << numOfPhysicalCores << ", available cores: " << numAvailableCores << ", cores to use: " << coresToUse << ", hyperthreading enabled: " << Concurrency::is_hyperthreading_enabled());
+	VERBOSE_OUTPUT("Allowed CPUs: " << allowedCpus.size() << ", allowed physical cores: " << numAllowedPhysicalCores << ", CPU quota: " << (cpuQuota > 0 ? std::to_string(cpuQuota) : "none") << ", usable CPUs: " << numUsableCpus);
 
 if (verbose) {
 		Concurrency::print_physical_core_mapping();
 	}
 
-	// get the physical core id mapping
-	auto physicalCoreIdMapping = Concurrency::get_physical_core_mapping();
-	std::map<int, int> physicalToLogicalCoreMapping {};
-	int physicalCoreId = 0;
-	for (const auto& [socketId, coreId] : physicalCoreIdMapping) {
-		physicalToLogicalCoreMapping[physicalCoreId] = coreId.front();
-		physicalCoreId++;
+	// the main thread takes the first CPU of the placement order, the workers the following ones
+	std::vector<int> placementOrder = Concurrency::get_placement_order(*placement);
+	int mainCpu = placementOrder.empty() ? -1 : placementOrder.front();
+	std::vector<int> workerCpus {};
+	if (placementOrder.size() > 1) {
+		workerCpus.assign(placementOrder.begin() + 1, placementOrder.end());
+	} else {
+		workerCpus = placementOrder;
+	}
+	if (lowJitter) {
+		// workers go to the isolated (isolcpus / nohz_full) CPUs first, the main thread stays off them
+		std::vector<int> isolatedCpus = Concurrency::get_isolated_cpus();
+		auto isIsolated = [&isolatedCpus](int cpu) { return std::find(isolatedCpus.begin(), isolatedCpus.end(), cpu) != isolatedCpus.end(); };
+		auto firstHousekeeping = std::find_if_not(placementOrder.begin(), placementOrder.end(), isIsolated);
+		if (firstHousekeeping != placementOrder.end()) {
+			mainCpu = *firstHousekeeping;
+		}
+		workerCpus = isolatedCpus;
+		for (int cpu : placementOrder) {
+			if (cpu != mainCpu && !isIsolated(cpu)) {
+				workerCpus.push_back(cpu);
+			}
+		}
+		if (workerCpus.empty()) {
+			workerCpus = placementOrder;
+		}
+		// isolated CPUs are usually outside the affinity mask, so they were not counted yet
+		int numExtraCpus = static_cast<int>(std::count_if(isolatedCpus.begin(), isolatedCpus.end(), [&allowedCpus](int cpu) {
+			return std::find(allowedCpus.begin(), allowedCpus.end(), cpu) == allowedCpus.end();
+		}));
+		coresToUse += cpuQuota > 0 ? std::min(numExtraCpus, std::max(0, numUsableCpus - coresToUse)) : numExtraCpus;
+		INFO_OUTPUT("Low-jitter mode: " << isolatedCpus.size() << " isolated CPUs");
+	}
+	if (verbose) {
+		std::cout << "Placement order (" << placementName << "): main " << mainCpu << ", workers";
+		for (int cpu : workerCpus) {
+			std::cout << " " << cpu;
+		}
+		std::cout << std::endl;
 	}
 
-	// we will give core 0 to the OS
-	// core 1 for the main thread (probably same physical core as the OS)
-	// the rest are for the threads, which will be pinned to even-numbered cores, up to the number of available physical cores
-
-	if (numAvailableCores >= 2) {
-		if (Concurrency::pin_to_core(1)) {
-			VERBOSE_OUTPUT("Main thread pinned to core 1 ");
+	if (mainCpu >= 0) {
+		if (Concurrency::pin_to_core(mainCpu)) {
+			VERBOSE_OUTPUT("Main thread pinned to core " << mainCpu);
 		} else {
-			VERBOSE_OUTPUT("Failed to pin main thread to core 1");
+			VERBOSE_OUTPUT("Failed to pin main thread to core " << mainCpu);
+		}
+	}
+
+	if (scalingModes) {
+		// every usable core, the main thread only waits: its CPU goes to the workers too, else the
+		// last thread of the sweep would land on a sibling of it (or wrap around) and show a false knee
+		std::vector<int> sweepCpus = lowJitter ? workerCpus : placementOrder;
+		if (mainCpu >= 0 && std::find(sweepCpus.begin(), sweepCpus.end(), mainCpu) == sweepCpus.end()) {
+			sweepCpus.push_back(mainCpu);
+		}
+		const int maxThreads = std::max(1, std::min(mxthreads, coresToUse));
+		const auto added = scaling::describeWorkerCpus(maxThreads, sweepCpus, allowedCoreMapping);
+		INFO_OUTPUT("Scaling sweep over 1 to " << maxThreads << " threads, " << repeats << " trials each");
+		for (const auto& name : simulationNames) {
+			const std::string csvPath = csvPrefix + name + ".csv";
+			std::ofstream csv(csvPath);
+			scaling::writeCsvHeader(csv);
+			for (auto mode : *scalingModes) {
+				auto points = scaling::sweep(mode, maxThreads, nsims, chunk, repeats, sweepCpus, added, [&](int runs) {
+					return makeSimulation(name, runs, ngon, options);
+				});
+				scaling::printTable(std::cout, name, mode, points);
+				scaling::writeCsvRows(csv, name, mode, points);
+			}
+			if (!csv) {
+				ERROR_OUTPUT("Failed to write " << csvPath);
+				return 1;
+			}
+			INFO_OUTPUT("Wrote " << csvPath);
 		}
+		return 0;
 	}
 
     // determine the number of threads to use
@@ -109,62 +531,592 @@ if (verbose) {
     VERBOSE_OUTPUT("Will use " << numThreads << " threads to run " << nsims << " simulations with " << numRunsPerThread << " runs per thread and " << runsAdjustment << " runs adjustment");
     // std::cout << "Runs adjustment: " << runsAdjustment << std::endl;
 
-    INFO_OUTPUT("Using simulation: " << simulationName);
+	if (simulationName == "auto") {
+		// sobol is left out: its error only shows across independent scrambles, not in batch means
+		std::vector<std::string> candidates {"adrian1", "eugene1", "eugene2", "eugene3", "eugene5", "mc", "vr"};
+		if (ngon == 3) {
+			candidates.push_back("eugene4");
+			candidates.push_back("conditional");
+		}
+		const std::string cacheKey = autotune::makeCacheKey(ngon, numThreads, estimatorName);
+		auto tuned = autotune::loadCached(cacheKey);
+		if (tuned) {
+			VERBOSE_OUTPUT("Auto-tuner: using the cached configuration from " << autotune::getCachePath());
+		} else {
+			tuned = autotune::tune(candidates, numThreads, workerCpus, [&](const std::string& name, int runs) {
+				return makeSimulation(name, runs, ngon, options);
+			}, verbose);
+			if (!autotune::storeCached(cacheKey, *tuned)) {
+				INFO_OUTPUT("WARN: Could not write the auto-tuner cache " << autotune::getCachePath());
+			}
+		}
+		simulationName = tuned->simulation;
+		numThreads = tuned->threads;
+		chunk = tuned->chunk;
+		if (precision > 0) {
+			nsims = static_cast<int>(std::min<double>(std::numeric_limits<int>::max(), std::ceil(tuned->variance / (precision * precision))));
+		}
+		numRunsPerThread = nsims / numThreads;
+		runsAdjustment = nsims - numRunsPerThread * numThreads;
+		INFO_OUTPUT("Auto-tuner picked " << simulationName << " with " << numThreads << " threads and chunks of " << chunk
+			<< " (" << tuned->samplesPerSecond << " samples/sec, expected standard error " << std::sqrt(tuned->variance / nsims) << " for " << nsims << " simulations)");
+	}
+	// a replicate without runs has no mean to put in the error bar
+	if (replicates > 1 && numRunsPerThread < replicates) {
+		ERROR_OUTPUT("-r " << replicates << " needs at least " << replicates << " runs per thread, but -n " << nsims << " over "
+			<< numThreads << " threads gives " << numRunsPerThread);
+		return 1;
+	}
 
-	Timer timer {};
+    INFO_OUTPUT("Using simulation: " << (backend ? "mc, on the " + backendName + " backend" : simulationName));
 
-	// create the threads
-    std::vector<std::thread> threads;
-	// verctor of pairs of sums and run counts
-	std::vector<std::pair<double, int>> results(numThreads);
-	
-    for (int i = 0; i < numThreads; i++) {
-		int numRuns = numRunsPerThread + ((i==0)? runsAdjustment : 0);
-        threads.emplace_back([i, ngon, numRuns, &results, simulationName, &physicalToLogicalCoreMapping]() {
-			auto coreId = physicalToLogicalCoreMapping[i+1]; // shifting by 1 to give the main thread core 0
-			if (!Concurrency::pin_to_core(coreId)) {
-				ERROR_OUTPUT("Failed to pin thread " << i << " to core " << coreId);
+	if (!dumpPath.empty()) {
+		// only the policy-composed simulations take an accumulator, and eugene5 has its own for --autocorr
+		if (simulationName == "vr" || (simulationName == "eugene5" && autocorrelation) || smtPipeline) {
+			ERROR_OUTPUT("--dump does not work with vr, eugene5 --autocorr or --smt-pipeline");
+			return 1;
+		}
+		options.dump = true;
+	}
+	if (distribution) {
+		if (simulationName == "vr" || (simulationName == "eugene5" && autocorrelation) || smtPipeline) {
+			ERROR_OUTPUT("--distribution does not work with vr, eugene5 --autocorr or --smt-pipeline");
+			return 1;
+		}
+		options.distribution = true;
+	}
+
+	std::unique_ptr<simulation::EntropyFile> entropyFile {};
+	if (!replayPath.empty()) {
+		entropyFile = std::make_unique<simulation::EntropyFile>(replayPath);
+		if (!entropyFile->isOpen()) {
+			ERROR_OUTPUT("Cannot replay: " << entropyFile->getError());
+			return 1;
+		}
+		const auto& header = entropyFile->getHeader();
+		using ReplayKind = simulation::EntropyFileHeader::Kind;
+		if (smtPipeline) {
+			ERROR_OUTPUT("--replay does not work with --smt-pipeline");
+			return 1;
+		} else if (header.kind == ReplayKind::Coordinates
+				&& (header.valueBytes != sizeof(double) || (simulationName != "mc" && simulationName != "conditional"))) {
+			ERROR_OUTPUT("Coordinate files (of doubles) only drive mc and conditional, use a words file for " << simulationName);
+			return 1;
+		} else if (header.kind != ReplayKind::Coordinates && header.kind != ReplayKind::Words) {
+			ERROR_OUTPUT("Cannot replay: " << replayPath << " holds an unknown kind of values");
+			return 1;
+		}
+		options.replay = header.kind;
+		VERBOSE_OUTPUT("Replaying " << header.count << (header.kind == ReplayKind::Words ? " words" : " coordinates") << " from " << replayPath
+			<< " (seed " << header.seed << ")");
+	}
+
+	if (smtPipeline) {
+		auto cpuPairs = smt_pipeline::get_smt_cpu_pairs(allowedCoreMapping);
+		if (std::none_of(cpuPairs.begin(), cpuPairs.end(), [](const auto& pair) { return pair.second >= 0; })) {
+			INFO_OUTPUT("WARN: No SMT siblings found, producers will not be pinned");
+		}
+		auto makePipelineSimulation = [&](int runs, SpscRing<double>* ring) -> std::unique_ptr<simulation::ISimulation<double>> {
+			if (!ring) {
+				return makeSimulation(simulationName, runs, ngon, options);
 			}
-			// the sim pointer below should be a unique pointer
-			std::unique_ptr<simulation::ISimulation<double>> sim {nullptr};
-			if (simulationName == "adrian1") {
-				sim = std::make_unique<SimulationAdrian1<double>>(numRuns, ngon);
-			} else if (simulationName == "eugene1") {
-				sim = std::make_unique<SimulationEugene1<double>>(numRuns, ngon);
-			} else if (simulationName == "eugene2") {
-				sim = std::make_unique<SimulationEugene2<double>>(numRuns, ngon);
-			} else if (simulationName == "eugene3") {
-				sim = std::make_unique<SimulationEugene3<double>>(numRuns, ngon);
-			} else if (simulationName == "eugene4") {
-				sim = std::make_unique<SimulationEugene4<double>>(numRuns, ngon);
-			} else if (simulationName == "eugene5") {
-				sim = std::make_unique<SimulationEugene5<double>>(numRuns, ngon);
-			} else {
-				ERROR_OUTPUT("Invalid simulation name: " << simulationName);
-				exit(-1);
+			return makeRingSimulation(simulationName, runs, ngon, *ring);
+		};
+		auto baseline = smt_pipeline::run(numThreads, nsims, cpuPairs, false, makePipelineSimulation);
+		auto split = smt_pipeline::run(numThreads, nsims, cpuPairs, true, makePipelineSimulation);
+		INFO_OUTPUT("Average ratio: baseline " << baseline.ratiosSum / baseline.runCount << ", SMT pipeline " << split.ratiosSum / split.runCount);
+		INFO_OUTPUT("Samples/sec: baseline " << baseline.getSamplesPerSecond() << ", SMT pipeline " << split.getSamplesPerSecond()
+			<< ", speedup " << split.getSamplesPerSecond() / baseline.getSamplesPerSecond());
+		return 0;
+	}
+
+	// accumulates the timed part of every repeat
+	Timer timer {false};
+	std::vector<double> repeatSeconds {};
+
+	if (backend) {
+		// the threads of the runtimes inherit the main thread's affinity, so it gets all the CPUs back
+		Concurrency::set_affinity(placementOrder);
+		double totalRatiosSum = 0;
+		for (int repeat = 0; repeat < repeats; repeat++) {
+			const std::uint64_t seed = (static_cast<std::uint64_t>(simulation::drawSeed()) << 32) | simulation::drawSeed();
+			Timer repeatTimer {};
+			timer.start();
+			totalRatiosSum += simulation::sumRatios<double>(*backend, nsims, ngon, seed, numThreads, workerCpus);
+			timer.stop();
+			repeatTimer.stop();
+			repeatSeconds.push_back(repeatTimer.getTimeElapsed().count());
+			VERBOSE_OUTPUT("Repeat " << repeat << ": " << repeatSeconds.back() << " s");
+		}
+		const double totalRunCount = static_cast<double>(nsims) * repeats;
+		INFO_OUTPUT("Average ratio: " << totalRatiosSum / totalRunCount);
+		INFO_OUTPUT("Backend " << backendName << ": " << numThreads << " threads, " << totalRunCount / timer.getTimeElapsed().count()
+			<< " samples/sec, fastest repeat " << *std::min_element(repeatSeconds.begin(), repeatSeconds.end()) << " s");
+		timer.printTime("total");
+		return 0;
+	}
+
+	// vector of pairs of sums and run counts, one per replicate of every repeat
+	std::vector<std::pair<double, int>> results(repeats * numThreads * replicates);
+	// estimator statistics, only filled in by the vr simulation
+	std::vector<simulation::EstimatorStats> estimatorStats(repeats * numThreads * replicates);
+	// ratio sequence autocorrelation, only filled in by eugene5 with --autocorr
+	std::vector<simulation::AutocorrelationStats<double>> autocorrelationStats(repeats * numThreads * replicates);
+	// hardware counters of every worker of every repeat, only filled in with --counters
+	std::vector<PerfCounters::Reading> counterReadings(repeats * numThreads);
+	std::vector<std::string> counterErrors(repeats * numThreads);
+	// page faults of every worker while setting up and while running, also only with --counters
+	std::vector<PerfCounters::PageFaults> setupFaults(repeats * numThreads);
+	std::vector<PerfCounters::PageFaults> runFaults(repeats * numThreads);
+	// values every worker read from its replay stream, only with --replay
+	std::vector<std::uint64_t> replayTaken(repeats * numThreads);
+	// ratio distribution of every worker, only with --distribution
+	std::vector<ratio_distribution::Distribution> distributions(options.distribution ? repeats * numThreads : 0);
+	bool hugePages = *memoryKind == ThreadMemoryResource::Kind::HugePages || *memoryKind == ThreadMemoryResource::Kind::GiganticPages;
+	std::int64_t transparentHugePageBytes = 0;
+
+	// workers publish after every chunk, so a thread's whole share in one chunk would show nothing until the end
+	std::unique_ptr<live_stats::Segment> liveSegment {};
+	if (live) {
+		if (chunk == 0) {
+			chunk = 1 << 20;
+			INFO_OUTPUT("Live stats: chunks of " << chunk << " runs");
+		}
+		liveSegment = std::make_unique<live_stats::Segment>(numThreads, repeats, static_cast<std::int64_t>(nsims) * repeats, simulationName);
+		if (liveSegment->isOpen()) {
+			live_stats::installSnapshotHandler();
+			INFO_OUTPUT("Live stats in " << liveSegment->getName() << ": `main stats " << getpid() << "` or kill -USR1 " << getpid());
+		} else {
+			ERROR_OUTPUT("WARN: no live stats, " << liveSegment->getError());
+			liveSegment.reset();
+		}
+	}
+	live_stats::Segment* liveStats = liveSegment.get();
+
+	std::unique_ptr<ratio_dump::Writer> dumpWriterOwner {};
+	if (options.dump) {
+		dumpWriterOwner = std::make_unique<ratio_dump::Writer>(dumpPath, numThreads, ngon, simulationName);
+		if (!dumpWriterOwner->isOpen()) {
+			ERROR_OUTPUT("Cannot dump ratios: " << dumpWriterOwner->getError());
+			return 1;
+		}
+		if (!dumpWriterOwner->isDirect()) {
+			INFO_OUTPUT("WARN: " << dumpPath << " does not take O_DIRECT, the dump goes through the page cache");
+		}
+	}
+	ratio_dump::Writer* dumpWriter = dumpWriterOwner.get();
+
+	// only the timed runs go into the phase breakdown, the trace and the allocation counts, not the auto-tuner trials
+	PhaseProfiler::reset();
+	if (countAllocations) {
+		allocation_counter::enable();
+	}
+	if (!tracePath.empty()) {
+		TraceRecorder::enable();
+		TraceRecorder::setThreadName("main");
+	}
+	for (int repeat = 0; repeat < repeats; repeat++) {
+		TraceRecorder::Scope repeatScope {"repeat", "repeat", repeat};
+		// the workers set up their simulations, then wait for the main thread to start the timer
+		std::latch prepared {numThreads};
+		std::latch start {1};
+		// with --live, wakes the main thread's poll as soon as the last worker is done
+		std::mutex workersDoneMutex {};
+		std::condition_variable workersDone {};
+
+		// create the threads
+		std::vector<std::thread> threads;
+		for (int i = 0; i < numThreads; i++) {
+			int numRuns = numRunsPerThread + ((i==0)? runsAdjustment : 0);
+			int first = (repeat * numThreads + i) * replicates;
+			int worker = repeat * numThreads + i;
+			threads.emplace_back([i, repeat, first, worker, ngon, numRuns, replicates, chunk, schedFifo, counters, liveStats, memoryKind, prefault, &results, &estimatorStats, &autocorrelationStats,
+					&counterReadings, &counterErrors, &setupFaults, &runFaults, dumpWriter, &distributions, &entropyFile, &replayTaken, numThreads, options, simulationName, countAllocations, &workerCpus, &prepared, &start, &workersDoneMutex, &workersDone]() {
+				TraceRecorder::setThreadName("worker " + std::to_string(i) + " (repeat " + std::to_string(repeat) + ")");
+				TraceRecorder::instant("thread start", "thread", i);
+				if (!workerCpus.empty()) {
+					auto coreId = workerCpus[i % workerCpus.size()];
+					if (!Concurrency::pin_to_core(coreId)) {
+						ERROR_OUTPUT("Failed to pin thread " << i << " to core " << coreId);
+					}
+					TraceRecorder::instant("pin", "cpu", coreId);
+				}
+				if (schedFifo) {
+					Concurrency::set_realtime_priority(1);
+				}
+				// the simulations' buffers come from the worker's own arena, which must outlive them
+				PerfCounters::PageFaults faultsBefore = PerfCounters::getThreadPageFaults();
+				auto arena = ThreadMemoryResource::make(*memoryKind, prefault);
+				// counted on top of the arena, or a pool's reuse of its blocks would pass for no allocation
+				std::optional<allocation_counter::CountingResource> countingArena {};
+				if (countAllocations) {
+					countingArena.emplace(arena ? arena.get() : std::pmr::get_default_resource());
+				}
+				ThreadMemoryResource::Scope memoryScope {countingArena ? &*countingArena : arena.get()};
+				// the simulations' accumulators take the sink of the thread that constructs them
+				std::unique_ptr<ratio_dump::Sink> dumpSink = dumpWriter ? std::make_unique<ratio_dump::Sink>(*dumpWriter) : nullptr;
+				ratio_dump::Sink::Scope dumpScope {dumpSink.get()};
+				std::unique_ptr<ratio_distribution::Sink> distributionSink {};
+				if (options.distribution) {
+					distributionSink = std::make_unique<ratio_distribution::Sink>(distributions[worker]);
+				}
+				ratio_distribution::Sink::Scope distributionScope {distributionSink.get()};
+				// and so do their engines and sources with --replay: each worker reads its own share of the file
+				std::unique_ptr<simulation::ReplayStream> replayStream {};
+				if (entropyFile) {
+					replayStream = std::make_unique<simulation::ReplayStream>(*entropyFile, entropyFile->getHeader().count / numThreads * i);
+				}
+				simulation::ReplayStream::Scope replayScope {replayStream.get()};
+				// each replicate is a fresh simulation, and so a fresh randomization; all of them are
+				// created and prepared up front so that no allocation or page fault lands in the timed part.
+				// With a chunk size, a replicate reruns one chunk-sized simulation (plus one for the
+				// remainder), which keeps the buffers of the batch simulations in cache.
+				struct Replicate {
+					std::unique_ptr<simulation::ISimulation<double>> sim;
+					int chunkCount;
+					std::unique_ptr<simulation::ISimulation<double>> tail;
+				};
+				std::vector<Replicate> sims;
+				for (int rep = 0; rep < replicates; rep++) {
+					int repRuns = numRuns / replicates + ((rep == 0) ? numRuns % replicates : 0);
+					TraceRecorder::Scope constructScope {"construct", "runs", repRuns};
+					int chunkRuns = (chunk > 0 && chunk < repRuns) ? chunk : repRuns;
+					int chunkCount = chunkRuns > 0 ? repRuns / chunkRuns : 1;
+					int tailRuns = repRuns - chunkCount * chunkRuns;
+					{
+						allocation_counter::PhaseScope allocationPhase {allocation_counter::Phase::Construct};
+						sims.push_back({makeSimulation(simulationName, chunkRuns, ngon, options), chunkCount,
+							tailRuns > 0 ? makeSimulation(simulationName, tailRuns, ngon, options) : nullptr});
+					}
+					if (!sims.back().sim) {
+						ERROR_OUTPUT("Invalid simulation name: " << simulationName);
+						exit(-1);
+					}
+					allocation_counter::PhaseScope allocationPhase {allocation_counter::Phase::Prepare};
+					sims.back().sim->prepare();
+					if (sims.back().tail) {
+						sims.back().tail->prepare();
+					}
+				}
+				setupFaults[worker] = PerfCounters::getThreadPageFaults() - faultsBefore;
+				// opened after pinning and setup, so the counts are of the timed runs on the worker's own CPU
+				PerfCounters perfCounters {};
+				bool countersOpen = counters && perfCounters.open();
+				if (counters && !countersOpen) {
+					counterErrors[worker] = perfCounters.getError();
+				}
+				prepared.count_down();
+				{
+					TraceRecorder::Scope waitScope {"wait start"};
+					start.wait();
+				}
+				if (countersOpen) {
+					perfCounters.start();
+				}
+				faultsBefore = PerfCounters::getThreadPageFaults();
+
+				for (int rep = 0; rep < replicates; rep++) {
+					auto& replicate = sims[rep];
+					double sumOfRatios = 0;
+					int runCount = 0;
+					simulation::EstimatorStats replicateStats {};
+					simulation::AutocorrelationStats<double> replicateAutocorrelation {};
+					auto runChunk = [&](simulation::ISimulation<double>& sim) {
+						TraceRecorder::Scope chunkScope {"chunk", "runs", sim.getRunCount()};
+						{
+							allocation_counter::PhaseScope allocationPhase {allocation_counter::Phase::Run};
+							sim.run();
+						}
+						sumOfRatios += sim.getSumOfRatios();
+						runCount += sim.getRunCount();
+						if (liveStats) {
+							liveStats->getSlot(i).publish(sim.getRunCount(), sim.getSumOfRatios());
+						}
+						collectSimulationStats<std::mt19937>(sim, replicateStats, replicateAutocorrelation);
+						collectSimulationStats<simulation::ReplayEngine>(sim, replicateStats, replicateAutocorrelation);
+					};
+					for (int c = 0; c < replicate.chunkCount; c++) {
+						runChunk(*replicate.sim);
+					}
+					if (replicate.tail) {
+						runChunk(*replicate.tail);
+					}
+					// Store results
+					results[first + rep] = std::make_pair(sumOfRatios, runCount);
+					estimatorStats[first + rep] = replicateStats;
+					autocorrelationStats[first + rep] = replicateAutocorrelation;
+				}
+				if (dumpSink) {
+					dumpSink->finish();
+				}
+				if (distributionSink) {
+					distributionSink->finish();
+				}
+				if (replayStream) {
+					replayTaken[worker] = replayStream->getTaken();
+				}
+				if (countersOpen) {
+					perfCounters.stop();
+					counterReadings[worker] = perfCounters.read();
+				}
+				runFaults[worker] = PerfCounters::getThreadPageFaults() - faultsBefore;
+				if (liveStats) {
+					{
+						std::lock_guard lock {workersDoneMutex};
+						liveStats->getHeader().finishedWorkers.fetch_add(1, std::memory_order_relaxed);
+					}
+					workersDone.notify_one();
+				}
+				TraceRecorder::instant("thread end");
+			});
+		}
+
+		{
+			TraceRecorder::Scope prepareScope {"wait prepared"};
+			prepared.wait();
+		}
+		if (hugePages) {
+			// everything is prepared, so this is the footprint the runs see
+			transparentHugePageBytes = std::max(transparentHugePageBytes, HugePageResource::getTransparentHugePageBytes());
+		}
+		if (mlock) {
+			Concurrency::lock_memory();
+		}
+		Timer repeatTimer {};
+		timer.start();
+		start.count_down();
+
+		if (liveStats) {
+			// poll until this repeat's workers are done, printing on SIGUSR1 and every --progress seconds
+			liveStats->start();
+			auto& finishedWorkers = liveStats->getHeader().finishedWorkers;
+			auto nextProgress = std::chrono::steady_clock::now() + std::chrono::seconds(progressSeconds);
+			while (true) {
+				{
+					// returns as soon as the workers are done, so the poll adds nothing to the timed part
+					std::unique_lock lock {workersDoneMutex};
+					if (workersDone.wait_for(lock, std::chrono::milliseconds(100),
+							[&] { return finishedWorkers.load(std::memory_order_relaxed) >= (repeat + 1) * numThreads; })) {
+						break;
+					}
+				}
+				bool progressDue = progressSeconds > 0 && std::chrono::steady_clock::now() >= nextProgress;
+				if (live_stats::snapshotRequested || progressDue) {
+					live_stats::snapshotRequested = 0;
+					live_stats::printSnapshot(std::cout, liveStats->read());
+				}
+				if (progressDue) {
+					nextProgress += std::chrono::seconds(progressSeconds);
+				}
 			}
-			sim->run();
-			// Store results
-			results[i] = std::make_pair(sim->getSumOfRatios(), sim->getRunCount());
-        });
-    }
+		}
 
-	// join the threads
-	for (auto& thread : threads) {
-		thread.join();
+		// join the threads
+		for (int i = 0; i < numThreads; i++) {
+			TraceRecorder::Scope joinScope {"join", "thread", i};
+			threads[i].join();
+		}
+
+		timer.stop();
+		repeatTimer.stop();
+		repeatSeconds.push_back(repeatTimer.getTimeElapsed().count());
 	}
 
-	timer.stop();
+	if (liveStats) {
+		liveStats->finish();
+	}
 
 	double totalRatiosSum = 0;
-	int totalRunCount = 0;
+	long long totalRunCount = 0;
 	for (auto& result : results) {
 		totalRatiosSum += result.first;
 		totalRunCount += result.second;
 	}
 	INFO_OUTPUT("Average ratio: " << totalRatiosSum / totalRunCount);
 
+	// every replicate is an independent estimate, so their spread gives the error bar
+	// (for sobol this is the only valid error estimate, a single scramble has none).  The replicates
+	// differ in size (the first thread's first one takes the remainder), so each deviation from the
+	// overall mean is weighted by its run count: the variance of a mean of n runs is sigma^2 / n.
+	// Replicates without runs (fewer runs than threads) are left out.
+	std::size_t nonEmptyReplicates = std::count_if(results.begin(), results.end(), [](const auto& result) { return result.second > 0; });
+	if (nonEmptyReplicates > 1) {
+		const double overallMean = totalRatiosSum / totalRunCount;
+		double weightedSquaredDeviations = 0;
+		for (auto& result : results) {
+			if (result.second > 0) {
+				double deviation = result.first / result.second - overallMean;
+				weightedSquaredDeviations += result.second * deviation * deviation;
+			}
+		}
+		double standardError = std::sqrt(weightedSquaredDeviations / (nonEmptyReplicates - 1) / totalRunCount);
+		INFO_OUTPUT("Standard error: " << standardError << " (" << nonEmptyReplicates << " replicates)");
+	}
+
+	if (simulationName == "vr") {
+		// pool the per-sample variances over all replicates, weighted by their run counts
+		double plainVariance = 0;
+		double estimatorVariance = 0;
+		for (auto& stats : estimatorStats) {
+			plainVariance += stats.plainVariance * stats.count;
+			estimatorVariance += stats.estimatorVariance * stats.count;
+		}
+		plainVariance /= totalRunCount;
+		estimatorVariance /= totalRunCount;
+		// CPU seconds per sample, so estimators of different cost can be compared on time-to-target-error
+		double secondsPerSample = timer.getTimeElapsed().count() * numThreads / totalRunCount;
+		INFO_OUTPUT("Estimator: " << estimatorName << ", variance per sample: plain " << plainVariance << ", estimator " << estimatorVariance);
+		INFO_OUTPUT("Variance reduction factor: " << plainVariance / estimatorVariance);
+		INFO_OUTPUT("Work-normalized variance (variance x CPU seconds per sample): " << estimatorVariance * secondsPerSample);
+	}
+
+	if (simulationName == "eugene5" && autocorrelation) {
+		simulation::AutocorrelationStats<double> pooled {autocorrelationStats.front().getMaxLag()};
+		for (auto& stats : autocorrelationStats) {
+			pooled.merge(stats);
+		}
+		std::cout << "Autocorrelation (stride " << stride << "):";
+		for (int lag = 1; lag <= pooled.getMaxLag(); lag++) {
+			std::cout << " lag " << lag << " " << pooled.getAutocorrelation(lag) << (lag < pooled.getMaxLag() ? "," : "");
+		}
+		std::cout << std::endl;
+		double integratedTime = pooled.getIntegratedTime();
+		double effectiveSamples = totalRunCount / integratedTime;
+		INFO_OUTPUT("Integrated autocorrelation time: " << integratedTime << ", effective samples: " << effectiveSamples
+			<< ", effective samples/sec: " << effectiveSamples / timer.getTimeElapsed().count());
+	}
+
+	if (repeats > 1) {
+		double meanSeconds = 0;
+		for (double seconds : repeatSeconds) {
+			meanSeconds += seconds;
+		}
+		meanSeconds /= repeats;
+		double squaredDeviations = 0;
+		for (double seconds : repeatSeconds) {
+			squaredDeviations += (seconds - meanSeconds) * (seconds - meanSeconds);
+		}
+		double stddevSeconds = std::sqrt(squaredDeviations / (repeats - 1));
+		INFO_OUTPUT("Run time over " << repeats << " repeats: mean " << meanSeconds << " s, stddev " << stddevSeconds
+			<< " s, CV " << 100 * stddevSeconds / meanSeconds << "%, min " << *std::min_element(repeatSeconds.begin(), repeatSeconds.end())
+			<< " s, max " << *std::max_element(repeatSeconds.begin(), repeatSeconds.end()) << " s");
+	}
+
+	if (counters) {
+		// per thread over all repeats, then over all threads
+		std::vector<PerfCounters::Reading> threadReadings(numThreads);
+		std::vector<long long> threadRunCounts(numThreads);
+		for (int worker = 0; worker < repeats * numThreads; worker++) {
+			threadReadings[worker % numThreads].merge(counterReadings[worker]);
+			for (int rep = 0; rep < replicates; rep++) {
+				threadRunCounts[worker % numThreads] += results[worker * replicates + rep].second;
+			}
+		}
+		PerfCounters::Reading total {};
+		for (auto& reading : threadReadings) {
+			total.merge(reading);
+		}
+		PerfCounters::PageFaults totalSetupFaults {};
+		PerfCounters::PageFaults totalRunFaults {};
+		for (int worker = 0; worker < repeats * numThreads; worker++) {
+			totalSetupFaults += setupFaults[worker];
+			totalRunFaults += runFaults[worker];
+		}
+		INFO_OUTPUT("Page faults: setup " << totalSetupFaults.minor << " minor, " << totalSetupFaults.major << " major; timed "
+			<< totalRunFaults.minor << " minor, " << totalRunFaults.major << " major");
+		auto printCounters = [](const std::string& label, const PerfCounters::Reading& reading, long long runCount) {
+			std::cout << label << ":";
+			if (reading.isValid(PerfCounters::Cycles) && reading.isValid(PerfCounters::Instructions)) {
+				std::cout << " IPC " << reading.counts[PerfCounters::Instructions] / reading.counts[PerfCounters::Cycles] << ",";
+			}
+			std::cout << " per sample:";
+			for (int event = 0; event < PerfCounters::kEventCount; event++) {
+				if (reading.isValid(event)) {
+					std::cout << " " << PerfCounters::getEventName(event) << " " << reading.counts[event] / runCount;
+				}
+			}
+			std::cout << std::endl;
+		};
+		if (!total.isValid(PerfCounters::Cycles) && !total.isValid(PerfCounters::L1dMisses)) {
+			int paranoid = PerfCounters::getParanoidLevel();
+			ERROR_OUTPUT("WARN: hardware counters unavailable (" << counterErrors.front() << ", perf_event_paranoid " << paranoid << ")"
+				<< (paranoid > 2 ? "; needs perf_event_paranoid <= 2 or CAP_PERFMON" : ""));
+		} else {
+			printCounters("Counters of " + simulationName, total, totalRunCount);
+			if (numThreads > 1) {
+				for (int i = 0; i < numThreads; i++) {
+					printCounters("  thread " + std::to_string(i), threadReadings[i], threadRunCounts[i]);
+				}
+			}
+		}
+	}
+
+	if (hugePages) {
+		auto& stats = HugePageResource::getStats();
+		INFO_OUTPUT("Huge pages: " << stats.hugetlbMappings << " hugetlb mappings (" << (stats.hugetlbBytes >> 20) << " MB), "
+			<< stats.transparentMappings << " THP fallback mappings (" << (stats.transparentBytes >> 20) << " MB), "
+			<< (transparentHugePageBytes >> 20) << " MB backed by THP after prepare");
+	}
+
+	if (countAllocations) {
+		std::int64_t runCalls = 0;
+		for (int i = 0; i < numThreads; i++) {
+			int numRuns = numRunsPerThread + ((i==0)? runsAdjustment : 0);
+			for (int rep = 0; rep < replicates; rep++) {
+				int repRuns = numRuns / replicates + ((rep == 0) ? numRuns % replicates : 0);
+				int chunkRuns = (chunk > 0 && chunk < repRuns) ? chunk : repRuns;
+				runCalls += chunkRuns > 0 ? repRuns / chunkRuns + (repRuns % chunkRuns > 0) : 1;
+			}
+		}
+		allocation_counter::printReport(std::cout, runCalls * repeats);
+	}
+
 	timer.printTime("total");
+	PhaseProfiler::printReport(std::cout);
+	if (!tracePath.empty()) {
+		if (TraceRecorder::writeJson(tracePath)) {
+			INFO_OUTPUT("Trace written to " << tracePath);
+		} else {
+			ERROR_OUTPUT("Failed to write trace to " << tracePath);
+		}
+	}
+	if (dumpWriter) {
+		if (!dumpWriter->close()) {
+			ERROR_OUTPUT("Failed to write the dump: " << dumpWriter->getError());
+			return 1;
+		}
+		double writeSeconds = dumpWriter->getWriteSeconds();
+		INFO_OUTPUT("Dumped " << dumpWriter->getCount() << " ratios (" << (dumpWriter->getBytes() >> 20) << " MB) to " << dumpPath
+			<< (dumpWriter->isDirect() ? "" : " (page cache)") << ", writer busy " << writeSeconds << " s ("
+			<< (writeSeconds > 0 ? dumpWriter->getBytes() / writeSeconds / 1e9 : 0.0) << " GB/s)");
+		// the workers only lose time when the writer falls a whole block behind
+		INFO_OUTPUT("Dump stalls: " << dumpWriter->getStallSeconds() << " s over all workers, "
+			<< 100.0 * dumpWriter->getStallSeconds() / (timer.getTimeElapsed().count() * numThreads) << "% of the worker time");
+	}
+	if (options.distribution) {
+		ratio_distribution::Distribution pooled {};
+		for (auto& workerDistribution : distributions) {
+			pooled.merge(workerDistribution);
+		}
+		ratio_distribution::printDistribution(std::cout, pooled);
+		if (!distributionCsv.empty()) {
+			if (ratio_distribution::writeCsv(distributionCsv, pooled)) {
+				INFO_OUTPUT("Ratio histogram written to " << distributionCsv);
+			} else {
+				ERROR_OUTPUT("Failed to write the ratio histogram to " << distributionCsv);
+			}
+		}
+	}
+	if (entropyFile) {
+		// every worker starts at its own share of the file; one that reads past it reuses another's values
+		std::uint64_t share = entropyFile->getHeader().count / numThreads;
+		std::uint64_t mostTaken = *std::max_element(replayTaken.begin(), replayTaken.end());
+		VERBOSE_OUTPUT("Replay: at most " << mostTaken << " of " << share << " values per worker");
+		if (mostTaken > share) {
+			INFO_OUTPUT("WARN: workers read " << mostTaken << " values of " << replayPath << " but have " << share
+				<< " each, so samples repeat; generate a larger file for independent samples");
+		}
+	}
 
 	return 0;
 }
@@ -300,6 +1252,393 @@ int main2(int argc, char* argv[]) {
 	return 0;
 }
 
+/**
+ * `main stats <pid>`: follows the live stats of a harness run started with --live.
+ */
+int mainStats(int argc, char* argv[]) {
+	int pid = 0;
+	int intervalSeconds = 1;
+
+	argparse::ArgumentParser program("stats");
+	program.add_argument("pid").help("process id of the harness run").scan<'i', int>();
+	program.add_argument("-i", "--interval").help("seconds between snapshots").default_value(intervalSeconds).scan<'i', int>();
+
+	try {
+		program.parse_args(argc, argv);
+	} catch (const std::runtime_error& err) {
+		std::cerr << err.what() << std::endl;
+		std::cerr << program;
+		return 1;
+	}
+
+	pid = program.get<int>("pid");
+	intervalSeconds = std::max(1, program.get<int>("--interval"));
+
+	live_stats::Segment segment {static_cast<pid_t>(pid)};
+	if (!segment.isOpen()) {
+		ERROR_OUTPUT("No live stats: " << segment.getError());
+		return 1;
+	}
+	// the segment stays mapped after the run removes it, so the last snapshot is still there
+	while (true) {
+		live_stats::Snapshot snapshot = segment.read();
+		live_stats::printSnapshot(std::cout, snapshot);
+		if (snapshot.done || kill(pid, 0) != 0) {
+			break;
+		}
+		std::this_thread::sleep_for(std::chrono::seconds(intervalSeconds));
+	}
+	return 0;
+}
+
+/**
+ * `main ingest <file>`: evaluates the polygons of a columnar polygon file, see PolygonIngest.h.
+ */
+int mainIngest(int argc, char* argv[]) {
+	std::string path = "";
+	int threads = Concurrency::get_usable_cpu_count();
+	std::string placementName = "compact";
+	std::string ratiosPath = "";
+	long long create = 0;
+	int ngon = 3;
+	bool useFloat = false;
+	bool verbose = false;
+
+	argparse::ArgumentParser program("ingest");
+	program.add_argument("file").help("columnar polygon file (geometry/PolygonFile.h)");
+	program.add_argument("-t", "--threads").help("number of worker threads").default_value(threads).scan<'i', int>();
+	program.add_argument("--placement").help("worker placement over the allowed CPUs: compact, scatter or smt").default_value(placementName);
+	program.add_argument("--ratios").help("write every polygon's ratio to this file, as a raw column of the file's coordinate type").default_value(ratiosPath);
+	program.add_argument("--create").help("first write a file of this many random polygons").default_value(create).scan<'i', long long>();
+	program.add_argument("-g", "--ngon").help("with --create, vertices per polygon").default_value(ngon).scan<'i', int>();
+	program.add_argument("--float").help("with --create, store float instead of double coordinates").default_value(useFloat).implicit_value(true);
+	program.add_argument("-v", "--verbose").help("verbose output").default_value(verbose).implicit_value(true);
+
+	try {
+		program.parse_args(argc, argv);
+	} catch (const std::runtime_error& err) {
+		std::cerr << err.what() << std::endl;
+		std::cerr << program;
+		return 1;
+	}
+
+	path = program.get<std::string>("file");
+	threads = std::max(1, program.get<int>("--threads"));
+	placementName = program.get<std::string>("--placement");
+	ratiosPath = program.get<std::string>("--ratios");
+	create = std::max(0LL, program.get<long long>("--create"));
+	ngon = program.get<int>("--ngon");
+	useFloat = program.get<bool>("--float");
+	verbose = program.get<bool>("--verbose");
+
+	auto placement = Concurrency::parse_placement(placementName);
+	if (!placement) {
+		ERROR_OUTPUT("Invalid placement: " << placementName);
+		return 1;
+	}
+	if (create > 0) {
+		if (ngon < 3) {
+			ERROR_OUTPUT("Invalid ngon: " << ngon << ", must be at least 3");
+			return 1;
+		}
+		Timer createTimer {false};
+		createTimer.start();
+		const std::string error {useFloat ? polygon_ingest::createRandomFile<float>(path, create, ngon)
+			: polygon_ingest::createRandomFile<double>(path, create, ngon)};
+		createTimer.stop();
+		if (!error.empty()) {
+			ERROR_OUTPUT("Cannot create " << path << ": " << error);
+			return 1;
+		}
+		VERBOSE_OUTPUT("Created " << create << " polygons in " << createTimer.getTimeElapsed().count() << " s");
+	}
+
+	geometry::PolygonFile file {path};
+	if (!file.isOpen()) {
+		ERROR_OUTPUT("Cannot read polygons: " << file.getError());
+		return 1;
+	}
+	const auto& header = file.getHeader();
+	if (header.polygonCount == 0) {
+		ERROR_OUTPUT(path << " has no polygons");
+		return 1;
+	}
+	threads = static_cast<int>(std::min<std::uint64_t>(threads, header.polygonCount));
+	const std::vector<int> cpus {Concurrency::get_placement_order(*placement)};
+	VERBOSE_OUTPUT("Ingesting " << header.polygonCount << " polygons (" << (file.getFileSize() >> 20) << " MB) with " << threads << " threads");
+
+	MappedFile ratioFile {};
+	if (!ratiosPath.empty()) {
+		ratioFile = MappedFile {ratiosPath, static_cast<std::size_t>(header.polygonCount * header.floatBytes)};
+		if (!ratioFile.isOpen()) {
+			ERROR_OUTPUT("Cannot write ratios: " << ratioFile.getError());
+			return 1;
+		}
+	}
+
+	polygon_ingest::Result result {};
+	if (header.floatBytes == sizeof(float)) {
+		std::span<float> ratios {reinterpret_cast<float*>(ratioFile.data()), ratioFile.isOpen() ? static_cast<std::size_t>(header.polygonCount) : 0};
+		result = polygon_ingest::run<float>(file, threads, cpus, ratios);
+	} else {
+		std::span<double> ratios {reinterpret_cast<double*>(ratioFile.data()), ratioFile.isOpen() ? static_cast<std::size_t>(header.polygonCount) : 0};
+		result = polygon_ingest::run<double>(file, threads, cpus, ratios);
+	}
+	polygon_ingest::printResult(std::cout, result, file);
+	for (std::size_t i {0}; i < result.workerSeconds.size(); i++) {
+		VERBOSE_OUTPUT("Worker " << i << ": " << result.workerSeconds[i] << " s");
+	}
+	if (ratioFile.isOpen() && !ratioFile.sync()) {
+		ERROR_OUTPUT("Cannot write ratios: " << ratioFile.getError());
+		return 1;
+	}
+	return 0;
+}
+
+/**
+ * `main generate <file>`: writes an entropy file for --replay, see EntropyGenerator.h.
+ */
+int mainGenerate(int argc, char* argv[]) {
+	std::string path = "";
+	long long count = 1LL << 30;
+	std::string kindName = "words";
+	long long seed = 1;
+	int threads = Concurrency::get_usable_cpu_count();
+
+	argparse::ArgumentParser program("generate");
+	program.add_argument("file").help("entropy file to write");
+	program.add_argument("-n", "--count").help("number of values").default_value(count).scan<'i', long long>();
+	program.add_argument("--kind").help("words (32-bit, for every simulation) or coordinates (doubles in [1, 2], for mc and conditional)").default_value(kindName);
+	program.add_argument("--seed").help("seed; the file depends on nothing else").default_value(seed).scan<'i', long long>();
+	program.add_argument("-t", "--threads").help("number of generating threads").default_value(threads).scan<'i', int>();
+
+	try {
+		program.parse_args(argc, argv);
+	} catch (const std::runtime_error& err) {
+		std::cerr << err.what() << std::endl;
+		std::cerr << program;
+		return 1;
+	}
+
+	path = program.get<std::string>("file");
+	count = program.get<long long>("--count");
+	kindName = program.get<std::string>("--kind");
+	seed = program.get<long long>("--seed");
+	threads = std::max(1, program.get<int>("--threads"));
+
+	using Kind = simulation::EntropyFileHeader::Kind;
+	std::optional<Kind> kind {};
+	if (kindName == "words") {
+		kind = Kind::Words;
+	} else if (kindName == "coordinates") {
+		kind = Kind::Coordinates;
+	}
+	if (!kind) {
+		ERROR_OUTPUT("Invalid kind: " << kindName);
+		return 1;
+	}
+	if (count <= 0) {
+		ERROR_OUTPUT("Invalid count: " << count);
+		return 1;
+	}
+
+	Timer timer {false};
+	timer.start();
+	const std::string error = entropy_generator::generate(path, *kind, static_cast<std::uint64_t>(count), static_cast<std::uint64_t>(seed), threads);
+	timer.stop();
+	if (!error.empty()) {
+		ERROR_OUTPUT("Cannot generate " << path << ": " << error);
+		return 1;
+	}
+	double seconds = timer.getTimeElapsed().count();
+	INFO_OUTPUT("Wrote " << count << " " << kindName << " to " << path << " in " << seconds << " s (" << count / seconds / 1e6 << " M values/s)");
+	return 0;
+}
+
+int mainServe(int argc, char* argv[]) {
+	std::string socketPath = "";
+	int threads = Concurrency::get_usable_cpu_count();
+	std::string placementName = "compact";
+	bool verbose = false;
+
+	argparse::ArgumentParser program("serve");
+	program.add_argument("socket").help("Unix domain socket to listen on");
+	program.add_argument("-t", "--threads").help("number of worker threads").default_value(threads).scan<'i', int>();
+	program.add_argument("--placement").help("worker placement over the allowed CPUs: compact, scatter or smt").default_value(placementName);
+	program.add_argument("-v", "--verbose").help("verbose output").default_value(verbose).implicit_value(true);
+
+	try {
+		program.parse_args(argc, argv);
+	} catch (const std::runtime_error& err) {
+		std::cerr << err.what() << std::endl;
+		std::cerr << program;
+		return 1;
+	}
+
+	socketPath = program.get<std::string>("socket");
+	threads = std::max(1, program.get<int>("--threads"));
+	placementName = program.get<std::string>("--placement");
+	verbose = program.get<bool>("--verbose");
+
+	auto placement = Concurrency::parse_placement(placementName);
+	if (!placement) {
+		ERROR_OUTPUT("Invalid placement: " << placementName);
+		return 1;
+	}
+	std::string error {};
+	const int listenFd = simulation_daemon::listenOn(socketPath, error);
+	if (listenFd < 0) {
+		ERROR_OUTPUT("Cannot listen: " << error);
+		return 1;
+	}
+	simulation_daemon::installStopHandler();
+
+	auto validate = [](const simulation_daemon::Request& request) -> std::string {
+		constexpr std::array<const char*, 10> servedSimulations = {"adrian1", "eugene1", "eugene2", "eugene3", "eugene4", "eugene5", "mc", "sobol", "vr", "conditional"};
+		if (std::find(servedSimulations.begin(), servedSimulations.end(), request.simulation) == servedSimulations.end()) {
+			return "invalid simulation name: " + request.simulation;
+		}
+		if (request.ngon < 3 || ((request.simulation == "eugene4" || request.simulation == "conditional") && request.ngon != 3)) {
+			return "invalid ngon for " + request.simulation + ": " + std::to_string(request.ngon);
+		}
+		if (request.n < 1 || request.n > simulation_daemon::kMaxRuns) {
+			return "invalid n: " + std::to_string(request.n);
+		}
+		if (!(request.precision >= 0)) {
+			return "invalid precision";
+		}
+		return "";
+	};
+	auto makeDaemonSimulation = [](const std::string& name, int runs, int ngon) {
+		return makeSimulation(name, runs, ngon);
+	};
+	{
+		simulation_daemon::Pool pool {threads, Concurrency::get_placement_order(*placement), makeDaemonSimulation};
+		INFO_OUTPUT("Serving on " << socketPath << " with " << threads << " workers");
+		if (!simulation_daemon::serve(listenFd, pool, validate, error)) {
+			ERROR_OUTPUT("Cannot serve: " << error);
+		} else {
+			VERBOSE_OUTPUT("Stopping: " << pool.getStats());
+		}
+	}
+	close(listenFd);
+	unlink(socketPath.c_str());
+	return error.empty() ? 0 : 1;
+}
+
+int mainQuery(int argc, char* argv[]) {
+	std::string socketPath = "";
+	std::string simulationName = "adrian1";
+	int ngon = 3;
+	long long nsims = 1000;
+	long long seed = -1;
+	double precision = 0;
+	int count = 1;
+	bool stats = false;
+
+	argparse::ArgumentParser program("query");
+	program.add_argument("socket").help("Unix domain socket of `main serve`");
+	program.add_argument("-s", "--simulation").help("simulation name").default_value(simulationName);
+	program.add_argument("-g", "--ngon").help("number of points of the polygon").default_value(ngon).scan<'i', int>();
+	program.add_argument("-n", "--nsims").help("number of simulations, the upper bound with --precision").default_value(nsims).scan<'i', long long>();
+	program.add_argument("--seed").help("seed for a repeatable result, negative for a random one").default_value(seed).scan<'i', long long>();
+	program.add_argument("--precision").help("stop at this standard error").default_value(precision).scan<'g', double>();
+	program.add_argument("--count").help("send the job this many times, one after the other, and report the latency percentiles").default_value(count).scan<'i', int>();
+	program.add_argument("--stats").help("print the daemon's job count and latency percentiles instead").default_value(stats).implicit_value(true);
+
+	try {
+		program.parse_args(argc, argv);
+	} catch (const std::runtime_error& err) {
+		std::cerr << err.what() << std::endl;
+		std::cerr << program;
+		return 1;
+	}
+
+	socketPath = program.get<std::string>("socket");
+	simulationName = program.get<std::string>("--simulation");
+	ngon = program.get<int>("--ngon");
+	nsims = program.get<long long>("--nsims");
+	seed = program.get<long long>("--seed");
+	precision = program.get<double>("--precision");
+	count = std::max(1, program.get<int>("--count"));
+	stats = program.get<bool>("--stats");
+
+	std::string error {};
+	const int fd = simulation_daemon::connectTo(socketPath, error);
+	if (fd < 0) {
+		ERROR_OUTPUT("Cannot connect: " << error);
+		return 1;
+	}
+	simulation_daemon::Connection connection {fd};
+	std::string input {};
+	auto readLine = [&]() -> std::optional<std::string> {
+		while (input.find('\n') == std::string::npos) {
+			char buffer[4096];
+			const ssize_t received = recv(fd, buffer, sizeof(buffer), 0);
+			if (received <= 0) {
+				return std::nullopt;
+			}
+			input.append(buffer, static_cast<std::size_t>(received));
+		}
+		std::string line = input.substr(0, input.find('\n'));
+		input.erase(0, line.size() + 1);
+		return line;
+	};
+
+	if (stats) {
+		connection.send(simulation_daemon::JsonWriter {}.add("command", "stats").str());
+		auto line = readLine();
+		if (!line) {
+			ERROR_OUTPUT("The daemon closed the connection");
+			return 1;
+		}
+		INFO_OUTPUT(*line);
+		return 0;
+	}
+
+	std::vector<double> latencies {};
+	for (int i = 0; i < count; i++) {
+		simulation_daemon::JsonWriter request {};
+		request.add("id", i).add("simulation", simulationName).add("ngon", ngon).add("n", nsims).add("precision", precision);
+		if (seed >= 0) {
+			request.add("seed", seed);
+		}
+		const auto sent = std::chrono::steady_clock::now();
+		connection.send(request.str());
+		auto line = readLine();
+		if (!line) {
+			ERROR_OUTPUT("The daemon closed the connection");
+			return 1;
+		}
+		latencies.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - sent).count());
+		if (i == count - 1 || line->find("\"ok\": false") != std::string::npos) {
+			INFO_OUTPUT(*line);
+		}
+	}
+	if (count > 1) {
+		std::sort(latencies.begin(), latencies.end());
+		auto percentile = [&](double p) { return latencies[static_cast<std::size_t>(p * (latencies.size() - 1))]; };
+		INFO_OUTPUT("Latency over " << count << " jobs: p50 " << percentile(0.5) << " ms, p99 " << percentile(0.99)
+			<< " ms, max " << latencies.back() << " ms");
+	}
+	return 0;
+}
+
 int main(int argc, char* argv[]) {
+	if (argc > 1 && std::string_view {argv[1]} == "stats") {
+		return mainStats(argc - 1, argv + 1);
+	}
+	if (argc > 1 && std::string_view {argv[1]} == "ingest") {
+		return mainIngest(argc - 1, argv + 1);
+	}
+	if (argc > 1 && std::string_view {argv[1]} == "generate") {
+		return mainGenerate(argc - 1, argv + 1);
+	}
+	if (argc > 1 && std::string_view {argv[1]} == "serve") {
+		return mainServe(argc - 1, argv + 1);
+	}
+	if (argc > 1 && std::string_view {argv[1]} == "query") {
+		return mainQuery(argc - 1, argv + 1);
+	}
 	return main1(argc, argv);
 }
@@ -0,0 +1,57 @@
+#ifndef AMBIENT_SCOPE_H
+#define AMBIENT_SCOPE_H
+
+/**
+ * Per-thread ambient state: an object the code deep inside a simulation finds on its thread instead
+ * of being handed it, such as the memory resource, the seed source, the replay stream or a ratio
+ * sink.  The harness installs one per worker with an AmbientScope around the work; objects look it
+ * up when they are constructed and keep it, so every worker's simulations use that worker's, without
+ * their constructors, or the simulations between them and the harness, knowing about it.
+ *
+ * There is one slot per type and thread, nullptr until a scope sets it.
+ */
+template <typename T>
+class ThreadLocalSlot {
+public:
+	/**
+	 * @return The calling thread's object, nullptr if it has none.
+	 */
+	static T* get() {
+		return getSlot();
+	}
+
+private:
+	template <typename>
+	friend class AmbientScope;
+
+	static T*& getSlot() {
+		thread_local T* value {nullptr};
+		return value;
+	}
+};
+
+/**
+ * Makes an object the calling thread's ThreadLocalSlot<T> until the end of the scope, then restores
+ * the previous one, so scopes nest.  The object must outlive everything that took it.
+ */
+template <typename T>
+class AmbientScope {
+public:
+	explicit AmbientScope(T* value) :
+		m_previous {ThreadLocalSlot<T>::getSlot()}
+	{
+		ThreadLocalSlot<T>::getSlot() = value;
+	}
+
+	~AmbientScope() {
+		ThreadLocalSlot<T>::getSlot() = m_previous;
+	}
+
+	AmbientScope(const AmbientScope&) = delete;
+	AmbientScope& operator=(const AmbientScope&) = delete;
+
+private:
+	T* m_previous;
+};
+
+#endif
@@ -1,13 +1,21 @@
 #ifndef CONCURRENCY_H
 #define CONCURRENCY_H
 
+#include <algorithm>
+#include <cctype>
+#include <cmath>
 #include <cstdio>
 #include <fstream>
 #include <iostream>
+#include <iterator>
 #include <map>
+#include <optional>
 #include <pthread.h>
 #include <sched.h>
 #include <set>
+#include <sstream>
+#include <string>
+#include <sys/mman.h>
 #include <unistd.h>
 #include <utility>
 #include <utility>
@@ -16,6 +24,26 @@
 class Concurrency {
 public:
 
+  /**
+   * Thread placement policies, see get_placement_order().
+   */
+  enum class Placement { Compact, Scatter, Smt };
+
+  /**
+   * Parses a placement policy name: "compact", "scatter" or "smt".
+   * @return The placement, or std::nullopt if the name is unknown.
+   */
+  static std::optional<Placement> parse_placement(const std::string& name) {
+    if (name == "compact") {
+      return Placement::Compact;
+    } else if (name == "scatter") {
+      return Placement::Scatter;
+    } else if (name == "smt") {
+      return Placement::Smt;
+    }
+    return std::nullopt;
+  }
+
   /**
    * Returns the number of physical CPU sockets (packages) on the machine.
    * This reads from sysfs to determine unique physical package IDs.
@@ -230,6 +258,24 @@ public:
     return true;
   }
 
+  /**
+   * Lets the current thread run on any of the given CPUs, e.g. to undo pin_to_core() before
+   * starting threads that inherit the mask.
+   * @param cpu_ids The CPU IDs; an empty list leaves the mask unchanged.
+   * @return True if the mask was set, false otherwise.
+   */
+  static bool set_affinity(const std::vector<int>& cpu_ids) {
+    if (cpu_ids.empty()) {
+      return false;
+    }
+    cpu_set_t cpuset;
+    CPU_ZERO(&cpuset);
+    for (int cpu_id : cpu_ids) {
+      CPU_SET(cpu_id, &cpuset);
+    }
+    return pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &cpuset) == 0;
+  }
+
   /**
    * Checks if the current thread is pinned to a specific subset of cores.
    * Returns true if the affinity mask is NOT set to all available cores.
@@ -259,6 +305,375 @@ public:
     // we consider it "pinned" (restricted).
     return count < total_procs;
   }
+
+  /**
+   * Parses a kernel CPU list such as "0-3,8,10-11", the format of the cpuset files.
+   * @return The listed CPU IDs in ascending order, or an empty vector if the list is malformed.
+   */
+  static std::vector<int> parse_cpu_list(const std::string& list) {
+    std::set<int> cpus;
+    std::stringstream stream(list);
+    std::string range;
+    while (std::getline(stream, range, ',')) {
+      range.erase(std::remove_if(range.begin(), range.end(), [](unsigned char c) { return std::isspace(c); }), range.end());
+      if (range.empty()) {
+        continue;
+      }
+      size_t dash = range.find('-');
+      int first, last;
+      try {
+        first = std::stoi(range.substr(0, dash));
+        last = dash == std::string::npos ? first : std::stoi(range.substr(dash + 1));
+      } catch (const std::exception&) {
+        return {};
+      }
+      if (first < 0 || last < first) {
+        return {};
+      }
+      for (int cpu = first; cpu <= last; ++cpu) {
+        cpus.insert(cpu);
+      }
+    }
+    return std::vector<int>(cpus.begin(), cpus.end());
+  }
+
+  /**
+   * Returns the logical CPUs the calling thread may run on: its scheduler affinity mask
+   * (set by taskset, numactl or the container runtime), intersected with the cgroup cpuset.
+   * Call it before pinning, since pinning narrows the mask to a single CPU.
+   * @return The allowed logical CPU IDs in ascending order, or an empty vector on error.
+   */
+  static std::vector<int> get_allowed_cpus() {
+    std::vector<int> allowed;
+    int num_cpus = std::max(get_num_cores(), 1024);
+    cpu_set_t* cpuset = CPU_ALLOC(num_cpus);
+    size_t size = CPU_ALLOC_SIZE(num_cpus);
+    CPU_ZERO_S(size, cpuset);
+    if (sched_getaffinity(0, size, cpuset) == 0) {
+      for (int cpu = 0; cpu < num_cpus; ++cpu) {
+        if (CPU_ISSET_S(cpu, size, cpuset)) {
+          allowed.push_back(cpu);
+        }
+      }
+    }
+    CPU_FREE(cpuset);
+
+    // the affinity mask normally already reflects the cpuset, but a process that widened its own
+    // mask, or an older kernel, can disagree with it
+    std::vector<int> cpuset_cpus = get_cgroup_cpuset();
+    if (!cpuset_cpus.empty()) {
+      std::vector<int> intersection;
+      std::set_intersection(allowed.begin(), allowed.end(), cpuset_cpus.begin(), cpuset_cpus.end(),
+                            std::back_inserter(intersection));
+      if (!intersection.empty()) {
+        allowed = std::move(intersection);
+      }
+    }
+    return allowed;
+  }
+
+  /**
+   * Returns the CPU bandwidth limit of this process's cgroup in CPUs, e.g. 2.5 for a
+   * Kubernetes limit of 2500m.  Reads cgroup v2 cpu.max or cgroup v1 cpu.cfs_quota_us and
+   * cpu.cfs_period_us, taking the tightest limit of the cgroup and its ancestors.
+   * @return The quota in CPUs, or -1 if there is no limit or no cgroup information.
+   */
+  static double get_cpu_quota() {
+    double quota = -1;
+    auto tighten = [&quota](double limit) {
+      if (limit > 0 && (quota < 0 || limit < quota)) {
+        quota = limit;
+      }
+    };
+
+    auto [v2_mount, v2_dir] = get_cgroup_mount_and_dir("");
+    for (std::string dir = v2_dir; !dir.empty(); dir = get_parent_cgroup_dir(dir, v2_mount)) {
+      std::ifstream file(dir + "/cpu.max");
+      std::string max;
+      long long period;
+      if (file >> max >> period && max != "max" && period > 0) {
+        tighten(std::stoll(max) / static_cast<double>(period));
+      }
+    }
+
+    auto [v1_mount, v1_dir] = get_cgroup_mount_and_dir("cpu");
+    for (std::string dir = v1_dir; !dir.empty(); dir = get_parent_cgroup_dir(dir, v1_mount)) {
+      std::ifstream quota_file(dir + "/cpu.cfs_quota_us");
+      std::ifstream period_file(dir + "/cpu.cfs_period_us");
+      long long quota_us, period_us;
+      if ((quota_file >> quota_us) && (period_file >> period_us) && quota_us > 0 && period_us > 0) {
+        tighten(quota_us / static_cast<double>(period_us));
+      }
+    }
+    return quota;
+  }
+
+  /**
+   * Returns the number of CPUs this process can keep busy: the allowed CPUs, capped by the
+   * cgroup CPU quota (rounded down, so a fractional quota is never oversubscribed).
+   * @return The number of usable CPUs, at least 1.
+   */
+  static int get_usable_cpu_count() {
+    int usable = static_cast<int>(get_allowed_cpus().size());
+    if (usable == 0) {
+      usable = get_num_available_cores();
+    }
+    double quota = get_cpu_quota();
+    if (quota > 0) {
+      usable = std::min(usable, static_cast<int>(std::floor(quota)));
+    }
+    return std::max(usable, 1);
+  }
+
+  /**
+   * Returns the mapping of physical cores to logical CPUs (see get_physical_core_mapping()),
+   * restricted to the CPUs this process is allowed to run on.  Cores without any allowed CPU are left out.
+   * @return Map from (socket_id, core_id) pairs to vectors of allowed logical CPU IDs.
+   */
+  static std::map<std::pair<int, int>, std::vector<int>> get_allowed_physical_core_mapping() {
+    std::vector<int> allowed = get_allowed_cpus();
+    std::map<std::pair<int, int>, std::vector<int>> core_map;
+    for (const auto& [core_key, logical_cpus] : get_physical_core_mapping()) {
+      for (int cpu : logical_cpus) {
+        if (std::binary_search(allowed.begin(), allowed.end(), cpu)) {
+          core_map[core_key].push_back(cpu);
+        }
+      }
+    }
+    return core_map;
+  }
+
+  /**
+   * Returns the allowed logical CPUs in the order threads should be placed on them.
+   * - Compact: the first hardware thread of every core, cores in (socket, core) order, then the
+   *   second hardware thread of every core, and so on.  Threads share as few caches as possible
+   *   without leaving a socket before it is full.
+   * - Scatter: like compact, but alternating between sockets, to spread memory bandwidth and heat.
+   * - Smt: all hardware threads of a core before moving on to the next core, for pipelines
+   *   whose threads share data through the core's caches.
+   * Falls back to the allowed CPUs in ascending order if the topology is unknown.
+   * @param placement The placement policy.
+   * @return The allowed logical CPU IDs, in placement order.
+   */
+  static std::vector<int> get_placement_order(Placement placement) {
+    auto core_map = get_allowed_physical_core_mapping();
+    if (core_map.empty()) {
+      return get_allowed_cpus();
+    }
+
+    // cores grouped by socket, in core order
+    std::map<int, std::vector<std::vector<int>>> sockets;
+    size_t max_threads_per_core = 0;
+    for (const auto& [core_key, logical_cpus] : core_map) {
+      sockets[core_key.first].push_back(logical_cpus);
+      max_threads_per_core = std::max(max_threads_per_core, logical_cpus.size());
+    }
+
+    std::vector<std::vector<int>> cores;
+    if (placement == Placement::Scatter) {
+      for (size_t index = 0; cores.size() < core_map.size(); ++index) {
+        for (const auto& [socket_id, socket_cores] : sockets) {
+          if (index < socket_cores.size()) {
+            cores.push_back(socket_cores[index]);
+          }
+        }
+      }
+    } else {
+      for (const auto& [socket_id, socket_cores] : sockets) {
+        cores.insert(cores.end(), socket_cores.begin(), socket_cores.end());
+      }
+    }
+
+    std::vector<int> order;
+    if (placement == Placement::Smt) {
+      for (const auto& logical_cpus : cores) {
+        order.insert(order.end(), logical_cpus.begin(), logical_cpus.end());
+      }
+    } else {
+      for (size_t thread = 0; thread < max_threads_per_core; ++thread) {
+        for (const auto& logical_cpus : cores) {
+          if (thread < logical_cpus.size()) {
+            order.push_back(logical_cpus[thread]);
+          }
+        }
+      }
+    }
+    return order;
+  }
+
+  /**
+   * Returns the CPUs the kernel keeps free of housekeeping work: those isolated from the scheduler
+   * (isolcpus=) and those running tickless (nohz_full=), limited to the cgroup cpuset if there is one.
+   * Isolated CPUs are usually missing from the default affinity mask, but can still be pinned to.
+   * @return The isolated logical CPU IDs in ascending order, empty if there are none.
+   */
+  static std::vector<int> get_isolated_cpus() {
+    std::set<int> isolated;
+    for (const char* path : {"/sys/devices/system/cpu/isolated", "/sys/devices/system/cpu/nohz_full"}) {
+      std::ifstream file(path);
+      std::string list;
+      // nohz_full reads "(null)" when the kernel was booted without it
+      if (std::getline(file, list) && list.find('(') == std::string::npos) {
+        for (int cpu : parse_cpu_list(list)) {
+          isolated.insert(cpu);
+        }
+      }
+    }
+
+    std::vector<int> cpus(isolated.begin(), isolated.end());
+    std::vector<int> cpuset_cpus = get_cgroup_cpuset();
+    if (!cpuset_cpus.empty()) {
+      std::vector<int> intersection;
+      std::set_intersection(cpus.begin(), cpus.end(), cpuset_cpus.begin(), cpuset_cpus.end(),
+                            std::back_inserter(intersection));
+      cpus = std::move(intersection);
+    }
+    return cpus;
+  }
+
+  /**
+   * Switches the current thread to the SCHED_FIFO real-time policy, so that no ordinary thread
+   * can preempt it.  Needs CAP_SYS_NICE or an RLIMIT_RTPRIO allowance.
+   * @param priority The real-time priority, clamped to the range SCHED_FIFO supports.
+   * @return True if the policy was applied, false otherwise.
+   */
+  static bool set_realtime_priority(int priority) {
+    sched_param param {};
+    param.sched_priority = std::clamp(priority, sched_get_priority_min(SCHED_FIFO), sched_get_priority_max(SCHED_FIFO));
+    int result = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+    if (result != 0) {
+      std::cerr << "Error setting SCHED_FIFO priority " << param.sched_priority << std::endl;
+      return false;
+    }
+    return true;
+  }
+
+  /**
+   * Locks all pages currently mapped by the process into memory, so that none of them can be
+   * paged out (or, for file mappings, dropped) while timing.  Pages mapped later are not locked,
+   * which keeps large later allocations from failing against RLIMIT_MEMLOCK.
+   * @return True if the pages were locked, false otherwise.
+   */
+  static bool lock_memory() {
+    if (mlockall(MCL_CURRENT) != 0) {
+      std::cerr << "Error locking process memory" << std::endl;
+      return false;
+    }
+    return true;
+  }
+
+private:
+
+  /**
+   * Locates this process's cgroup for a controller by resolving its path from /proc/self/cgroup
+   * against the hierarchy's mount in /proc/self/mountinfo, which also works inside a container's
+   * cgroup namespace.
+   * @param controller A cgroup v1 controller such as "cpu" or "cpuset", or "" for the cgroup v2 hierarchy.
+   * @return The mount point and the cgroup directory, both empty if the hierarchy is not mounted.
+   */
+  static std::pair<std::string, std::string> get_cgroup_mount_and_dir(const std::string& controller) {
+    auto has_controller = [&controller](const std::string& list) {
+      std::stringstream stream(list);
+      std::string item;
+      while (std::getline(stream, item, ',')) {
+        if (item == controller) {
+          return true;
+        }
+      }
+      return false;
+    };
+
+    // "hierarchy-id:controller-list:path", with hierarchy 0 and no controllers for cgroup v2
+    std::string cgroup_path;
+    bool found = false;
+    std::ifstream cgroup_file("/proc/self/cgroup");
+    std::string line;
+    while (!found && std::getline(cgroup_file, line)) {
+      size_t first_colon = line.find(':');
+      size_t second_colon = line.find(':', first_colon + 1);
+      if (first_colon == std::string::npos || second_colon == std::string::npos) {
+        continue;
+      }
+      std::string controllers = line.substr(first_colon + 1, second_colon - first_colon - 1);
+      if (controller.empty() ? (line.compare(0, first_colon, "0") == 0 && controllers.empty()) : has_controller(controllers)) {
+        cgroup_path = line.substr(second_colon + 1);
+        found = true;
+      }
+    }
+    if (!found) {
+      return {};
+    }
+
+    // "id parent major:minor root mount-point options [optional fields] - fstype source super-options"
+    std::ifstream mountinfo_file("/proc/self/mountinfo");
+    while (std::getline(mountinfo_file, line)) {
+      size_t separator = line.find(" - ");
+      if (separator == std::string::npos) {
+        continue;
+      }
+      std::stringstream mount_fields(line.substr(0, separator));
+      std::stringstream fs_fields(line.substr(separator + 3));
+      std::string id, parent, device, root, mount_point, fstype, source, super_options;
+      mount_fields >> id >> parent >> device >> root >> mount_point;
+      fs_fields >> fstype >> source >> super_options;
+      bool matches = controller.empty() ? fstype == "cgroup2" : (fstype == "cgroup" && has_controller(super_options));
+      if (!matches) {
+        continue;
+      }
+      // the mount may expose only a subtree of the hierarchy
+      std::string relative = cgroup_path;
+      if (root != "/" && relative.compare(0, root.size(), root) == 0) {
+        relative = relative.substr(root.size());
+      }
+      std::string dir = relative == "/" ? mount_point : mount_point + relative;
+      if (access(dir.c_str(), F_OK) != 0) {
+        // a path from outside the container's view of the hierarchy
+        dir = mount_point;
+      }
+      return {mount_point, dir};
+    }
+    return {};
+  }
+
+  /**
+   * @return The parent of a cgroup directory, or an empty string once the mount point is reached.
+   */
+  static std::string get_parent_cgroup_dir(const std::string& dir, const std::string& mount_point) {
+    if (dir.size() <= mount_point.size()) {
+      return "";
+    }
+    return dir.substr(0, dir.rfind('/'));
+  }
+
+  /**
+   * @return The CPUs of this process's cgroup cpuset (v2 cpuset.cpus.effective, v1
+   *         cpuset.effective_cpus or cpuset.cpus), or an empty vector if there is none.
+   */
+  static std::vector<int> get_cgroup_cpuset() {
+    auto read_cpu_list = [](const std::string& path) {
+      std::ifstream file(path);
+      std::string list;
+      std::getline(file, list);
+      return parse_cpu_list(list);
+    };
+
+    auto [v2_mount, v2_dir] = get_cgroup_mount_and_dir("");
+    if (!v2_dir.empty()) {
+      std::vector<int> cpus = read_cpu_list(v2_dir + "/cpuset.cpus.effective");
+      if (!cpus.empty()) {
+        return cpus;
+      }
+    }
+    auto [v1_mount, v1_dir] = get_cgroup_mount_and_dir("cpuset");
+    if (!v1_dir.empty()) {
+      std::vector<int> cpus = read_cpu_list(v1_dir + "/cpuset.effective_cpus");
+      if (cpus.empty()) {
+        cpus = read_cpu_list(v1_dir + "/cpuset.cpus");
+      }
+      return cpus;
+    }
+    return {};
+  }
 };
 
 #endif
@@ -0,0 +1,168 @@
+#ifndef HUGE_PAGE_RESOURCE_H
+#define HUGE_PAGE_RESOURCE_H
+
+#include <atomic>
+#include <fstream>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory_resource>
+#include <mutex>
+#include <new>
+#include <string>
+#include <sys/mman.h>
+
+/**
+ * std::pmr memory resource that backs large buffers with huge pages, so the multi-gigabyte x / y
+ * arrays of the batch layouts need few TLB entries and take one page fault per 2 MB (or 1 GB)
+ * instead of one per 4 KB.
+ *
+ * Allocations of at least kMinBytes are mapped with MAP_HUGETLB from the hugetlbfs pool
+ * (vm.nr_hugepages, or nr_overcommit_hugepages); if the pool is empty they fall back to an ordinary
+ * mapping aligned to 2 MB and madvise(MADV_HUGEPAGE), which transparent huge pages serve when
+ * enabled ("always" or "madvise" in /sys/kernel/mm/transparent_hugepage/enabled).  THP only comes
+ * in 2 MB, so the fallback of a 1 GB resource is sized to 2 MB too, not to a whole gigabyte.
+ * Smaller allocations go to the upstream resource.  With prefault the kernel populates the mapping
+ * right away (MAP_POPULATE, or MADV_POPULATE_WRITE after the THP advice), which takes the faults
+ * where the buffer is allocated, i.e. in the simulations' prepare(), in one call instead of one
+ * trap per page on first touch.  Where the kernel has no MADV_POPULATE_WRITE (before 5.14) the THP
+ * fallback is touched page by page instead, still in prepare().
+ */
+class HugePageResource : public std::pmr::memory_resource {
+public:
+	static constexpr std::size_t kPageSize2M {std::size_t {1} << 21};
+	static constexpr std::size_t kPageSize1G {std::size_t {1} << 30};
+	static constexpr std::size_t kMinBytes {std::size_t {1} << 20};
+
+	/**
+	 * Mappings of all instances, by how they are backed.
+	 */
+	struct Stats {
+		std::atomic<std::int64_t> hugetlbMappings {0};
+		std::atomic<std::int64_t> transparentMappings {0};
+		std::atomic<std::int64_t> hugetlbBytes {0};
+		std::atomic<std::int64_t> transparentBytes {0};
+	};
+
+	/**
+	 * @param pageSize kPageSize2M or kPageSize1G.
+	 * @param prefault Populate every mapping when it is made.
+	 */
+	explicit HugePageResource(std::size_t pageSize = kPageSize2M, bool prefault = false,
+			std::pmr::memory_resource* upstream = std::pmr::new_delete_resource()) :
+		m_pageSize {pageSize},
+		m_prefault {prefault},
+		m_upstream {upstream}
+	{}
+
+	static Stats& getStats() {
+		static Stats stats {};
+		return stats;
+	}
+
+	/**
+	 * @return Bytes of this process's anonymous memory currently backed by transparent huge pages,
+	 *         -1 if /proc/self/smaps_rollup cannot be read.
+	 */
+	static std::int64_t getTransparentHugePageBytes() {
+		std::ifstream smaps("/proc/self/smaps_rollup");
+		std::string key;
+		std::int64_t kilobytes {0};
+		while (smaps >> key) {
+			if (key == "AnonHugePages:") {
+				smaps >> kilobytes;
+				return kilobytes * 1024;
+			}
+		}
+		return -1;
+	}
+
+private:
+	std::size_t m_pageSize;
+	bool m_prefault;
+	std::pmr::memory_resource* m_upstream;
+	// lengths of the fallback mappings, which deallocation cannot tell from hugetlb ones
+	std::mutex m_mutex {};
+	std::map<void*, std::size_t> m_transparentLengths {};
+
+	static std::size_t roundUp(std::size_t bytes, std::size_t pageSize) {
+		return (bytes + pageSize - 1) / pageSize * pageSize;
+	}
+
+	void* do_allocate(std::size_t bytes, std::size_t alignment) override {
+		if (bytes < kMinBytes || alignment > kPageSize2M) {
+			return m_upstream->allocate(bytes, alignment);
+		}
+		std::size_t length {roundUp(bytes, m_pageSize)};
+		const int populate {m_prefault ? MAP_POPULATE : 0};
+
+		const int pageSizeFlag {m_pageSize == kPageSize1G ? (30 << MAP_HUGE_SHIFT) : (21 << MAP_HUGE_SHIFT)};
+		void* memory {mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | pageSizeFlag | populate, -1, 0)};
+		if (memory != MAP_FAILED) {
+			getStats().hugetlbMappings.fetch_add(1, std::memory_order_relaxed);
+			getStats().hugetlbBytes.fetch_add(static_cast<std::int64_t>(length), std::memory_order_relaxed);
+			return memory;
+		}
+
+		// no hugetlb pages: over-map by one transparent huge page to align, trim, and ask for transparent
+		// huge pages before populating, so that the faults already get huge pages
+		length = roundUp(bytes, kPageSize2M);
+		void* raw {mmap(nullptr, length + kPageSize2M, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0)};
+		if (raw == MAP_FAILED) {
+			throw std::bad_alloc {};
+		}
+		const auto address = reinterpret_cast<std::uintptr_t>(raw);
+		const std::uintptr_t aligned {roundUp(address, kPageSize2M)};
+		if (aligned > address) {
+			munmap(raw, aligned - address);
+		}
+		const std::uintptr_t end {address + length + kPageSize2M};
+		if (end > aligned + length) {
+			munmap(reinterpret_cast<void*>(aligned + length), end - aligned - length);
+		}
+		memory = reinterpret_cast<void*>(aligned);
+		madvise(memory, length, MADV_HUGEPAGE);
+		if (m_prefault) {
+			// only what was asked for, the rest of the last page is never touched.  Kernels before 5.14
+			// reject MADV_POPULATE_WRITE (EINVAL), so failing that, touch one byte per page.
+			bool populated {false};
+#ifdef MADV_POPULATE_WRITE
+			populated = madvise(memory, bytes, MADV_POPULATE_WRITE) == 0;
+#endif
+			if (!populated) {
+				for (std::size_t offset {0}; offset < bytes; offset += 4096) {
+					static_cast<volatile char*>(memory)[offset] = 0;
+				}
+			}
+		}
+		{
+			std::lock_guard lock {m_mutex};
+			m_transparentLengths[memory] = length;
+		}
+		getStats().transparentMappings.fetch_add(1, std::memory_order_relaxed);
+		getStats().transparentBytes.fetch_add(static_cast<std::int64_t>(length), std::memory_order_relaxed);
+		return memory;
+	}
+
+	void do_deallocate(void* p, std::size_t bytes, std::size_t alignment) override {
+		if (bytes < kMinBytes || alignment > kPageSize2M) {
+			m_upstream->deallocate(p, bytes, alignment);
+			return;
+		}
+		std::size_t length {roundUp(bytes, m_pageSize)};
+		{
+			std::lock_guard lock {m_mutex};
+			if (auto transparent = m_transparentLengths.find(p); transparent != m_transparentLengths.end()) {
+				length = transparent->second;
+				m_transparentLengths.erase(transparent);
+			}
+		}
+		munmap(p, length);
+	}
+
+	bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+		return this == &other;
+	}
+};
+
+#endif
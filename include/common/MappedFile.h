@@ -0,0 +1,169 @@
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <fcntl.h>
+#include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <utility>
+
+/**
+ * A whole file mapped into memory: read only for existing files, read-write for files it creates
+ * with a given size.  Failures leave it closed with the reason in getError().
+ */
+class MappedFile {
+public:
+	MappedFile() = default;
+
+	/**
+	 * Maps an existing file read only.
+	 */
+	explicit MappedFile(const std::string& path) :
+		m_path {path}
+	{
+		const int fd {open(path.c_str(), O_RDONLY | O_CLOEXEC)};
+		if (fd < 0) {
+			setError("open");
+			return;
+		}
+		struct stat st {};
+		if (fstat(fd, &st) != 0) {
+			setError("fstat");
+			close(fd);
+			return;
+		}
+		m_size = static_cast<std::size_t>(st.st_size);
+		map(fd, PROT_READ);
+	}
+
+	/**
+	 * Creates (or truncates) a file of the given size and maps it read-write.  Writes go to the page
+	 * cache and reach the file when the kernel writes the pages back, or on sync().
+	 */
+	MappedFile(const std::string& path, std::size_t size) :
+		m_path {path},
+		m_size {size}
+	{
+		const int fd {open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644)};
+		if (fd < 0) {
+			setError("open");
+			return;
+		}
+		if (ftruncate(fd, static_cast<off_t>(size)) != 0) {
+			setError("ftruncate");
+			close(fd);
+			return;
+		}
+		map(fd, PROT_READ | PROT_WRITE);
+	}
+
+	~MappedFile() {
+		unmap();
+	}
+
+	MappedFile(MappedFile&& other) noexcept :
+		m_path {std::move(other.m_path)},
+		m_error {std::move(other.m_error)},
+		m_memory {std::exchange(other.m_memory, nullptr)},
+		m_size {std::exchange(other.m_size, 0)}
+	{}
+
+	MappedFile& operator=(MappedFile&& other) noexcept {
+		if (this != &other) {
+			unmap();
+			m_path = std::move(other.m_path);
+			m_error = std::move(other.m_error);
+			m_memory = std::exchange(other.m_memory, nullptr);
+			m_size = std::exchange(other.m_size, 0);
+		}
+		return *this;
+	}
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	bool isOpen() const {
+		return m_memory != nullptr;
+	}
+
+	const std::string& getError() const {
+		return m_error;
+	}
+
+	const std::string& getPath() const {
+		return m_path;
+	}
+
+	std::size_t size() const {
+		return m_size;
+	}
+
+	std::byte* data() const {
+		return static_cast<std::byte*>(m_memory);
+	}
+
+	/**
+	 * Passes an access pattern hint (MADV_SEQUENTIAL, MADV_WILLNEED, ...) for a byte range, widened
+	 * to whole pages.  Hints are best effort, so failures are ignored.
+	 */
+	void advise(int advice, std::size_t offset = 0, std::size_t length = SIZE_MAX) const {
+		if (!m_memory || offset >= m_size) {
+			return;
+		}
+		static const std::size_t pageSize {static_cast<std::size_t>(sysconf(_SC_PAGESIZE))};
+		const std::size_t first {offset / pageSize * pageSize};
+		const std::size_t last {length > m_size - offset ? m_size : offset + length};
+		madvise(data() + first, last - first, advice);
+	}
+
+	/**
+	 * Writes the dirty pages back and waits for them.
+	 * @return false on failure, with the reason in getError().
+	 */
+	bool sync() {
+		if (m_memory && msync(m_memory, m_size, MS_SYNC) != 0) {
+			setError("msync");
+			return false;
+		}
+		return true;
+	}
+
+private:
+	std::string m_path {};
+	std::string m_error {};
+	void* m_memory {nullptr};
+	std::size_t m_size {0};
+
+	void setError(const char* call) {
+		m_error = m_path + ": " + call + ": " + std::strerror(errno);
+	}
+
+	void map(int fd, int protection) {
+		if (m_size == 0) {
+			m_error = m_path + ": empty file";
+			close(fd);
+			return;
+		}
+		void* memory {mmap(nullptr, m_size, protection, MAP_SHARED, fd, 0)};
+		close(fd);
+		if (memory == MAP_FAILED) {
+			setError("mmap");
+			return;
+		}
+		m_memory = memory;
+	}
+
+	void unmap() {
+		if (m_memory) {
+			munmap(m_memory, m_size);
+			m_memory = nullptr;
+		}
+	}
+};
+
+#endif
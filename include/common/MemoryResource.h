@@ -0,0 +1,80 @@
+#ifndef MEMORY_RESOURCE_H
+#define MEMORY_RESOURCE_H
+
+#include <memory>
+#include <memory_resource>
+#include <optional>
+#include <string>
+
+#include "common/AmbientScope.h"
+#include "common/HugePageResource.h"
+
+/**
+ * The std::pmr memory resource simulations, layouts and sample sources allocate their buffers from.
+ *
+ * It is ambient per thread (common/AmbientScope.h): the harness gives every worker its own arena,
+ * so the buffers of a worker's simulations come from one unsynchronized pool (or bump allocator)
+ * and never touch the global heap's locks or another thread's cache lines.  Threads that set none
+ * use std::pmr::get_default_resource().
+ */
+class ThreadMemoryResource {
+public:
+	enum class Kind { NewDelete, Pool, Monotonic, HugePages, GiganticPages };
+
+	/**
+	 * @param name "new", "pool", "monotonic", "huge" (2 MB pages) or "huge1g".
+	 * @return The kind, or nullopt if the name is invalid.
+	 */
+	static std::optional<Kind> parseKind(const std::string& name) {
+		if (name == "new") {
+			return Kind::NewDelete;
+		} else if (name == "pool") {
+			return Kind::Pool;
+		} else if (name == "monotonic") {
+			return Kind::Monotonic;
+		} else if (name == "huge") {
+			return Kind::HugePages;
+		} else if (name == "huge1g") {
+			return Kind::GiganticPages;
+		}
+		return std::nullopt;
+	}
+
+	/**
+	 * @return A new arena of the given kind over the global heap, nullptr for NewDelete.
+	 *         A pool reuses freed blocks; a monotonic arena only releases its memory when destroyed;
+	 *         the huge page kinds map large buffers with huge pages (HugePageResource).
+	 * @param prefault For the huge page kinds, populate large buffers when they are allocated.
+	 */
+	static std::unique_ptr<std::pmr::memory_resource> make(Kind kind, bool prefault = false) {
+		switch (kind) {
+			case Kind::Pool:
+				return std::make_unique<std::pmr::unsynchronized_pool_resource>(std::pmr::new_delete_resource());
+			case Kind::Monotonic:
+				return std::make_unique<std::pmr::monotonic_buffer_resource>(std::pmr::new_delete_resource());
+			case Kind::HugePages:
+				return std::make_unique<HugePageResource>(HugePageResource::kPageSize2M, prefault);
+			case Kind::GiganticPages:
+				return std::make_unique<HugePageResource>(HugePageResource::kPageSize1G, prefault);
+			case Kind::NewDelete:
+				break;
+		}
+		return nullptr;
+	}
+
+	/**
+	 * @return The calling thread's resource.
+	 */
+	static std::pmr::memory_resource* get() {
+		std::pmr::memory_resource* resource {ThreadLocalSlot<std::pmr::memory_resource>::get()};
+		return resource ? resource : std::pmr::get_default_resource();
+	}
+
+	/**
+	 * Makes a resource the calling thread's until the end of the scope.  The resource must outlive
+	 * everything allocated from it, including objects that outlive the scope.
+	 */
+	using Scope = AmbientScope<std::pmr::memory_resource>;
+};
+
+#endif
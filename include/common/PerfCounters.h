@@ -0,0 +1,222 @@
+#ifndef PERF_COUNTERS_H
+#define PERF_COUNTERS_H
+
+#include <array>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <linux/perf_event.h>
+#include <string>
+#include <sys/ioctl.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <vector>
+
+/**
+ * Hardware performance counters of the calling thread, through perf_event_open.
+ *
+ * The events are opened as two groups, {cycles, instructions, branch misses, dTLB load misses} and
+ * {L1D read misses, LLC misses, FP ops}, so that each group fits the programmable counters even with SMT on; the
+ * kernel multiplexes the groups if needed and the counts are scaled by enabled / running time.
+ * Only user space is counted (exclude_kernel), which perf_event_paranoid <= 2 allows for the
+ * process's own threads.  Events the CPU or kernel does not support are left out; if none can be
+ * opened (paranoid 3 and up, seccomp, no PMU in the VM) the counters are simply unavailable.
+ */
+class PerfCounters {
+public:
+	enum Event { Cycles, Instructions, BranchMisses, DtlbMisses, L1dMisses, LlcMisses, FpOps, kEventCount };
+
+	static const char* getEventName(int event) {
+		static constexpr const char* names[kEventCount] {"cycles", "instructions", "branch misses", "dTLB misses", "L1D misses", "LLC misses", "FP ops"};
+		return names[event];
+	}
+
+	/**
+	 * Counts of one thread (or summed over threads); an event is valid if it was counted at all.
+	 */
+	struct Reading {
+		std::array<double, kEventCount> counts {};
+		std::array<bool, kEventCount> valid {};
+
+		void merge(const Reading& other) {
+			for (int e {0}; e < kEventCount; e++) {
+				counts[e] += other.counts[e];
+				valid[e] = valid[e] || other.valid[e];
+			}
+		}
+
+		bool isValid(int event) const {
+			return valid[event];
+		}
+	};
+
+	PerfCounters() = default;
+	PerfCounters(const PerfCounters&) = delete;
+	PerfCounters& operator=(const PerfCounters&) = delete;
+
+	~PerfCounters() {
+		for (auto& group : m_groups) {
+			for (int fd : group.fds) {
+				close(fd);
+			}
+		}
+	}
+
+	/**
+	 * Opens the counters for the calling thread, disabled.
+	 * @return True if at least one event could be opened; see getError() otherwise.
+	 */
+	bool open() {
+		openGroup({{Cycles, PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+			{Instructions, PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+			{BranchMisses, PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+			{DtlbMisses, PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16)}});
+		std::vector<EventConfig> memory {{L1dMisses, PERF_TYPE_HW_CACHE,
+				PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16)},
+			{LlcMisses, PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES}};
+		if (const std::uint64_t fpConfig {getFpOpsRawConfig()}; fpConfig != 0) {
+			memory.push_back({FpOps, PERF_TYPE_RAW, fpConfig});
+		}
+		openGroup(memory);
+		return !m_groups.empty();
+	}
+
+	const std::string& getError() const {
+		return m_error;
+	}
+
+	void start() {
+		for (const auto& group : m_groups) {
+			ioctl(group.fds.front(), PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+			ioctl(group.fds.front(), PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+		}
+	}
+
+	void stop() {
+		for (const auto& group : m_groups) {
+			ioctl(group.fds.front(), PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+		}
+	}
+
+	/**
+	 * @return The counts since start(), scaled up for the time the groups were multiplexed out.
+	 */
+	Reading read() const {
+		Reading reading {};
+		for (const auto& group : m_groups) {
+			// PERF_FORMAT_GROUP layout: nr, time_enabled, time_running, value[nr]
+			std::vector<std::uint64_t> buffer(3 + group.events.size());
+			const auto size = static_cast<ssize_t>(buffer.size() * sizeof(std::uint64_t));
+			if (::read(group.fds.front(), buffer.data(), size) != size || buffer[2] == 0) {
+				continue;
+			}
+			const double scale {static_cast<double>(buffer[1]) / static_cast<double>(buffer[2])};
+			for (std::size_t i {0}; i < group.events.size(); i++) {
+				reading.counts[group.events[i]] = static_cast<double>(buffer[3 + i]) * scale;
+				reading.valid[group.events[i]] = true;
+			}
+		}
+		return reading;
+	}
+
+	/**
+	 * Page faults of the calling thread so far, which need no PMU.
+	 */
+	struct PageFaults {
+		std::int64_t minor {0};
+		std::int64_t major {0};
+
+		PageFaults operator-(const PageFaults& other) const {
+			return {minor - other.minor, major - other.major};
+		}
+
+		PageFaults& operator+=(const PageFaults& other) {
+			minor += other.minor;
+			major += other.major;
+			return *this;
+		}
+	};
+
+	static PageFaults getThreadPageFaults() {
+		rusage usage {};
+		getrusage(RUSAGE_THREAD, &usage);
+		return {usage.ru_minflt, usage.ru_majflt};
+	}
+
+	/**
+	 * @return /proc/sys/kernel/perf_event_paranoid, or -1 if it cannot be read.
+	 */
+	static int getParanoidLevel() {
+		std::ifstream file("/proc/sys/kernel/perf_event_paranoid");
+		int level {-1};
+		file >> level;
+		return file ? level : -1;
+	}
+
+private:
+	struct EventConfig {
+		int event;
+		std::uint32_t type;
+		std::uint64_t config;
+	};
+
+	struct Group {
+		std::vector<int> fds {};
+		std::vector<int> events {};
+	};
+
+	std::vector<Group> m_groups {};
+	std::string m_error {};
+
+	void openGroup(const std::vector<EventConfig>& configs) {
+		Group group {};
+		for (const auto& config : configs) {
+			perf_event_attr attr {};
+			attr.size = sizeof(attr);
+			attr.type = config.type;
+			attr.config = config.config;
+			attr.disabled = group.fds.empty() ? 1 : 0; // members follow the leader
+			attr.exclude_kernel = 1;
+			attr.exclude_hv = 1;
+			attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+			const int leader {group.fds.empty() ? -1 : group.fds.front()};
+			const int fd {static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, leader, 0))};
+			if (fd < 0) {
+				if (m_error.empty()) {
+					m_error = std::string {getEventName(config.event)} + ": " + std::strerror(errno);
+				}
+				continue;
+			}
+			group.fds.push_back(fd);
+			group.events.push_back(config.event);
+		}
+		if (!group.fds.empty()) {
+			m_groups.push_back(std::move(group));
+		}
+	}
+
+	/**
+	 * @return The raw event for retired FP arithmetic on this CPU, 0 if unknown:
+	 *         FP_ARITH_INST_RETIRED, all umasks (instructions) on Intel, retired SSE/AVX FLOPs on AMD.
+	 */
+	static std::uint64_t getFpOpsRawConfig() {
+		std::ifstream cpuinfo("/proc/cpuinfo");
+		std::string line;
+		while (std::getline(cpuinfo, line)) {
+			if (line.rfind("vendor_id", 0) == 0) {
+				if (line.find("GenuineIntel") != std::string::npos) {
+					return 0xffc7;
+				}
+				if (line.find("AuthenticAMD") != std::string::npos) {
+					return 0xff03;
+				}
+				return 0;
+			}
+		}
+		return 0;
+	}
+};
+
+#endif
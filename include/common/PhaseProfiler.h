@@ -0,0 +1,229 @@
+#ifndef PHASE_PROFILER_H
+#define PHASE_PROFILER_H
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+/**
+ * Scoped per-phase profiler for the hot paths, compiled out unless PHASE_PROFILING is defined
+ * (bazel --config=phases).  PROFILE_PHASE("name") times the rest of the enclosing block.
+ *
+ * Every thread accumulates into its own cache-line padded counters, so scopes never contend; the
+ * clock is the TSC where there is one (calibrated against steady_clock at report time), otherwise
+ * steady_clock.  Phases nest: a phase's self time excludes the phases opened inside it, e.g. the
+ * "rng" of a sample source inside the "kernel" loop that pulls from it.
+ */
+class PhaseProfiler {
+public:
+	static constexpr int kMaxPhases {32};
+
+private:
+	struct alignas(64) PhaseCounters {
+		std::uint64_t ticks {0};
+		std::uint64_t childTicks {0};
+		std::uint64_t calls {0};
+	};
+
+	struct ThreadCounters {
+		std::array<PhaseCounters, kMaxPhases> phases {};
+		int current {-1};
+	};
+
+public:
+#ifdef PHASE_PROFILING
+	static constexpr bool kEnabled {true};
+#else
+	static constexpr bool kEnabled {false};
+#endif
+
+	/**
+	 * @return The id of the named phase, registering it on first use.  Names must be string literals.
+	 */
+	static int registerPhase(const char* name) {
+		auto& registry = getRegistry();
+		std::lock_guard lock {registry.mutex};
+		for (int id {0}; id < static_cast<int>(registry.names.size()); id++) {
+			if (std::string_view {registry.names[id]} == name) {
+				return id;
+			}
+		}
+		if (static_cast<int>(registry.names.size()) == kMaxPhases) {
+			return kMaxPhases - 1;
+		}
+		registry.names.push_back(name);
+		return static_cast<int>(registry.names.size()) - 1;
+	}
+
+	/**
+	 * Times a phase from construction to destruction.
+	 */
+	class Scope {
+	public:
+		explicit Scope(int id) :
+			m_thread {getThreadCounters()},
+			m_id {id},
+			m_parent {m_thread.current},
+			m_start {now()}
+		{
+			m_thread.current = id;
+		}
+
+		~Scope() {
+			const std::uint64_t elapsed {now() - m_start};
+			m_thread.phases[m_id].ticks += elapsed;
+			m_thread.phases[m_id].calls++;
+			if (m_parent >= 0) {
+				m_thread.phases[m_parent].childTicks += elapsed;
+			}
+			m_thread.current = m_parent;
+		}
+
+		Scope(const Scope&) = delete;
+		Scope& operator=(const Scope&) = delete;
+
+	private:
+		ThreadCounters& m_thread;
+		int m_id;
+		int m_parent;
+		std::uint64_t m_start;
+	};
+
+	/**
+	 * Clears all counters; only call while no phase is running.
+	 */
+	static void reset() {
+		auto& registry = getRegistry();
+		std::lock_guard lock {registry.mutex};
+		for (auto& thread : registry.threads) {
+			for (auto& phase : thread->phases) {
+				phase = {};
+			}
+		}
+		registry.startTicks = now();
+		registry.startTime = std::chrono::steady_clock::now();
+	}
+
+	/**
+	 * Prints the self time of every phase over all threads, then per thread.
+	 */
+	static void printReport(std::ostream& out) {
+		if constexpr (!kEnabled) {
+			return;
+		}
+		auto& registry = getRegistry();
+		std::lock_guard lock {registry.mutex};
+		const double secondsPerTick {getSecondsPerTick(registry)};
+		const int phaseCount {static_cast<int>(registry.names.size())};
+
+		auto printPhases = [&](const std::vector<const ThreadCounters*>& threads) {
+			std::vector<double> selfSeconds(phaseCount);
+			std::vector<std::uint64_t> calls(phaseCount);
+			double totalSeconds {0};
+			for (const auto* thread : threads) {
+				for (int id {0}; id < phaseCount; id++) {
+					const auto& phase = thread->phases[id];
+					selfSeconds[id] += static_cast<double>(phase.ticks - phase.childTicks) * secondsPerTick;
+					calls[id] += phase.calls;
+				}
+			}
+			for (double seconds : selfSeconds) {
+				totalSeconds += seconds;
+			}
+			for (int id {0}; id < phaseCount; id++) {
+				if (calls[id] == 0) {
+					continue;
+				}
+				out << "  " << std::left << std::setw(12) << registry.names[id] << std::right
+					<< std::setw(12) << selfSeconds[id] << " s" << std::setw(8) << std::fixed << std::setprecision(1)
+					<< (totalSeconds > 0 ? 100 * selfSeconds[id] / totalSeconds : 0) << " %" << std::defaultfloat << std::setprecision(6)
+					<< std::setw(14) << calls[id] << " calls" << std::setw(12) << selfSeconds[id] * 1e9 / calls[id] << " ns/call" << std::endl;
+			}
+		};
+
+		std::vector<const ThreadCounters*> all {};
+		for (const auto& thread : registry.threads) {
+			all.push_back(thread.get());
+		}
+		out << "Phase breakdown (self time, " << all.size() << " threads):" << std::endl;
+		printPhases(all);
+		for (int t {0}; t < static_cast<int>(all.size()); t++) {
+			bool active {false};
+			for (int id {0}; id < phaseCount; id++) {
+				active |= all[t]->phases[id].calls > 0;
+			}
+			if (active) {
+				out << "Thread " << t << ":" << std::endl;
+				printPhases({all[t]});
+			}
+		}
+	}
+
+private:
+	struct Registry {
+		std::mutex mutex {};
+		std::vector<const char*> names {};
+		// owned here so the counters of finished threads are still there for the report
+		std::vector<std::unique_ptr<ThreadCounters>> threads {};
+		std::uint64_t startTicks {now()};
+		std::chrono::steady_clock::time_point startTime {std::chrono::steady_clock::now()};
+	};
+
+	static Registry& getRegistry() {
+		static Registry registry {};
+		return registry;
+	}
+
+	static ThreadCounters& getThreadCounters() {
+		thread_local ThreadCounters* counters {nullptr};
+		if (!counters) {
+			auto& registry = getRegistry();
+			std::lock_guard lock {registry.mutex};
+			registry.threads.push_back(std::make_unique<ThreadCounters>());
+			counters = registry.threads.back().get();
+		}
+		return *counters;
+	}
+
+	static std::uint64_t now() {
+#if defined(__x86_64__) || defined(__i386__)
+		return __rdtsc();
+#else
+		return static_cast<std::uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count());
+#endif
+	}
+
+	static double getSecondsPerTick(const Registry& registry) {
+#if defined(__x86_64__) || defined(__i386__)
+		const std::uint64_t ticks {now() - registry.startTicks};
+		const std::chrono::duration<double> elapsed {std::chrono::steady_clock::now() - registry.startTime};
+		return ticks > 0 ? elapsed.count() / static_cast<double>(ticks) : 0.0;
+#else
+		(void)registry;
+		return std::chrono::duration<double>(std::chrono::steady_clock::duration {1}).count();
+#endif
+	}
+};
+
+#define PHASE_PROFILER_CONCAT_INNER(a, b) a##b
+#define PHASE_PROFILER_CONCAT(a, b) PHASE_PROFILER_CONCAT_INNER(a, b)
+
+#ifdef PHASE_PROFILING
+#define PROFILE_PHASE(name) \
+	static const int PHASE_PROFILER_CONCAT(phaseId_, __LINE__) {PhaseProfiler::registerPhase(name)}; \
+	const PhaseProfiler::Scope PHASE_PROFILER_CONCAT(phaseScope_, __LINE__) {PHASE_PROFILER_CONCAT(phaseId_, __LINE__)}
+#else
+#define PROFILE_PHASE(name) static_cast<void>(0)
+#endif
+
+#endif
@@ -0,0 +1,129 @@
+#ifndef SPSC_RING_H
+#define SPSC_RING_H
+
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <new>
+#include <thread>
+
+/**
+ * Lock-free single-producer single-consumer ring of fixed-size, cache-line aligned blocks.
+ * The producer fills a block in place and commits it, the consumer reads it in place and releases
+ * it; no element is ever copied through the ring.  Each side keeps a private copy of the other
+ * side's index and only reloads the shared atomic when the ring looks full (or empty), so in the
+ * steady state the two cores exchange one cache line per block.
+ */
+template <typename T>
+class SpscRing {
+public:
+	static constexpr std::size_t kCacheLineSize {64};
+
+	/**
+	 * @param blockCount Number of blocks in the ring, must be a power of two.
+	 * @param blockSize Number of elements per block, rounded up to whole cache lines.
+	 */
+	SpscRing(std::size_t blockCount, std::size_t blockSize) :
+		m_blockCount {blockCount},
+		m_blockSize {(blockSize * sizeof(T) + kCacheLineSize - 1) / kCacheLineSize * kCacheLineSize / sizeof(T)},
+		m_storage {static_cast<T*>(::operator new[](m_blockCount * m_blockSize * sizeof(T), std::align_val_t {kCacheLineSize}))}
+	{
+		assert(blockCount > 0 && (blockCount & (blockCount - 1)) == 0 && "Block count must be a power of two.");
+	}
+
+	SpscRing(const SpscRing&) = delete;
+	SpscRing& operator=(const SpscRing&) = delete;
+
+	~SpscRing() {
+		::operator delete[](m_storage, std::align_val_t {kCacheLineSize});
+	}
+
+	std::size_t getBlockSize() const {
+		return m_blockSize;
+	}
+
+	/**
+	 * Producer side: the next block to fill.
+	 * @return The block, or nullptr if the ring is full.
+	 */
+	T* tryAcquireWrite() {
+		const std::size_t write {m_writeIndex.load(std::memory_order_relaxed)};
+		if (write - m_producerCachedRead == m_blockCount) {
+			m_producerCachedRead = m_readIndex.load(std::memory_order_acquire);
+			if (write - m_producerCachedRead == m_blockCount) {
+				return nullptr;
+			}
+		}
+		return block(write);
+	}
+
+	/**
+	 * Producer side: publishes the block returned by tryAcquireWrite().
+	 */
+	void commitWrite() {
+		m_writeIndex.store(m_writeIndex.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+	}
+
+	/**
+	 * Consumer side: the oldest filled block.
+	 * @return The block, or nullptr if the ring is empty.
+	 */
+	const T* tryAcquireRead() {
+		const std::size_t read {m_readIndex.load(std::memory_order_relaxed)};
+		if (read == m_consumerCachedWrite) {
+			m_consumerCachedWrite = m_writeIndex.load(std::memory_order_acquire);
+			if (read == m_consumerCachedWrite) {
+				return nullptr;
+			}
+		}
+		return block(read);
+	}
+
+	/**
+	 * Consumer side: hands the block returned by tryAcquireRead() back to the producer.
+	 */
+	void releaseRead() {
+		m_readIndex.store(m_readIndex.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+	}
+
+	/**
+	 * Tells the producer to stop; it checks isClosed() whenever the ring is full.
+	 */
+	void close() {
+		m_closed.store(true, std::memory_order_release);
+	}
+
+	bool isClosed() const {
+		return m_closed.load(std::memory_order_acquire);
+	}
+
+	/**
+	 * Backs off while spinning on a full or empty ring, without giving up the core.
+	 */
+	static void relax() {
+#if defined(__x86_64__) || defined(__i386__)
+		__builtin_ia32_pause();
+#else
+		std::this_thread::yield();
+#endif
+	}
+
+private:
+	const std::size_t m_blockCount;
+	const std::size_t m_blockSize;
+	T* const m_storage;
+
+	// producer-owned line
+	alignas(kCacheLineSize) std::atomic<std::size_t> m_writeIndex {0};
+	std::size_t m_producerCachedRead {0};
+	// consumer-owned line
+	alignas(kCacheLineSize) std::atomic<std::size_t> m_readIndex {0};
+	std::size_t m_consumerCachedWrite {0};
+	alignas(kCacheLineSize) std::atomic<bool> m_closed {false};
+
+	T* block(std::size_t index) const {
+		return m_storage + (index & (m_blockCount - 1)) * m_blockSize;
+	}
+};
+
+#endif
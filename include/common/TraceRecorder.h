@@ -0,0 +1,190 @@
+#ifndef TRACE_RECORDER_H
+#define TRACE_RECORDER_H
+
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+/**
+ * Timeline recorder that writes Chrome trace-event JSON, to be opened in Perfetto (ui.perfetto.dev)
+ * or chrome://tracing.  Recording is off until enable() is called, and then costs one clock read and
+ * one store per event.
+ *
+ * Every thread appends to its own preallocated buffer, so recording never takes a lock or allocates
+ * after the thread's first event; a full buffer drops further events and counts them.  The buffers
+ * are owned by a static registry and read by writeJson() once the recording threads are joined.
+ */
+class TraceRecorder {
+public:
+	static constexpr std::size_t kEventsPerThread {1 << 16};
+
+	/**
+	 * Turns recording on; call before starting the threads to trace.
+	 */
+	static void enable() {
+		getRegistry();
+		s_enabled = true;
+	}
+
+	static bool isEnabled() {
+		return s_enabled;
+	}
+
+	/**
+	 * Names the calling thread in the trace, e.g. "worker 3".
+	 */
+	static void setThreadName(std::string name) {
+		if (s_enabled) {
+			getThreadBuffer().name = std::move(name);
+		}
+	}
+
+	/**
+	 * Records a point in time on the calling thread, with an optional integer argument.
+	 * @param name String literal, as are argName.
+	 */
+	static void instant(const char* name, const char* argName = nullptr, std::int64_t arg = 0) {
+		if (s_enabled) {
+			record({name, argName, arg, now(), -1});
+		}
+	}
+
+	/**
+	 * Records a span from construction to destruction on the calling thread.
+	 */
+	class Scope {
+	public:
+		explicit Scope(const char* name, const char* argName = nullptr, std::int64_t arg = 0) :
+			m_name {name},
+			m_argName {argName},
+			m_arg {arg},
+			m_start {s_enabled ? now() : 0}
+		{}
+
+		~Scope() {
+			if (s_enabled) {
+				record({m_name, m_argName, m_arg, m_start, now() - m_start});
+			}
+		}
+
+		Scope(const Scope&) = delete;
+		Scope& operator=(const Scope&) = delete;
+
+	private:
+		const char* m_name;
+		const char* m_argName;
+		std::int64_t m_arg;
+		std::int64_t m_start;
+	};
+
+	/**
+	 * Writes every thread's events; only call while no traced thread is running.
+	 * @return False if the file could not be written.
+	 */
+	static bool writeJson(const std::string& path) {
+		auto& registry = getRegistry();
+		std::lock_guard lock {registry.mutex};
+		std::ofstream out(path);
+		if (!out) {
+			return false;
+		}
+		const long pid {static_cast<long>(getpid())};
+		std::uint64_t dropped {0};
+		bool first {true};
+		auto separator = [&]() -> const char* {
+			const char* text {first ? "\n" : ",\n"};
+			first = false;
+			return text;
+		};
+		out << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+		for (std::size_t tid {0}; tid < registry.threads.size(); tid++) {
+			const auto& thread = *registry.threads[tid];
+			dropped += thread.dropped;
+			out << separator() << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":" << pid << ",\"tid\":" << tid
+				<< ",\"args\":{\"name\":\"" << (thread.name.empty() ? "thread " + std::to_string(tid) : thread.name) << "\"}}";
+			out << separator() << "{\"name\":\"thread_sort_index\",\"ph\":\"M\",\"pid\":" << pid << ",\"tid\":" << tid
+				<< ",\"args\":{\"sort_index\":" << tid << "}}";
+			for (std::size_t e {0}; e < thread.count; e++) {
+				const auto& event = thread.events[e];
+				// timestamps and durations are in microseconds
+				out << separator() << "{\"name\":\"" << event.name << "\",\"ph\":\"" << (event.duration < 0 ? "i\",\"s\":\"t" : "X")
+					<< "\",\"pid\":" << pid << ",\"tid\":" << tid << ",\"ts\":" << event.start / 1000 << '.' << formatFraction(event.start);
+				if (event.duration >= 0) {
+					out << ",\"dur\":" << event.duration / 1000 << '.' << formatFraction(event.duration);
+				}
+				if (event.argName) {
+					out << ",\"args\":{\"" << event.argName << "\":" << event.arg << "}";
+				}
+				out << "}";
+			}
+		}
+		out << "\n],\"otherData\":{\"droppedEvents\":" << dropped << "}}\n";
+		return static_cast<bool>(out);
+	}
+
+private:
+	struct Event {
+		const char* name;
+		const char* argName;
+		std::int64_t arg;
+		std::int64_t start;    // ns since the registry was created
+		std::int64_t duration; // ns, -1 for an instant
+	};
+
+	struct ThreadBuffer {
+		std::vector<Event> events = std::vector<Event>(kEventsPerThread);
+		std::size_t count {0};
+		std::uint64_t dropped {0};
+		std::string name {};
+	};
+
+	struct Registry {
+		std::mutex mutex {};
+		// owned here so the events of finished threads are still there for writeJson()
+		std::vector<std::unique_ptr<ThreadBuffer>> threads {};
+		std::chrono::steady_clock::time_point startTime {std::chrono::steady_clock::now()};
+	};
+
+	static inline bool s_enabled {false};
+
+	static Registry& getRegistry() {
+		static Registry registry {};
+		return registry;
+	}
+
+	static ThreadBuffer& getThreadBuffer() {
+		thread_local ThreadBuffer* buffer {nullptr};
+		if (!buffer) {
+			auto& registry = getRegistry();
+			std::lock_guard lock {registry.mutex};
+			registry.threads.push_back(std::make_unique<ThreadBuffer>());
+			buffer = registry.threads.back().get();
+		}
+		return *buffer;
+	}
+
+	static void record(const Event& event) {
+		auto& buffer = getThreadBuffer();
+		if (buffer.count == buffer.events.size()) {
+			buffer.dropped++;
+			return;
+		}
+		buffer.events[buffer.count++] = event;
+	}
+
+	static std::int64_t now() {
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - getRegistry().startTime).count();
+	}
+
+	static std::string formatFraction(std::int64_t nanoseconds) {
+		std::string digits {std::to_string(nanoseconds % 1000)};
+		return std::string(3 - digits.size(), '0') + digits;
+	}
+};
+
+#endif
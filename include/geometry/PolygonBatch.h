@@ -0,0 +1,301 @@
+#ifndef GEOMETRY_POLYGONBATCH_H
+#define GEOMETRY_POLYGONBATCH_H
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cmath>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <thread>
+#include <vector>
+
+#include "hwy/highway.h"
+
+namespace geometry {
+
+/**
+ * Caller-owned polygons in structure-of-arrays form: all x coordinates in one column, all y in
+ * another, polygon after polygon.  Polygon i is either vertices [offsets[i], offsets[i + 1]), for
+ * variable vertex counts, or, with empty offsets, vertices [i * vertexCount, (i + 1) * vertexCount).
+ * Nothing is copied; the columns must outlive the calls that read them.
+ */
+template <std::floating_point FloatType>
+struct PolygonColumns {
+	std::span<const FloatType> xs {};
+	std::span<const FloatType> ys {};
+	std::span<const std::int64_t> offsets {}; // polygon count + 1 entries, or empty
+	int vertexCount {0};                      // with empty offsets
+
+	std::size_t size() const {
+		if (!offsets.empty()) {
+			return offsets.size() - 1;
+		}
+		return vertexCount > 0 ? xs.size() / vertexCount : 0;
+	}
+
+	std::int64_t getFirstVertex(std::size_t polygon) const {
+		return offsets.empty() ? static_cast<std::int64_t>(polygon) * vertexCount : offsets[polygon];
+	}
+
+	int getVertexCount(std::size_t polygon) const {
+		return offsets.empty() ? vertexCount : static_cast<int>(offsets[polygon + 1] - offsets[polygon]);
+	}
+
+	/**
+	 * @return Polygons [first, last), still in place.  With offsets the columns stay whole, since the
+	 *         offsets index them.
+	 */
+	PolygonColumns slice(std::size_t first, std::size_t last) const {
+		if (!offsets.empty()) {
+			return {xs, ys, offsets.subspan(first, last - first + 1), 0};
+		}
+		const std::size_t firstVertex {first * static_cast<std::size_t>(vertexCount)};
+		const std::size_t vertices {(last - first) * static_cast<std::size_t>(vertexCount)};
+		return {xs.subspan(firstVertex, vertices), ys.subspan(firstVertex, vertices), {}, vertexCount};
+	}
+};
+
+/**
+ * Caller-owned per-polygon results, one entry per polygon.  Empty spans are not computed.
+ */
+template <std::floating_point FloatType>
+struct PolygonResults {
+	std::span<FloatType> areas {};
+	std::span<FloatType> ratios {}; // area / bounding box area
+	std::span<FloatType> minXs {};
+	std::span<FloatType> minYs {};
+	std::span<FloatType> maxXs {};
+	std::span<FloatType> maxYs {};
+};
+
+/**
+ * Area, axis-aligned bounding box and their ratio of one polygon.
+ */
+template <std::floating_point FloatType>
+struct PolygonMetrics {
+	FloatType area;
+	FloatType minX;
+	FloatType minY;
+	FloatType maxX;
+	FloatType maxY;
+	FloatType ratio;
+};
+
+/**
+ * Measures one polygon of vertexCount >= 3 vertices (shoelace area).  The ratio is not finite for a
+ * polygon whose bounding box has no area.
+ */
+template <std::floating_point FloatType>
+PolygonMetrics<FloatType> measurePolygon(const FloatType* xs, const FloatType* ys, int vertexCount) {
+	assert(vertexCount >= 3 && "Polygons must have at least 3 points.");
+	PolygonMetrics<FloatType> metrics {0, xs[0], ys[0], xs[0], ys[0], 0};
+	FloatType doubleArea {0};
+	for (int p {0}; p < vertexCount; p++) {
+		const int next {p + 1 == vertexCount ? 0 : p + 1};
+		doubleArea += xs[p] * ys[next] - xs[next] * ys[p];
+		metrics.minX = std::min(metrics.minX, xs[p]);
+		metrics.minY = std::min(metrics.minY, ys[p]);
+		metrics.maxX = std::max(metrics.maxX, xs[p]);
+		metrics.maxY = std::max(metrics.maxY, ys[p]);
+	}
+	metrics.area = std::abs(doubleArea) / static_cast<FloatType>(2.0);
+	metrics.ratio = metrics.area / ((metrics.maxX - metrics.minX) * (metrics.maxY - metrics.minY));
+	return metrics;
+}
+
+namespace detail {
+
+constexpr std::size_t kMaxLanes {64};
+
+// below this many polygons per thread, starting a thread costs more than it saves
+constexpr std::size_t kMinPolygonsPerThread {std::size_t {1} << 14};
+
+template <std::floating_point FloatType>
+void store(const PolygonResults<FloatType>& results, std::size_t polygon, const PolygonMetrics<FloatType>& metrics) {
+	if (!results.areas.empty()) {
+		results.areas[polygon] = metrics.area;
+	}
+	if (!results.ratios.empty()) {
+		results.ratios[polygon] = metrics.ratio;
+	}
+	if (!results.minXs.empty()) {
+		results.minXs[polygon] = metrics.minX;
+	}
+	if (!results.minYs.empty()) {
+		results.minYs[polygon] = metrics.minY;
+	}
+	if (!results.maxXs.empty()) {
+		results.maxXs[polygon] = metrics.maxX;
+	}
+	if (!results.maxYs.empty()) {
+		results.maxYs[polygon] = metrics.maxY;
+	}
+}
+
+/**
+ * Polygons [first, last): one polygon per SIMD lane wherever `lanes` consecutive polygons have the
+ * same vertex count (their vertices are gathered), one by one otherwise.
+ * @return The sum of the ratios.
+ */
+template <bool StoreResults, std::floating_point FloatType>
+FloatType processRange(const PolygonColumns<FloatType>& polygons, const PolygonResults<FloatType>& results, std::size_t first, std::size_t last) {
+	namespace hn = hwy::HWY_NAMESPACE;
+	using D = hn::ScalableTag<FloatType>;
+	using DI = hn::RebindToSigned<D>;
+	using IndexType = hn::TFromD<DI>;
+	const D d;
+	const DI di;
+	const std::size_t lanes {hn::Lanes(d)};
+	assert(lanes <= kMaxLanes && "More SIMD lanes than the index buffer holds.");
+
+	auto ratioSum = hn::Zero(d);
+	FloatType scalarRatioSum {0};
+	std::array<IndexType, kMaxLanes> laneOffsets {};
+	std::array<FloatType, kMaxLanes> laneValues {};
+	auto storeLanes = [&](std::span<FloatType> column, std::size_t polygon, auto vector) {
+		if (!column.empty()) {
+			hn::StoreU(vector, d, laneValues.data());
+			std::copy_n(laneValues.begin(), lanes, column.begin() + polygon);
+		}
+	};
+
+	std::size_t polygon {first};
+	while (polygon < last) {
+		const int vertexCount {polygons.getVertexCount(polygon)};
+		bool uniformBlock {polygon + lanes <= last};
+		for (std::size_t j {1}; uniformBlock && j < lanes; j++) {
+			uniformBlock = polygons.getVertexCount(polygon + j) == vertexCount;
+		}
+		if (!uniformBlock) {
+			const std::int64_t vertex {polygons.getFirstVertex(polygon)};
+			const auto metrics = measurePolygon(polygons.xs.data() + vertex, polygons.ys.data() + vertex, vertexCount);
+			if constexpr (StoreResults) {
+				store(results, polygon, metrics);
+			}
+			scalarRatioSum += metrics.ratio;
+			polygon++;
+			continue;
+		}
+
+		// indices relative to the block's first polygon, which keeps them small for 32 bit lanes
+		const std::int64_t base {polygons.getFirstVertex(polygon)};
+		for (std::size_t j {0}; j < lanes; j++) {
+			laneOffsets[j] = static_cast<IndexType>(polygons.getFirstVertex(polygon + j) - base);
+		}
+		const auto indices = hn::LoadU(di, laneOffsets.data());
+		const FloatType* xs {polygons.xs.data() + base};
+		const FloatType* ys {polygons.ys.data() + base};
+
+		const auto firstX = hn::GatherIndex(d, xs, indices);
+		const auto firstY = hn::GatherIndex(d, ys, indices);
+		auto previousX = firstX;
+		auto previousY = firstY;
+		auto minX = firstX;
+		auto minY = firstY;
+		auto maxX = firstX;
+		auto maxY = firstY;
+		auto doubleArea = hn::Zero(d);
+		for (int p {1}; p < vertexCount; p++) {
+			const auto vertexIndices = hn::Add(indices, hn::Set(di, static_cast<IndexType>(p)));
+			const auto x = hn::GatherIndex(d, xs, vertexIndices);
+			const auto y = hn::GatherIndex(d, ys, vertexIndices);
+			doubleArea = hn::Add(doubleArea, hn::MulSub(previousX, y, hn::Mul(x, previousY)));
+			minX = hn::Min(minX, x);
+			minY = hn::Min(minY, y);
+			maxX = hn::Max(maxX, x);
+			maxY = hn::Max(maxY, y);
+			previousX = x;
+			previousY = y;
+		}
+		doubleArea = hn::Add(doubleArea, hn::MulSub(previousX, firstY, hn::Mul(firstX, previousY)));
+		const auto area = hn::Mul(hn::Abs(doubleArea), hn::Set(d, static_cast<FloatType>(0.5)));
+		const auto ratio = hn::Div(area, hn::Mul(hn::Sub(maxX, minX), hn::Sub(maxY, minY)));
+		ratioSum = hn::Add(ratioSum, ratio);
+		if constexpr (StoreResults) {
+			storeLanes(results.areas, polygon, area);
+			storeLanes(results.ratios, polygon, ratio);
+			storeLanes(results.minXs, polygon, minX);
+			storeLanes(results.minYs, polygon, minY);
+			storeLanes(results.maxXs, polygon, maxX);
+			storeLanes(results.maxYs, polygon, maxY);
+		}
+		polygon += lanes;
+	}
+	return hn::GetLane(hn::SumOfLanes(d, ratioSum)) + scalarRatioSum;
+}
+
+/**
+ * Splits the polygons into contiguous ranges, one per thread, the calling thread taking the first.
+ * @return The sum of the ratios, added up in range order.
+ */
+template <bool StoreResults, std::floating_point FloatType>
+FloatType processParallel(const PolygonColumns<FloatType>& polygons, const PolygonResults<FloatType>& results, int threadCount) {
+	const std::size_t count {polygons.size()};
+	const std::size_t useful {std::max<std::size_t>(1, count / kMinPolygonsPerThread)};
+	const std::size_t ranges {std::min<std::size_t>(static_cast<std::size_t>(std::max(1, threadCount)), useful)};
+	// ranges of whole SIMD blocks, so only the last one has a scalar tail
+	const std::size_t lanes {hwy::HWY_NAMESPACE::Lanes(hwy::HWY_NAMESPACE::ScalableTag<FloatType> {})};
+	const std::size_t perRange {(count / ranges + lanes - 1) / lanes * lanes};
+
+	std::vector<FloatType> sums(ranges);
+	std::vector<std::thread> threads {};
+	for (std::size_t r {1}; r < ranges; r++) {
+		const std::size_t first {std::min(count, r * perRange)};
+		const std::size_t last {r + 1 == ranges ? count : std::min(count, first + perRange)};
+		threads.emplace_back([&, r, first, last]() {
+			sums[r] = processRange<StoreResults>(polygons, results, first, last);
+		});
+	}
+	sums[0] = processRange<StoreResults>(polygons, results, 0, ranges == 1 ? count : std::min(count, perRange));
+	for (auto& thread : threads) {
+		thread.join();
+	}
+	FloatType sum {0};
+	for (FloatType rangeSum : sums) {
+		sum += rangeSum;
+	}
+	return sum;
+}
+
+template <std::floating_point FloatType>
+void checkColumns(const PolygonColumns<FloatType>& polygons) {
+	assert(polygons.xs.size() == polygons.ys.size() && "x and y columns must have the same length.");
+	assert((!polygons.offsets.empty() || polygons.vertexCount >= 3) && "Need offsets or a vertex count of at least 3.");
+	assert((polygons.offsets.empty() || polygons.offsets.back() <= static_cast<std::int64_t>(polygons.xs.size())) && "Offsets past the columns.");
+	(void)polygons;
+}
+
+} // namespace detail
+
+/**
+ * Computes the area, bounding box and area ratio of every polygon into the non-empty result spans.
+ * @param threadCount Threads to use, the calling thread included; batches too small to be worth it use fewer.
+ * @return The sum of the ratios.
+ */
+template <std::floating_point FloatType>
+FloatType computePolygons(const PolygonColumns<FloatType>& polygons, const PolygonResults<FloatType>& results, int threadCount = 1) {
+	detail::checkColumns(polygons);
+	for (auto column : {results.areas, results.ratios, results.minXs, results.minYs, results.maxXs, results.maxYs}) {
+		assert((column.empty() || column.size() >= polygons.size()) && "Result spans need one entry per polygon.");
+		(void)column;
+	}
+	return detail::processParallel<true>(polygons, results, threadCount);
+}
+
+/**
+ * Sums the area ratios of all polygons without writing anything per polygon.
+ * @param threadCount Threads to use, the calling thread included.
+ * @return The sum of the ratios; divide by polygons.size() for the average.
+ */
+template <std::floating_point FloatType>
+FloatType sumRatios(const PolygonColumns<FloatType>& polygons, int threadCount = 1) {
+	detail::checkColumns(polygons);
+	return detail::processParallel<false>(polygons, {}, threadCount);
+}
+
+} // namespace geometry
+
+#endif // GEOMETRY_POLYGONBATCH_H
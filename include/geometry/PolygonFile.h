@@ -0,0 +1,250 @@
+#ifndef GEOMETRY_POLYGONFILE_H
+#define GEOMETRY_POLYGONFILE_H
+
+#include <cassert>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <string>
+#include <sys/mman.h>
+
+#include "common/MappedFile.h"
+#include "geometry/PolygonBatch.h"
+
+namespace geometry {
+
+/**
+ * Header of a columnar polygon file, in native byte order.  The file is the header followed by
+ * up to three page-aligned sections: the offsets column (polygonCount + 1 int64, only when the
+ * vertex count varies), then the x column and the y column (totalVertexCount floats each), so that
+ * the columns can be used in place as PolygonColumns.
+ */
+struct PolygonFileHeader {
+	static constexpr char kMagic[8] {'P', 'O', 'L', 'Y', 'C', 'O', 'L', '\0'};
+	static constexpr std::uint32_t kVersion {1};
+	static constexpr std::uint64_t kAlignment {4096};
+
+	char magic[8] {};
+	std::uint32_t version {kVersion};
+	std::uint32_t floatBytes {0};      // 4 or 8
+	std::uint64_t polygonCount {0};
+	std::uint64_t totalVertexCount {0};
+	std::uint32_t vertexCount {0};     // of every polygon, 0 if the file has an offsets column
+	std::uint32_t reserved {0};
+	std::uint64_t offsetsStart {0};    // byte offsets of the sections
+	std::uint64_t xsStart {0};
+	std::uint64_t ysStart {0};
+
+	/**
+	 * @param vertexCount Vertices of every polygon, or 0 for an offsets column.
+	 * @return The header of a file with the given contents, the sections laid out.
+	 */
+	static PolygonFileHeader make(std::uint64_t polygonCount, std::uint64_t totalVertexCount, std::uint32_t vertexCount, std::uint32_t floatBytes) {
+		PolygonFileHeader header {};
+		std::memcpy(header.magic, kMagic, sizeof(kMagic));
+		header.floatBytes = floatBytes;
+		header.polygonCount = polygonCount;
+		header.totalVertexCount = totalVertexCount;
+		header.vertexCount = vertexCount;
+		header.offsetsStart = align(sizeof(PolygonFileHeader));
+		const std::uint64_t offsetsBytes {vertexCount == 0 ? (polygonCount + 1) * sizeof(std::int64_t) : 0};
+		header.xsStart = align(header.offsetsStart + offsetsBytes);
+		header.ysStart = align(header.xsStart + totalVertexCount * floatBytes);
+		return header;
+	}
+
+	std::uint64_t getFileSize() const {
+		return ysStart + totalVertexCount * floatBytes;
+	}
+
+	static std::uint64_t align(std::uint64_t bytes) {
+		return (bytes + kAlignment - 1) / kAlignment * kAlignment;
+	}
+};
+
+static_assert(sizeof(PolygonFileHeader) == 64);
+
+/**
+ * A columnar polygon file mapped into memory.  Opening one reads nothing but the header; the
+ * columns are paged in as they are read, with MADV_SEQUENTIAL readahead.
+ */
+class PolygonFile {
+public:
+	/**
+	 * Opens an existing file read only and checks its header.
+	 */
+	explicit PolygonFile(const std::string& path) :
+		m_file {path}
+	{
+		if (!m_file.isOpen()) {
+			m_error = m_file.getError();
+			return;
+		}
+		if (m_file.size() < sizeof(PolygonFileHeader)) {
+			m_error = path + ": too short for a polygon file";
+			return;
+		}
+		std::memcpy(&m_header, m_file.data(), sizeof(m_header));
+		if (std::memcmp(m_header.magic, PolygonFileHeader::kMagic, sizeof(m_header.magic)) != 0) {
+			m_error = path + ": not a polygon file";
+		} else if (m_header.version != PolygonFileHeader::kVersion) {
+			m_error = path + ": unsupported version " + std::to_string(m_header.version);
+		} else if (m_header.floatBytes != sizeof(float) && m_header.floatBytes != sizeof(double)) {
+			m_error = path + ": unsupported coordinate size " + std::to_string(m_header.floatBytes);
+		} else if (!hasSections(m_file.size())) {
+			m_error = path + ": truncated, " + std::to_string(m_file.size()) + " of " + std::to_string(m_header.getFileSize()) + " bytes";
+		} else if (m_header.vertexCount != 0 && m_header.vertexCount < 3) {
+			m_error = path + ": polygons of " + std::to_string(m_header.vertexCount) + " vertices";
+		} else if (m_header.vertexCount != 0 && (m_header.totalVertexCount % m_header.vertexCount != 0
+				|| m_header.totalVertexCount / m_header.vertexCount != m_header.polygonCount)) {
+			m_error = path + ": vertex count does not match the polygon count";
+		} else if (m_header.vertexCount == 0) {
+			checkOffsets(path);
+		}
+		if (m_error.empty()) {
+			m_file.advise(MADV_SEQUENTIAL);
+		}
+	}
+
+	/**
+	 * Creates a file for the given header (see PolygonFileHeader::make), mapped read-write for the
+	 * caller to fill the columns in place.
+	 */
+	PolygonFile(const std::string& path, const PolygonFileHeader& header) :
+		m_file {path, static_cast<std::size_t>(header.getFileSize())},
+		m_header {header}
+	{
+		if (!m_file.isOpen()) {
+			m_error = m_file.getError();
+			return;
+		}
+		std::memcpy(m_file.data(), &m_header, sizeof(m_header));
+	}
+
+	bool isOpen() const {
+		return m_error.empty();
+	}
+
+	const std::string& getError() const {
+		return m_error;
+	}
+
+	const PolygonFileHeader& getHeader() const {
+		return m_header;
+	}
+
+	std::uint64_t getFileSize() const {
+		return m_header.getFileSize();
+	}
+
+	/**
+	 * @return The columns, in place.  FloatType must match the header's floatBytes.
+	 */
+	template <std::floating_point FloatType>
+	PolygonColumns<FloatType> getColumns() const {
+		assert(m_header.floatBytes == sizeof(FloatType) && "Coordinate type does not match the file.");
+		PolygonColumns<FloatType> columns {getXs<FloatType>(), getYs<FloatType>(), {}, static_cast<int>(m_header.vertexCount)};
+		if (m_header.vertexCount == 0) {
+			columns.offsets = getOffsets();
+		}
+		return columns;
+	}
+
+	template <std::floating_point FloatType>
+	std::span<FloatType> getXs() const {
+		return getSection<FloatType>(m_header.xsStart, m_header.totalVertexCount);
+	}
+
+	template <std::floating_point FloatType>
+	std::span<FloatType> getYs() const {
+		return getSection<FloatType>(m_header.ysStart, m_header.totalVertexCount);
+	}
+
+	/**
+	 * @return The offsets column, empty if every polygon has vertexCount vertices.
+	 */
+	std::span<std::int64_t> getOffsets() const {
+		return m_header.vertexCount == 0 ? getSection<std::int64_t>(m_header.offsetsStart, m_header.polygonCount + 1) : std::span<std::int64_t> {};
+	}
+
+	/**
+	 * Asks the kernel to start reading the vertices of polygons [first, last) ahead of use.
+	 */
+	template <std::floating_point FloatType>
+	void prefetch(const PolygonColumns<FloatType>& columns, std::size_t first, std::size_t last) const {
+		prefetchVertices(columns.getFirstVertex(first), getEndVertex(columns, last));
+	}
+
+	/**
+	 * Writes the columns back to the file and waits for them.
+	 */
+	bool sync() {
+		if (!m_file.sync()) {
+			m_error = m_file.getError();
+			return false;
+		}
+		return true;
+	}
+
+private:
+	MappedFile m_file;
+	PolygonFileHeader m_header {};
+	std::string m_error {};
+
+	/**
+	 * @return Whether every section lies within a file of the given size, without overflowing.
+	 */
+	bool hasSections(std::uint64_t fileSize) const {
+		auto fits = [fileSize](std::uint64_t start, std::uint64_t count, std::uint64_t bytes) {
+			return start <= fileSize && count <= (fileSize - start) / bytes;
+		};
+		return fits(m_header.xsStart, m_header.totalVertexCount, m_header.floatBytes)
+			&& fits(m_header.ysStart, m_header.totalVertexCount, m_header.floatBytes)
+			&& (m_header.vertexCount != 0 || (m_header.polygonCount < fileSize
+				&& fits(m_header.offsetsStart, m_header.polygonCount + 1, sizeof(std::int64_t))));
+	}
+
+	/**
+	 * The workers split and index the columns by the offsets, so they must start at 0, end at the
+	 * vertex count and give every polygon at least 3 vertices.  Reads the whole offsets column.
+	 */
+	void checkOffsets(const std::string& path) {
+		const auto offsets = getOffsets();
+		if (offsets.front() != 0 || offsets.back() != static_cast<std::int64_t>(m_header.totalVertexCount)) {
+			m_error = path + ": offsets do not span the columns";
+			return;
+		}
+		for (std::size_t p {1}; p < offsets.size(); p++) {
+			if (offsets[p] - offsets[p - 1] < 3) {
+				m_error = path + ": polygon " + std::to_string(p - 1) + " has " + std::to_string(offsets[p] - offsets[p - 1]) + " vertices";
+				return;
+			}
+		}
+	}
+
+	template <typename T>
+	std::span<T> getSection(std::uint64_t start, std::uint64_t count) const {
+		return {reinterpret_cast<T*>(m_file.data() + start), static_cast<std::size_t>(count)};
+	}
+
+	template <std::floating_point FloatType>
+	static std::int64_t getEndVertex(const PolygonColumns<FloatType>& columns, std::size_t last) {
+		return last >= columns.size() ? static_cast<std::int64_t>(columns.xs.size()) : columns.getFirstVertex(last);
+	}
+
+	void prefetchVertices(std::int64_t first, std::int64_t last) const {
+		if (last <= first) {
+			return;
+		}
+		const std::size_t offset {static_cast<std::size_t>(first) * m_header.floatBytes};
+		const std::size_t length {static_cast<std::size_t>(last - first) * m_header.floatBytes};
+		m_file.advise(MADV_WILLNEED, m_header.xsStart + offset, length);
+		m_file.advise(MADV_WILLNEED, m_header.ysStart + offset, length);
+	}
+};
+
+} // namespace geometry
+
+#endif // GEOMETRY_POLYGONFILE_H
@@ -0,0 +1,175 @@
+#ifndef SIMULATION_ACCUMULATORS_H
+#define SIMULATION_ACCUMULATORS_H
+
+#include <array>
+#include <concepts>
+#include <cstdint>
+
+#include "simulation/Estimators.h"
+
+namespace simulation {
+
+/*
+ * Accumulator policies: what a Simulation keeps of the ratios it computes.  reset() is called at the
+ * start of every run.  Accumulators with kPerSample == false only need the total, which lets the
+ * layouts keep the running sum in a register (or a SIMD vector) and hand it over once per run via
+ * addSum(); the others get every ratio through add(), in sample order, or, if they have
+ * addBatch(), a buffer of ratios at a time (RatioCollector, kRatioBatch), still in sample order.
+ */
+
+/**
+ * Sum of the ratios, all the estimate needs.
+ */
+template <std::floating_point FloatType>
+class SumAccumulator {
+public:
+	static constexpr bool kPerSample {false};
+
+	void reset() {
+		m_sum = 0;
+	}
+
+	void add(FloatType ratio) {
+		m_sum += ratio;
+	}
+
+	void addSum(FloatType sum, std::int64_t) {
+		m_sum += sum;
+	}
+
+	FloatType getSum() const {
+		return m_sum;
+	}
+
+private:
+	FloatType m_sum {0};
+};
+
+/**
+ * Mean and per-sample variance of the ratios, for an error bar from a single run.
+ */
+template <std::floating_point FloatType>
+class StatsAccumulator {
+public:
+	static constexpr bool kPerSample {true};
+
+	void reset() {
+		m_stats = {};
+	}
+
+	void add(FloatType ratio) {
+		m_stats.add(ratio);
+	}
+
+	FloatType getSum() const {
+		return m_stats.getMean() * static_cast<FloatType>(m_stats.getCount());
+	}
+
+	const RunningStats<FloatType>& getStats() const {
+		return m_stats;
+	}
+
+private:
+	RunningStats<FloatType> m_stats {};
+};
+
+/**
+ * Sum and lag autocorrelations of the ratio sequence, for sample sources whose consecutive samples
+ * share coordinates.
+ */
+template <std::floating_point FloatType>
+class AutocorrelationAccumulator {
+public:
+	/**
+	 * @param maxLag Highest lag to track; samples further apart should be independent.
+	 */
+	explicit AutocorrelationAccumulator(int maxLag = 0) :
+		m_autocorrelation {maxLag}
+	{}
+
+	static constexpr bool kPerSample {true};
+
+	void reset() {
+		m_sum = 0;
+		m_autocorrelation.reset();
+	}
+
+	void add(FloatType ratio) {
+		m_sum += ratio;
+		m_autocorrelation.add(ratio);
+	}
+
+	FloatType getSum() const {
+		return m_sum;
+	}
+
+	const AutocorrelationStats<FloatType>& getAutocorrelation() const {
+		return m_autocorrelation;
+	}
+
+private:
+	FloatType m_sum {0};
+	AutocorrelationStats<FloatType> m_autocorrelation;
+};
+
+/**
+ * Sum of the ratios that also hands every ratio to a sink, e.g. to dump them to a file or to
+ * histogram them.  The sink is the constructing thread's ambient one (Sink::get(), nullptr for
+ * none).
+ */
+template <std::floating_point FloatType, typename Sink>
+class SinkAccumulator {
+public:
+	static constexpr bool kPerSample {true};
+
+	void reset() {
+		m_sum = 0;
+	}
+
+	void add(FloatType ratio) {
+		m_sum += ratio;
+		if (m_sink) {
+			m_sink->add(ratio);
+		}
+	}
+
+	/**
+	 * Adds a buffer of ratios at once, in one call to the sink if it takes batches.
+	 */
+	void addBatch(const FloatType* ratios, int count) {
+		// four chains, so that the adds do not wait on each other
+		std::array<FloatType, 4> sums {};
+		int i {0};
+		for (; i + 4 <= count; i += 4) {
+			for (int j {0}; j < 4; j++) {
+				sums[j] += ratios[i + j];
+			}
+		}
+		for (; i < count; i++) {
+			sums[0] += ratios[i];
+		}
+		m_sum += (sums[0] + sums[1]) + (sums[2] + sums[3]);
+		if (!m_sink) {
+			return;
+		}
+		if constexpr (requires { m_sink->addBatch(ratios, count); }) {
+			m_sink->addBatch(ratios, count);
+		} else {
+			for (int i {0}; i < count; i++) {
+				m_sink->add(ratios[i]);
+			}
+		}
+	}
+
+	FloatType getSum() const {
+		return m_sum;
+	}
+
+private:
+	FloatType m_sum {0};
+	Sink* m_sink {Sink::get()};
+};
+
+} // namespace simulation
+
+#endif // SIMULATION_ACCUMULATORS_H
@@ -0,0 +1,573 @@
+#ifndef SIMULATION_ASYNCENGINE_H
+#define SIMULATION_ASYNCENGINE_H
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <coroutine>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <future>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "common/Concurrency.h"
+#include "common/MemoryResource.h"
+#include "simulation/Estimators.h"
+#include "simulation/ISimulation.h"
+#include "simulation/SeedSource.h"
+
+namespace simulation {
+
+/**
+ * Where an AsyncEngine runs its work: at most getThreadCount() tasks at a time, each running one
+ * slice of a job and then posting its successor.  Implement it over the caller's own thread pool or
+ * event loop to share its threads, or use WorkerPool.
+ */
+class Executor {
+public:
+	virtual ~Executor() = default;
+
+	/**
+	 * Runs the task later on some thread, not inline: the tasks post their successors.
+	 */
+	virtual void post(std::function<void()> task) = 0;
+
+	/**
+	 * @return How many tasks the executor runs at once, the most the engine keeps posted.
+	 */
+	virtual int getThreadCount() const {
+		return static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+	}
+};
+
+/**
+ * The engine's own executor: worker threads, optionally pinned, each with a memory pool of its own
+ * (ThreadMemoryResource) that outlives the simulations of the worker and keeps their buffers warm.
+ */
+class WorkerPool : public Executor {
+public:
+	/**
+	 * @param cpus CPUs to pin the workers to, in order; empty to leave them unpinned.
+	 */
+	explicit WorkerPool(int threads, const std::vector<int>& cpus = {}) {
+		for (int i {0}; i < threads; i++) {
+			const int cpu {cpus.empty() ? -1 : cpus[i % cpus.size()]};
+			m_workers.emplace_back([this, cpu] { work(cpu); });
+		}
+	}
+
+	/**
+	 * Runs the tasks already posted, then joins the workers.
+	 */
+	~WorkerPool() override {
+		{
+			std::lock_guard lock {m_mutex};
+			m_stopping = true;
+		}
+		m_ready.notify_all();
+		for (auto& worker : m_workers) {
+			worker.join();
+		}
+	}
+
+	WorkerPool(const WorkerPool&) = delete;
+	WorkerPool& operator=(const WorkerPool&) = delete;
+
+	void post(std::function<void()> task) override {
+		{
+			std::lock_guard lock {m_mutex};
+			m_tasks.push_back(std::move(task));
+		}
+		m_ready.notify_one();
+	}
+
+	int getThreadCount() const override {
+		return static_cast<int>(m_workers.size());
+	}
+
+private:
+	std::vector<std::thread> m_workers {};
+	std::mutex m_mutex {};
+	std::condition_variable m_ready {};
+	std::deque<std::function<void()>> m_tasks {};
+	bool m_stopping {false};
+
+	void work(int cpu) {
+		if (cpu >= 0 && !Concurrency::pin_to_core(cpu)) {
+			std::cerr << "Failed to pin engine worker to core " << cpu << std::endl;
+		}
+		auto arena = ThreadMemoryResource::make(ThreadMemoryResource::Kind::Pool);
+		ThreadMemoryResource::Scope memoryScope {arena.get()};
+		while (true) {
+			std::function<void()> task {};
+			{
+				std::unique_lock lock {m_mutex};
+				m_ready.wait(lock, [this] { return !m_tasks.empty() || m_stopping; });
+				if (m_tasks.empty()) {
+					return;
+				}
+				task = std::move(m_tasks.front());
+				m_tasks.pop_front();
+			}
+			task();
+		}
+	}
+};
+
+struct JobSpec {
+	std::string simulation {"adrian1"};
+	int ngon {3};
+	std::int64_t runs {1000000};
+	// with a seed, and without a precision, the result does not depend on the executor or the other jobs
+	std::optional<std::uint64_t> seed {};
+	// stop once the standard error is this small, 0 to run all the runs
+	double precision {0};
+};
+
+enum class JobStatus { Completed, Converged, Cancelled, Failed };
+
+struct JobProgress {
+	std::int64_t runsDone {0};
+	std::int64_t runs {0};
+	double mean {std::numeric_limits<double>::quiet_NaN()};
+	double standardError {std::numeric_limits<double>::quiet_NaN()};
+};
+
+struct JobResult {
+	JobStatus status {JobStatus::Completed};
+	std::string error {};
+	double mean {std::numeric_limits<double>::quiet_NaN()};
+	double standardError {std::numeric_limits<double>::quiet_NaN()};
+	std::int64_t runs {0};
+	std::int64_t slices {0};
+	double seconds {0};
+};
+
+using ProgressCallback = std::function<void(const JobProgress&)>;
+using CompletionCallback = std::function<void(const JobResult&)>;
+
+namespace detail {
+
+struct Job {
+	JobSpec spec {};
+	ProgressCallback onProgress {};
+	CompletionCallback onDone {};
+	std::chrono::steady_clock::time_point submitted {};
+	std::int64_t sliceCount {0};
+	std::atomic<bool> cancelRequested {false};
+
+	// guarded by the engine's mutex
+	std::int64_t nextSlice {0};
+	std::int64_t finishedSlices {0};
+	std::int64_t runsDone {0};
+	double sumDone {0};
+	bool stopped {false};
+	bool finished {false};
+	JobStatus status {JobStatus::Completed};
+	std::string error {};
+	std::vector<double> sliceSums {}; // of the slices handed out
+	RunningStats<double> sliceMeans {}; // of the full slices, as they finish
+
+	// serialises the callbacks, which may call back into the handle
+	std::mutex callbackMutex {};
+	// guarded by the job's own mutex
+	std::mutex mutex {};
+	JobProgress progress {};
+	std::optional<JobResult> result {};
+	std::promise<JobResult> promise {};
+	std::future<JobResult> future {promise.get_future()};
+	std::coroutine_handle<> waiter {};
+};
+
+} // namespace detail
+
+/**
+ * A submitted job: cancel it, poll its progress, wait on its future or co_await its result.
+ * Copies refer to the same job; a default-constructed handle refers to none.
+ */
+class JobHandle {
+public:
+	JobHandle() = default;
+
+	explicit JobHandle(std::shared_ptr<detail::Job> job) :
+		m_job {std::move(job)}
+	{}
+
+	/**
+	 * @return Whether the handle refers to a job.
+	 */
+	bool isValid() const {
+		return m_job != nullptr;
+	}
+
+	/**
+	 * Stops handing out the job's slices; the result, with JobStatus::Cancelled, comes once the slices
+	 * already running are done.  No effect on a job with no slice left to hand out, nor on no job.
+	 */
+	void cancel() {
+		if (m_job) {
+			m_job->cancelRequested = true;
+		}
+	}
+
+	/**
+	 * @return The progress so far, a default JobProgress for no job.
+	 */
+	JobProgress getProgress() const {
+		if (!m_job) {
+			return {};
+		}
+		std::lock_guard lock {m_job->mutex};
+		return m_job->progress;
+	}
+
+	/**
+	 * @return The future of the result.  Only once per job, like std::promise::get_future(); throws
+	 *         std::future_error with no_state for no job.
+	 */
+	std::future<JobResult> getFuture() {
+		if (!m_job) {
+			throw std::future_error {std::future_errc::no_state};
+		}
+		std::lock_guard lock {m_job->mutex};
+		if (!m_job->future.valid()) {
+			throw std::future_error {std::future_errc::future_already_retrieved};
+		}
+		return std::move(m_job->future);
+	}
+
+	/**
+	 * co_await: the coroutine resumes on the thread that finishes the job.  One awaiter per job, and
+	 * only on a valid handle.
+	 */
+	bool await_ready() const {
+		assert(m_job && "co_await on a JobHandle without a job");
+		std::lock_guard lock {m_job->mutex};
+		return m_job->result.has_value();
+	}
+
+	bool await_suspend(std::coroutine_handle<> waiter) {
+		std::lock_guard lock {m_job->mutex};
+		if (m_job->result) {
+			return false;
+		}
+		m_job->waiter = waiter;
+		return true;
+	}
+
+	JobResult await_resume() const {
+		std::lock_guard lock {m_job->mutex};
+		return *m_job->result;
+	}
+
+private:
+	std::shared_ptr<detail::Job> m_job {};
+};
+
+/**
+ * Runs simulation jobs asynchronously, for embedding the simulations in a service: submit() returns
+ * at once with a JobHandle, and the result arrives through its future, a completion callback or
+ * co_await, with progress callbacks after every slice.
+ *
+ * Jobs are cut into slices of at most kSliceRuns runs, and the executor's threads take slices from
+ * the jobs in turn (round robin), so every job in flight gets an equal share: a small job waits for
+ * at most one slice per thread, however large the jobs ahead of it.  There is one task per thread,
+ * which runs a slice and posts itself again while any job has slices left, so submitting a job
+ * costs the same however many runs it has.  With a seed, slice s of a job
+ * draws its sources' seeds from (seed, s) (simulation/SeedSource.h) and the slices are summed in
+ * order, so the result does not depend on the thread count or the other jobs.  With a precision,
+ * the job stops taking slices once the standard error of the slice means finished so far is below
+ * it; which slices have finished by then, and so the runs and the result, depends on the timing,
+ * even with a seed.
+ *
+ * The callbacks run on the executor's threads and must not block for long; those of one job never
+ * overlap.
+ * @tparam MakeSimulation Callable (const std::string& name, int runs, int ngon) returning the
+ *         simulation, nullptr for an unknown name.
+ */
+template <typename MakeSimulation = std::function<std::unique_ptr<ISimulation<double>>(const std::string&, int, int)>>
+class AsyncEngine {
+public:
+	// about a millisecond of the slower simulations: the longest a new job waits for a thread
+	static constexpr int kSliceRuns {1 << 16};
+	// the standard error comes from the spread of the slice means, which needs a few of them
+	static constexpr int kMinSlicesForError {4};
+
+	/**
+	 * Runs the jobs on a WorkerPool of its own.
+	 * @param cpus CPUs to pin the workers to, in order; empty to leave them unpinned.
+	 */
+	AsyncEngine(int threads, const std::vector<int>& cpus, MakeSimulation makeSimulation) :
+		m_ownExecutor {std::make_unique<WorkerPool>(threads, cpus)},
+		m_executor {*m_ownExecutor},
+		m_makeSimulation {std::move(makeSimulation)}
+	{}
+
+	/**
+	 * Runs the jobs on the caller's executor, which must outlive the engine.
+	 */
+	AsyncEngine(Executor& executor, MakeSimulation makeSimulation) :
+		m_executor {executor},
+		m_makeSimulation {std::move(makeSimulation)}
+	{}
+
+	/**
+	 * Cancels the jobs still queued and waits for the tasks already posted.
+	 */
+	~AsyncEngine() {
+		std::unique_lock lock {m_mutex};
+		for (auto& job : m_queue) {
+			job->cancelRequested = true;
+		}
+		m_idle.wait(lock, [this] { return m_pendingTasks == 0; });
+	}
+
+	AsyncEngine(const AsyncEngine&) = delete;
+	AsyncEngine& operator=(const AsyncEngine&) = delete;
+
+	/**
+	 * @param onProgress Called after every slice.
+	 * @param onDone Called with the result, before the future is ready.
+	 */
+	JobHandle submit(JobSpec spec, ProgressCallback onProgress = {}, CompletionCallback onDone = {}) {
+		auto job = std::make_shared<detail::Job>();
+		job->spec = std::move(spec);
+		job->onProgress = std::move(onProgress);
+		job->onDone = std::move(onDone);
+		job->submitted = std::chrono::steady_clock::now();
+		job->sliceCount = std::max<std::int64_t>(0, (job->spec.runs + kSliceRuns - 1) / kSliceRuns);
+		job->progress.runs = job->spec.runs;
+		JobHandle handle {job};
+		if (job->sliceCount == 0) {
+			job->status = JobStatus::Failed;
+			job->error = "no runs";
+			job->finished = true;
+			finish(*job);
+			return handle;
+		}
+		std::int64_t tasks {0};
+		{
+			std::lock_guard lock {m_mutex};
+			m_queue.push_back(job);
+			m_activeJobs++;
+			// the tasks already posted serve the new job too: a task runs whichever slice is next in turn
+			tasks = std::clamp<std::int64_t>(m_executor.getThreadCount() - m_pendingTasks, 0, job->sliceCount);
+			m_pendingTasks += tasks;
+		}
+		for (std::int64_t t {0}; t < tasks; t++) {
+			m_executor.post([this] { runSlice(); });
+		}
+		return handle;
+	}
+
+	std::int64_t getActiveJobs() {
+		std::lock_guard lock {m_mutex};
+		return m_activeJobs;
+	}
+
+	/**
+	 * @return The standard error of the mean of equal slices, from the spread of their means; NaN for too few.
+	 */
+	static double getStandardError(const RunningStats<double>& sliceMeans) {
+		return sliceMeans.getCount() >= kMinSlicesForError ? std::sqrt(sliceMeans.getVariance() / static_cast<double>(sliceMeans.getCount()))
+			: std::numeric_limits<double>::quiet_NaN();
+	}
+
+private:
+	std::unique_ptr<WorkerPool> m_ownExecutor {};
+	Executor& m_executor;
+	MakeSimulation m_makeSimulation;
+	std::mutex m_mutex {};
+	std::condition_variable m_idle {};
+	std::deque<std::shared_ptr<detail::Job>> m_queue {};
+	std::int64_t m_activeJobs {0};
+	std::int64_t m_pendingTasks {0}; // posted and not yet done, at most the executor's thread count
+
+	static int getSliceRuns(const detail::Job& job, std::int64_t slice) {
+		return static_cast<int>(std::min<std::int64_t>(kSliceRuns, job.spec.runs - slice * kSliceRuns));
+	}
+
+	/**
+	 * Marks the job finished once it is stopped or out of slices and none is running.  Under the mutex.
+	 * @return Whether the caller is the one to finish it.
+	 */
+	bool claimFinish(detail::Job& job) {
+		// a cancel that comes after the last slice was handed out stops nothing: the job completes
+		if (job.cancelRequested && !job.stopped && job.nextSlice < job.sliceCount) {
+			job.stopped = true;
+			job.status = JobStatus::Cancelled;
+		}
+		if (job.finished || job.finishedSlices < job.nextSlice || (!job.stopped && job.nextSlice < job.sliceCount)) {
+			return false;
+		}
+		job.finished = true;
+		m_activeJobs--;
+		return true;
+	}
+
+	/**
+	 * Takes the next slice of the job at the front of the queue, which then goes to the back; jobs
+	 * found stopped leave the queue, and are finished here if no slice of theirs is running.
+	 * @return The job and slice, or no job if there is no slice left.
+	 */
+	std::pair<std::shared_ptr<detail::Job>, std::int64_t> take() {
+		std::unique_lock lock {m_mutex};
+		while (!m_queue.empty()) {
+			std::shared_ptr<detail::Job> job {std::move(m_queue.front())};
+			m_queue.pop_front();
+			if (job->cancelRequested || job->stopped) {
+				if (claimFinish(*job)) {
+					lock.unlock();
+					finish(*job);
+					lock.lock();
+				}
+				continue;
+			}
+			const std::int64_t slice {job->nextSlice++};
+			job->sliceSums.push_back(0.0);
+			if (job->nextSlice < job->sliceCount) {
+				m_queue.push_back(job);
+			}
+			return {std::move(job), slice};
+		}
+		return {nullptr, 0};
+	}
+
+	void runSlice() {
+		auto [job, slice] = take();
+		if (job) {
+			const int runs {getSliceRuns(*job, slice)};
+			std::optional<SeedSource> seeds {};
+			if (job->spec.seed) {
+				seeds.emplace(*job->spec.seed, static_cast<std::uint64_t>(slice));
+			}
+			SeedSource::Scope seedScope {seeds ? &*seeds : nullptr};
+			double sum {0};
+			std::string error {};
+			try {
+				auto sim = m_makeSimulation(job->spec.simulation, runs, job->spec.ngon);
+				if (sim) {
+					sim->prepare();
+					sim->run();
+					sum = sim->getSumOfRatios();
+				} else {
+					error = "unknown simulation: " + job->spec.simulation;
+				}
+			} catch (const std::exception& e) {
+				error = e.what();
+			}
+			finishSlice(*job, slice, runs, sum, error);
+		}
+		{
+			std::lock_guard lock {m_mutex};
+			if (m_queue.empty()) {
+				if (--m_pendingTasks == 0) {
+					m_idle.notify_all();
+				}
+				return;
+			}
+		}
+		// posting again rather than looping lets the executor's other work in between slices
+		m_executor.post([this] { runSlice(); });
+	}
+
+	void finishSlice(detail::Job& job, std::int64_t slice, int runs, double sum, const std::string& error) {
+		std::unique_lock lock {m_mutex};
+		job.sliceSums[slice] = sum;
+		job.finishedSlices++;
+		if (!error.empty()) {
+			if (job.status != JobStatus::Failed) {
+				job.status = JobStatus::Failed;
+				job.error = error;
+			}
+			job.stopped = true;
+		} else {
+			job.runsDone += runs;
+			job.sumDone += sum;
+			if (runs == kSliceRuns) {
+				job.sliceMeans.add(sum / runs);
+			}
+		}
+		if (!job.stopped && job.spec.precision > 0 && getStandardError(job.sliceMeans) <= job.spec.precision) {
+			job.stopped = true;
+			job.status = JobStatus::Converged;
+		}
+		const JobProgress progress {job.runsDone, job.spec.runs, job.runsDone > 0 ? job.sumDone / static_cast<double>(job.runsDone)
+			: std::numeric_limits<double>::quiet_NaN(), getStandardError(job.sliceMeans)};
+		const bool last {claimFinish(job)};
+		lock.unlock();
+
+		{
+			std::lock_guard callbackLock {job.callbackMutex};
+			bool advanced {false};
+			{
+				std::lock_guard jobLock {job.mutex};
+				// slices finish out of order: report only progress
+				if (progress.runsDone >= job.progress.runsDone) {
+					job.progress = progress;
+					advanced = true;
+				}
+			}
+			if (advanced && job.onProgress) {
+				job.onProgress(progress);
+			}
+		}
+		if (last) {
+			finish(job);
+		}
+	}
+
+	/**
+	 * Sums the slices in order, whichever threads ran them, and delivers the result.
+	 */
+	void finish(detail::Job& job) {
+		JobResult result {job.status, job.error};
+		RunningStats<double> sliceMeans {};
+		double total {0};
+		for (std::int64_t s {0}; s < job.nextSlice; s++) {
+			total += job.sliceSums[s];
+			result.runs += getSliceRuns(job, s);
+			if (getSliceRuns(job, s) == kSliceRuns) {
+				sliceMeans.add(job.sliceSums[s] / kSliceRuns);
+			}
+		}
+		if (result.runs > 0 && result.status != JobStatus::Failed) {
+			result.mean = total / static_cast<double>(result.runs);
+			result.standardError = getStandardError(sliceMeans);
+		}
+		result.slices = job.nextSlice;
+		result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - job.submitted).count();
+
+		std::coroutine_handle<> waiter {};
+		{
+			std::lock_guard callbackLock {job.callbackMutex};
+			if (job.onDone) {
+				job.onDone(result);
+			}
+			std::lock_guard jobLock {job.mutex};
+			job.result = result;
+			job.promise.set_value(result);
+			waiter = std::exchange(job.waiter, nullptr);
+		}
+		if (waiter) {
+			waiter.resume();
+		}
+	}
+};
+
+} // namespace simulation
+
+#endif // SIMULATION_ASYNCENGINE_H
@@ -0,0 +1,470 @@
+#ifndef SIMULATION_DISTRIBUTIONS_H
+#define SIMULATION_DISTRIBUTIONS_H
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cmath>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory_resource>
+#include <utility>
+#include <vector>
+
+#include "hwy/highway.h"
+
+namespace simulation {
+
+/**
+ * Fixed-bin histogram of the ratios over [0, 1], mergeable across threads by adding the counts.
+ * addBatch() computes the bin indices of a block of ratios with SIMD first and only then counts
+ * them, so a layout can hand over its ratios a buffer at a time.  The counts the hot path increments
+ * are 32-bit, half the cache footprint of 64-bit ones; they are folded into 64-bit totals before
+ * they can overflow.
+ */
+template <std::floating_point FloatType>
+class RatioHistogram {
+public:
+	static constexpr int kBins {1024};
+	// ratios binned per pass of addBatch()
+	static constexpr int kBlock {256};
+
+	void add(FloatType ratio) {
+		reserveCounts(1);
+		m_counts[getBin(ratio)]++;
+	}
+
+	void addBatch(const FloatType* ratios, int count) {
+		namespace hn = hwy::HWY_NAMESPACE;
+		using D = hn::ScalableTag<FloatType>;
+		using DI = hn::RebindToSigned<D>;
+		using IndexType = hn::TFromD<DI>;
+		const D d;
+		const DI di;
+		const int lanes {static_cast<int>(hn::Lanes(d))};
+		assert(lanes <= kBlock && "More SIMD lanes than a block holds.");
+		const auto scale = hn::Set(d, static_cast<FloatType>(kBins));
+		const auto lowest = hn::Zero(di);
+		const auto highest = hn::Set(di, static_cast<IndexType>(kBins - 1));
+		std::array<IndexType, kBlock> bins; // filled before it is read, not worth zeroing per call
+		for (int begin {0}; begin < count; begin += kBlock) {
+			const int size {std::min(kBlock, count - begin)};
+			const FloatType* block {ratios + begin};
+			reserveCounts(size);
+			int i {0};
+			for (; i + lanes <= size; i += lanes) {
+				// truncation is the floor for the non-negative ratios; 1.0 lands in the last bin
+				hn::StoreU(hn::Min(hn::Max(hn::ConvertTo(di, hn::Mul(hn::LoadU(d, block + i), scale)), lowest), highest), di, bins.data() + i);
+			}
+			for (; i < size; i++) {
+				bins[i] = static_cast<IndexType>(getBin(block[i]));
+			}
+			for (i = 0; i < size; i++) {
+				m_counts[bins[i]]++;
+			}
+		}
+	}
+
+	void merge(const RatioHistogram& other) {
+		fold();
+		for (int b {0}; b < kBins; b++) {
+			m_totals[b] += other.getCount(b);
+		}
+	}
+
+	std::int64_t getCount(int bin) const {
+		return m_totals[bin] + m_counts[bin];
+	}
+
+	std::int64_t getTotal() const {
+		std::int64_t total {0};
+		for (int b {0}; b < kBins; b++) {
+			total += getCount(b);
+		}
+		return total;
+	}
+
+	/**
+	 * @return The fraction of ratios below the threshold, interpolated linearly within its bin.
+	 */
+	double getMassBelow(double threshold) const {
+		const double position {std::clamp(threshold, 0.0, 1.0) * kBins};
+		const int fullBins {std::min(static_cast<int>(position), kBins)};
+		double below {0};
+		for (int b {0}; b < fullBins; b++) {
+			below += static_cast<double>(getCount(b));
+		}
+		if (fullBins < kBins) {
+			below += (position - fullBins) * static_cast<double>(getCount(fullBins));
+		}
+		const std::int64_t total {getTotal()};
+		return total > 0 ? below / static_cast<double>(total) : 0.0;
+	}
+
+	static double getBinLow(int bin) {
+		return static_cast<double>(bin) / kBins;
+	}
+
+private:
+	std::array<std::uint32_t, kBins> m_counts {};
+	std::array<std::int64_t, kBins> m_totals {};
+	// ratios counted in m_counts since the last fold, which bounds every one of them
+	std::int64_t m_unfolded {0};
+
+	static int getBin(FloatType ratio) {
+		return std::clamp(static_cast<int>(ratio * kBins), 0, kBins - 1);
+	}
+
+	/**
+	 * Folds the 32-bit counts into the totals if `count` more could overflow one of them.
+	 */
+	void reserveCounts(int count) {
+		if (m_unfolded + count > std::numeric_limits<std::uint32_t>::max()) {
+			fold();
+		}
+		m_unfolded += count;
+	}
+
+	void fold() {
+		for (int b {0}; b < kBins; b++) {
+			m_totals[b] += m_counts[b];
+			m_counts[b] = 0;
+		}
+		m_unfolded = 0;
+	}
+};
+
+/**
+ * KLL quantile sketch (Karnin, Lang and Liberty 2016): a stack of compactors, level h holding items
+ * of weight 2^h.  A full level is sorted and every other item, from an alternating offset, moves up a
+ * level; capacities shrink by 2/3 per level down from the top, so the sketch keeps O(k) items.  Only
+ * the level items enter at is ever sorted: what a compaction moves up is a sorted run, which is
+ * merged into the sorted level above.
+ *
+ * Sorting is what costs, so, as in the paper, the bottom levels give way to a sampler once the count
+ * allows it: at sampler level s one random item of every 2^s enters level s, which keeps 2^s below
+ * count / 2^kSamplerScaleBits.  With the default k the rank error stays within about 0.5% of the
+ * count (0.15% on average over uniform ratios).
+ *
+ * Mergeable: merging adds level by level and compacts (the partial sampler group of the other sketch
+ * is dropped).  All levels are reserved up front, so adding allocates nothing.
+ */
+template <std::floating_point FloatType>
+class QuantileSketch {
+public:
+	static constexpr int kMaxLevels {32};
+	static constexpr int kMinCapacity {8};
+	static constexpr int kSamplerScaleBits {15};
+
+	/**
+	 * @param k Capacity of the top level, which sets the accuracy.
+	 */
+	explicit QuantileSketch(std::pmr::memory_resource* memory = std::pmr::get_default_resource(), int k = 1024) :
+		m_k {k},
+		m_levels(kMaxLevels, memory),
+		m_promoted(memory)
+	{
+		for (auto& level : m_levels) {
+			// a level holds fewer than its capacity plus half the capacity of the one below; reserving
+			// only claims address space, the pages are touched as the levels fill
+			level.reserve(3 * static_cast<std::size_t>(k) / 2);
+		}
+		m_promoted.reserve(3 * static_cast<std::size_t>(k) / 4 + 1);
+		updateCapacities();
+	}
+
+	void add(FloatType x) {
+		m_count++;
+		if (m_samplerLevel == 0) {
+			addToLevel(0, x);
+			raiseSampler();
+			return;
+		}
+		if (m_groupPosition == m_groupPick) {
+			m_candidate = x;
+		}
+		if (++m_groupPosition == (std::int64_t {1} << m_samplerLevel)) {
+			closeGroup();
+		}
+	}
+
+	/**
+	 * Same as add() of each item in turn, but once the sampler runs only the picked item of every
+	 * group is read, so a batch costs O(count / 2^s).
+	 */
+	void addBatch(const FloatType* xs, int count) {
+		int i {0};
+		for (; i < count && m_samplerLevel == 0; i++) {
+			add(xs[i]);
+		}
+		while (i < count) {
+			const std::int64_t step {std::min<std::int64_t>((std::int64_t {1} << m_samplerLevel) - m_groupPosition, count - i)};
+			if (m_groupPick >= m_groupPosition && m_groupPick < m_groupPosition + step) {
+				m_candidate = xs[i + (m_groupPick - m_groupPosition)];
+			}
+			m_count += step;
+			m_groupPosition += step;
+			i += static_cast<int>(step);
+			if (m_groupPosition == (std::int64_t {1} << m_samplerLevel)) {
+				closeGroup();
+			}
+		}
+	}
+
+	void merge(const QuantileSketch& other) {
+		m_count += other.m_count;
+		if (other.m_height > m_height) {
+			m_height = other.m_height;
+			updateCapacities();
+		}
+		for (int h {0}; h < other.m_height; h++) {
+			m_levels[h].insert(m_levels[h].end(), other.m_levels[h].begin(), other.m_levels[h].end());
+		}
+		if (other.m_samplerLevel > m_samplerLevel) {
+			m_samplerLevel = other.m_samplerLevel;
+			m_groupPosition = 0;
+			m_groupPick = 0;
+		}
+		for (int h {0}; h < m_height; h++) {
+			if (h != m_samplerLevel) {
+				std::sort(m_levels[h].begin(), m_levels[h].end());
+			}
+		}
+		compress();
+	}
+
+	std::int64_t getCount() const {
+		return m_count;
+	}
+
+	/**
+	 * @param q Quantile in [0, 1].
+	 * @return The smallest retained item whose weighted rank reaches q of the count, NaN if empty.
+	 */
+	FloatType getQuantile(double q) const {
+		std::vector<std::pair<FloatType, std::int64_t>> weighted {};
+		for (int h {0}; h < m_height; h++) {
+			for (FloatType x : m_levels[h]) {
+				weighted.emplace_back(x, std::int64_t {1} << h);
+			}
+		}
+		if (weighted.empty()) {
+			return std::numeric_limits<FloatType>::quiet_NaN();
+		}
+		std::sort(weighted.begin(), weighted.end());
+		std::int64_t totalWeight {0};
+		for (const auto& item : weighted) {
+			totalWeight += item.second;
+		}
+		const double target {std::clamp(q, 0.0, 1.0) * static_cast<double>(totalWeight)};
+		std::int64_t rank {0};
+		for (const auto& item : weighted) {
+			rank += item.second;
+			if (static_cast<double>(rank) >= target) {
+				return item.first;
+			}
+		}
+		return weighted.back().first;
+	}
+
+	/**
+	 * @return Items currently kept, for judging the sketch's footprint.
+	 */
+	std::size_t getRetained() const {
+		std::size_t retained {0};
+		for (int h {0}; h < m_height; h++) {
+			retained += m_levels[h].size();
+		}
+		return retained;
+	}
+
+private:
+	int m_k;
+	int m_height {1};
+	std::int64_t m_count {0};
+	std::pmr::vector<std::pmr::vector<FloatType>> m_levels;
+	std::pmr::vector<FloatType> m_promoted; // the run a compaction moves up
+	std::array<int, kMaxLevels> m_capacities {};
+	std::uint64_t m_offsetBits {0}; // one alternating offset bit per level
+	int m_samplerLevel {0};
+	std::int64_t m_groupPosition {0};
+	std::int64_t m_groupPick {0};
+	FloatType m_candidate {0};
+	std::uint64_t m_random {0x9e3779b97f4a7c15};
+
+	/**
+	 * Moves the candidate of a complete group up to the sampler level and starts the next group.
+	 */
+	void closeGroup() {
+		m_groupPosition = 0;
+		m_groupPick = static_cast<std::int64_t>(nextRandom() & ((std::uint64_t {1} << m_samplerLevel) - 1));
+		addToLevel(m_samplerLevel, m_candidate);
+		raiseSampler();
+	}
+
+	/**
+	 * Moves the sampler up a level once the count allows it; only called at a group boundary.
+	 */
+	void raiseSampler() {
+		if (m_count >= (std::int64_t {2} << (m_samplerLevel + kSamplerScaleBits)) && m_samplerLevel + 1 < kMaxLevels) {
+			// items no longer enter the level below, which from now on stays sorted like the others
+			std::sort(m_levels[m_samplerLevel].begin(), m_levels[m_samplerLevel].end());
+			m_samplerLevel++;
+			m_groupPick = static_cast<std::int64_t>(nextRandom() & ((std::uint64_t {1} << m_samplerLevel) - 1));
+			if (m_samplerLevel >= m_height) {
+				m_height = m_samplerLevel + 1;
+				updateCapacities();
+			}
+		}
+	}
+
+	void addToLevel(int h, FloatType x) {
+		m_levels[h].push_back(x);
+		if (static_cast<int>(m_levels[h].size()) >= m_capacities[h]) {
+			compress();
+		}
+	}
+
+	/**
+	 * splitmix64: the sampler's picks need to be unbiased, not strong.
+	 */
+	std::uint64_t nextRandom() {
+		std::uint64_t z {m_random += 0x9e3779b97f4a7c15};
+		z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9;
+		z = (z ^ (z >> 27)) * 0x94d049bb133111eb;
+		return z ^ (z >> 31);
+	}
+
+	void updateCapacities() {
+		for (int h {0}; h < kMaxLevels; h++) {
+			const int depth {std::max(0, m_height - 1 - h)};
+			m_capacities[h] = std::max(kMinCapacity, static_cast<int>(m_k * std::pow(2.0 / 3.0, depth)));
+		}
+	}
+
+	/**
+	 * Merges the promoted run into level h, from the back so that nothing is overwritten before it is
+	 * read; the level items enter at is sorted when it is compacted, so there the run is appended.
+	 */
+	void mergeUp(int h) {
+		auto& level = m_levels[h];
+		if (h == m_samplerLevel) {
+			level.insert(level.end(), m_promoted.begin(), m_promoted.end());
+			return;
+		}
+		std::size_t kept {level.size()};
+		std::size_t promoted {m_promoted.size()};
+		level.resize(kept + promoted);
+		for (std::size_t out {level.size()}; promoted > 0;) {
+			if (kept > 0 && level[kept - 1] > m_promoted[promoted - 1]) {
+				level[--out] = level[--kept];
+			} else {
+				level[--out] = m_promoted[--promoted];
+			}
+		}
+	}
+
+	/**
+	 * Compacts every level at or over capacity, bottom up.
+	 */
+	void compress() {
+		for (int h {0}; h < m_height; h++) {
+			if (static_cast<int>(m_levels[h].size()) < m_capacities[h]) {
+				continue;
+			}
+			if (h + 1 == kMaxLevels) {
+				// 2^31 times k samples, never reached: the top level just grows
+				break;
+			}
+			if (h + 1 == m_height) {
+				m_height++;
+				updateCapacities();
+			}
+			auto& level = m_levels[h];
+			if (h == m_samplerLevel) {
+				std::sort(level.begin(), level.end());
+			}
+			// an odd item out stays behind, so only pairs are halved
+			const std::size_t paired {level.size() & ~std::size_t {1}};
+			const std::size_t offset {(m_offsetBits >> h) & 1u};
+			m_offsetBits ^= std::uint64_t {1} << h;
+			m_promoted.clear();
+			for (std::size_t i {offset}; i < paired; i += 2) {
+				m_promoted.push_back(level[i]);
+			}
+			level.erase(level.begin(), level.begin() + static_cast<std::ptrdiff_t>(paired));
+			mergeUp(h + 1);
+		}
+	}
+};
+
+/**
+ * Histogram and quantile sketch of the ratios together, what --distribution reports.
+ *
+ * Only the histogram sees every ratio.  The sketch is the expensive part, so it is fed a systematic
+ * sample, one ratio of every kSketchStride, which a batch hands over without reading the others;
+ * the quantiles are ranks relative to the sketch's own count, so they are unbiased.  With at least
+ * kSketchStride * 2^kSamplerScaleBits ratios the sketch's sampler is running anyway and the stride
+ * costs no accuracy; below that the quantiles rest on fewer items (the tail from the histogram does not).
+ */
+template <std::floating_point FloatType>
+class RatioDistribution {
+public:
+	static constexpr int kSketchStride {64};
+
+	explicit RatioDistribution(std::pmr::memory_resource* memory = std::pmr::get_default_resource()) :
+		m_sketch {memory}
+	{}
+
+	void add(FloatType ratio) {
+		m_histogram.add(ratio);
+		if (--m_untilSketch == 0) {
+			m_sketch.add(ratio);
+			m_untilSketch = kSketchStride;
+		}
+	}
+
+	void addBatch(const FloatType* ratios, int count) {
+		m_histogram.addBatch(ratios, count);
+		int i {m_untilSketch - 1};
+		for (; i < count; i += kSketchStride) {
+			m_sketch.add(ratios[i]);
+		}
+		m_untilSketch = i - count + 1;
+	}
+
+	void merge(const RatioDistribution& other) {
+		m_histogram.merge(other.m_histogram);
+		m_sketch.merge(other.m_sketch);
+	}
+
+	/**
+	 * @return Ratios seen, all of which the histogram holds.
+	 */
+	std::int64_t getCount() const {
+		return m_histogram.getTotal();
+	}
+
+	const RatioHistogram<FloatType>& getHistogram() const {
+		return m_histogram;
+	}
+
+	/**
+	 * @return The sketch of the sampled ratios, one of every kSketchStride.
+	 */
+	const QuantileSketch<FloatType>& getSketch() const {
+		return m_sketch;
+	}
+
+private:
+	RatioHistogram<FloatType> m_histogram {};
+	QuantileSketch<FloatType> m_sketch;
+	// ratios to go until the next one the sketch takes, in [1, kSketchStride]
+	int m_untilSketch {kSketchStride};
+};
+
+} // namespace simulation
+
+#endif // SIMULATION_DISTRIBUTIONS_H
@@ -0,0 +1,313 @@
+#ifndef SIMULATION_ESTIMATORS_H
+#define SIMULATION_ESTIMATORS_H
+
+#include <algorithm>
+#include <concepts>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <string_view>
+#include <vector>
+
+namespace simulation {
+
+/**
+ * Estimators for the mean ratio, selectable per simulation.
+ */
+enum class Estimator {
+	Mean,           // raw sample mean
+	Antithetic,     // pairs a polygon with its vertex-0 reflection (3 - u) through the box center
+	ControlVariate, // corrects the mean with the polygon area, whose expectation is known
+};
+
+inline std::optional<Estimator> parseEstimator(std::string_view name) {
+	if (name == "mean") {
+		return Estimator::Mean;
+	} else if (name == "antithetic") {
+		return Estimator::Antithetic;
+	} else if (name == "control") {
+		return Estimator::ControlVariate;
+	}
+	return std::nullopt;
+}
+
+/**
+ * Expected area of a triangle with vertices uniform in a unit square.
+ */
+inline constexpr double kExpectedTriangleArea {11.0 / 144.0};
+
+/**
+ * Expected squared (shoelace) area of a polygon with pointCount vertices uniform in a unit square.
+ * The signed doubled area S is translation invariant and only the diagonal terms of E[S^2] survive,
+ * each contributing 2 * (1/12)^2, hence E[(S/2)^2] = pointCount / 288.
+ */
+inline constexpr double expectedSquaredPolygonArea(int pointCount) {
+	return pointCount / 288.0;
+}
+
+/**
+ * Running mean and variance (Welford), mergeable across threads (Chan et al.).
+ */
+template <std::floating_point FloatType>
+class RunningStats {
+public:
+	void add(FloatType x) {
+		m_count++;
+		const FloatType delta {x - m_mean};
+		m_mean += delta / static_cast<FloatType>(m_count);
+		m_m2 += delta * (x - m_mean);
+	}
+
+	/**
+	 * Adds a batch of values: a mean pass and a deviation pass over the batch, then one merge, instead
+	 * of the division per value of add().
+	 */
+	template <typename ValueType>
+	void addBatch(std::span<const ValueType> values) {
+		if (values.empty()) {
+			return;
+		}
+		RunningStats batch {};
+		batch.m_count = static_cast<std::int64_t>(values.size());
+		FloatType sum {0};
+		for (const ValueType value : values) {
+			sum += static_cast<FloatType>(value);
+		}
+		batch.m_mean = sum / static_cast<FloatType>(batch.m_count);
+		for (const ValueType value : values) {
+			const FloatType delta {static_cast<FloatType>(value) - batch.m_mean};
+			batch.m_m2 += delta * delta;
+		}
+		merge(batch);
+	}
+
+	void merge(const RunningStats& other) {
+		if (other.m_count == 0) {
+			return;
+		}
+		const std::int64_t count {m_count + other.m_count};
+		const FloatType delta {other.m_mean - m_mean};
+		m_mean += delta * static_cast<FloatType>(other.m_count) / static_cast<FloatType>(count);
+		m_m2 += other.m_m2 + delta * delta * static_cast<FloatType>(m_count) * static_cast<FloatType>(other.m_count) / static_cast<FloatType>(count);
+		m_count = count;
+	}
+
+	std::int64_t getCount() const {
+		return m_count;
+	}
+
+	FloatType getMean() const {
+		return m_mean;
+	}
+
+	FloatType getVariance() const {
+		return m_count > 1 ? m_m2 / static_cast<FloatType>(m_count - 1) : FloatType {0};
+	}
+
+private:
+	std::int64_t m_count {0};
+	FloatType m_mean {0};
+	FloatType m_m2 {0};
+};
+
+/**
+ * Online control-variate estimator: tracks the means and co-moments of the target Y and the
+ * control C, so the variance-optimal coefficient beta = Cov(Y, C) / Var(C) is available at any point.
+ */
+template <std::floating_point FloatType>
+class ControlVariateStats {
+public:
+	void add(FloatType y, FloatType c) {
+		m_count++;
+		const FloatType n {static_cast<FloatType>(m_count)};
+		const FloatType deltaY {y - m_meanY};
+		const FloatType deltaC {c - m_meanC};
+		m_meanY += deltaY / n;
+		m_meanC += deltaC / n;
+		m_m2Y += deltaY * (y - m_meanY);
+		m_m2C += deltaC * (c - m_meanC);
+		m_coMoment += deltaY * (c - m_meanC);
+	}
+
+	std::int64_t getCount() const {
+		return m_count;
+	}
+
+	FloatType getBeta() const {
+		return m_m2C > 0 ? m_coMoment / m_m2C : FloatType {0};
+	}
+
+	/**
+	 * @param expectedControl The known expectation of the control.
+	 * @return The control-variate corrected estimate of E[Y].
+	 */
+	FloatType getEstimate(FloatType expectedControl) const {
+		return m_meanY - getBeta() * (m_meanC - expectedControl);
+	}
+
+	/**
+	 * @return The per-sample variance of the plain estimator, Var(Y).
+	 */
+	FloatType getPlainVariance() const {
+		return m_count > 1 ? m_m2Y / static_cast<FloatType>(m_count - 1) : FloatType {0};
+	}
+
+	/**
+	 * @return The per-sample variance of the corrected estimator, Var(Y - beta * C).
+	 */
+	FloatType getVariance() const {
+		if (m_count <= 1) {
+			return FloatType {0};
+		}
+		const FloatType residual {m_m2C > 0 ? m_m2Y - m_coMoment * m_coMoment / m_m2C : m_m2Y};
+		return residual / static_cast<FloatType>(m_count - 1);
+	}
+
+private:
+	std::int64_t m_count {0};
+	FloatType m_meanY {0};
+	FloatType m_meanC {0};
+	FloatType m_m2Y {0};
+	FloatType m_m2C {0};
+	FloatType m_coMoment {0};
+};
+
+/**
+ * Autocorrelation of a sequence of samples up to a fixed lag, for sample sources whose consecutive
+ * samples share coordinates.  Sums are mergeable across threads (pairs straddling two threads'
+ * sequences are simply not counted).
+ */
+template <std::floating_point FloatType>
+class AutocorrelationStats {
+public:
+	explicit AutocorrelationStats(int maxLag = 0) :
+		m_history(maxLag),
+		m_lagProducts(maxLag),
+		m_lagSums(maxLag),
+		m_lagPairs(maxLag)
+	{}
+
+	void add(FloatType x) {
+		const int maxLag {getMaxLag()};
+		for (int k {0}; k < maxLag; k++) {
+			if (m_count > k) {
+				int index {m_position - 1 - k};
+				index += maxLag * (index < 0);
+				m_lagProducts[k] += x * m_history[index];
+				m_lagSums[k] += x + m_history[index];
+				m_lagPairs[k]++;
+			}
+		}
+		if (maxLag > 0) {
+			m_history[m_position] = x;
+			m_position++;
+			m_position -= maxLag * (m_position >= maxLag);
+		}
+		m_count++;
+		m_sum += x;
+		m_sumOfSquares += x * x;
+	}
+
+	/**
+	 * Starts over with the same maximum lag, keeping the buffers.
+	 */
+	void reset() {
+		std::fill(m_history.begin(), m_history.end(), FloatType {0});
+		std::fill(m_lagProducts.begin(), m_lagProducts.end(), FloatType {0});
+		std::fill(m_lagSums.begin(), m_lagSums.end(), FloatType {0});
+		std::fill(m_lagPairs.begin(), m_lagPairs.end(), 0);
+		m_position = 0;
+		m_count = 0;
+		m_sum = 0;
+		m_sumOfSquares = 0;
+	}
+
+	void merge(const AutocorrelationStats& other) {
+		for (int k {0}; k < getMaxLag() && k < other.getMaxLag(); k++) {
+			m_lagProducts[k] += other.m_lagProducts[k];
+			m_lagSums[k] += other.m_lagSums[k];
+			m_lagPairs[k] += other.m_lagPairs[k];
+		}
+		m_count += other.m_count;
+		m_sum += other.m_sum;
+		m_sumOfSquares += other.m_sumOfSquares;
+	}
+
+	int getMaxLag() const {
+		return static_cast<int>(m_history.size());
+	}
+
+	std::int64_t getCount() const {
+		return m_count;
+	}
+
+	/**
+	 * @param lag The lag, in [1, getMaxLag()].
+	 * @return The lag-k autocorrelation coefficient.
+	 */
+	FloatType getAutocorrelation(int lag) const {
+		const int k {lag - 1};
+		if (m_lagPairs[k] == 0 || m_count < 2) {
+			return FloatType {0};
+		}
+		const FloatType mean {m_sum / static_cast<FloatType>(m_count)};
+		const FloatType variance {m_sumOfSquares / static_cast<FloatType>(m_count) - mean * mean};
+		const FloatType pairs {static_cast<FloatType>(m_lagPairs[k])};
+		const FloatType covariance {m_lagProducts[k] / pairs - mean * m_lagSums[k] / pairs + mean * mean};
+		return variance > 0 ? covariance / variance : FloatType {0};
+	}
+
+	/**
+	 * @return The integrated autocorrelation time 1 + 2 * sum(rho_k); count / time is the
+	 *         effective number of independent samples.
+	 */
+	FloatType getIntegratedTime() const {
+		FloatType time {1};
+		for (int lag {1}; lag <= getMaxLag(); lag++) {
+			time += 2 * getAutocorrelation(lag);
+		}
+		return time;
+	}
+
+private:
+	std::vector<FloatType> m_history; // ring of the last maxLag samples
+	std::vector<FloatType> m_lagProducts;
+	std::vector<FloatType> m_lagSums;
+	std::vector<std::int64_t> m_lagPairs;
+	int m_position {0};
+	std::int64_t m_count {0};
+	FloatType m_sum {0};
+	FloatType m_sumOfSquares {0};
+};
+
+/**
+ * Per-thread summary of an estimator run, used by the harness to pool threads and report the
+ * variance reduction factor.
+ */
+struct EstimatorStats {
+	std::int64_t count {0};
+	double estimate {0};          // the estimator's value for E[ratio]
+	double plainVariance {0};     // per-sample variance of the raw ratio
+	double estimatorVariance {0}; // per-sample variance of the estimator, Var(estimate) * count
+
+	/**
+	 * Pools another run of the same estimator into this one (e.g. the next chunk of a simulation),
+	 * weighting the estimates and the per-sample variances by their counts.
+	 * @param other The statistics to pool in.
+	 */
+	void merge(const EstimatorStats& other) {
+		const std::int64_t total {count + other.count};
+		if (total == 0) {
+			return;
+		}
+		const double weight {static_cast<double>(other.count) / total};
+		estimate += (other.estimate - estimate) * weight;
+		plainVariance += (other.plainVariance - plainVariance) * weight;
+		estimatorVariance += (other.estimatorVariance - estimatorVariance) * weight;
+		count = total;
+	}
+};
+
+} // namespace simulation
+
+#endif // SIMULATION_ESTIMATORS_H
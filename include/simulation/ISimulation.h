@@ -3,6 +3,9 @@
 
 #include <cassert>
 #include <concepts>
+#include <memory_resource>
+
+#include "common/MemoryResource.h"
 
 namespace simulation {
 
@@ -30,6 +33,12 @@ public:
      * Runs a complete simulation.
      */
     virtual void run() = 0;
+
+	/**
+	 * Allocates and touches the buffers run() needs, so that allocation and page faults happen
+	 * before the timer starts.  Optional: run() must also work without it.
+	 */
+	virtual void prepare() {}
     
 	/**
 	 * Gets the average ratio of polygon area to bounding box area. Effectively, the result of the simulation.
@@ -61,9 +70,18 @@ public:
 		return m_polygonPointCount;
 	}
 
+	/**
+	 * Gets the memory resource the simulation's buffers come from: that of the constructing thread.
+	 * @return The memory resource.
+	 */
+	std::pmr::memory_resource* getMemoryResource() const {
+		return m_memoryResource;
+	}
+
 protected:
 	int m_runCount;
 	int m_polygonPointCount {};
+	std::pmr::memory_resource* m_memoryResource {ThreadMemoryResource::get()};
 };
 
 } // namespace simulation
@@ -0,0 +1,240 @@
+#ifndef SIMULATION_KERNELS_H
+#define SIMULATION_KERNELS_H
+
+#include <algorithm>
+#include <cmath>
+#include <concepts>
+#include <limits>
+#include <type_traits>
+
+namespace simulation {
+
+/**
+ * Arithmetic for the kernels on plain scalars.  The kernels below are written against this small
+ * interface so that the same code also runs on SIMD vectors, one polygon per lane (see Layouts.h).
+ */
+template <std::floating_point FloatType>
+struct ScalarOps {
+	using Scalar = FloatType;
+	using Vector = FloatType;
+
+	Vector load(const FloatType* p) const { return *p; }
+	Vector set(FloatType x) const { return x; }
+	Vector add(Vector a, Vector b) const { return a + b; }
+	Vector sub(Vector a, Vector b) const { return a - b; }
+	Vector mul(Vector a, Vector b) const { return a * b; }
+	Vector div(Vector a, Vector b) const { return a / b; }
+	Vector min(Vector a, Vector b) const { return std::min(a, b); }
+	Vector max(Vector a, Vector b) const { return std::max(a, b); }
+	Vector abs(Vector a) const { return std::abs(a); }
+	Vector mulSub(Vector a, Vector b, Vector c) const { return a * b - c; }
+};
+
+/*
+ * Kernel policies: the area ratio of one polygon.  Vertex i is at (xs[i * step], ys[i * step]), which
+ * covers interleaved points (step 2), separate x and y rows (step 1) and vertex-major columns (step =
+ * number of polygons).  supports() tells which polygons a kernel handles, dimension() how many
+ * coordinates it consumes per sample.
+ */
+
+/**
+ * Shoelace area and min/max bounding box, for any polygon.
+ */
+struct ShoelaceKernel {
+	static constexpr bool supports(int pointCount) {
+		return pointCount >= 3;
+	}
+
+	static constexpr int dimension(int pointCount) {
+		return 2 * pointCount;
+	}
+
+	template <typename Ops>
+	static typename Ops::Vector evaluate(const Ops& ops, const typename Ops::Scalar* xs, const typename Ops::Scalar* ys, int step, int pointCount) {
+		auto prevX = ops.load(xs + (pointCount - 1) * step);
+		auto prevY = ops.load(ys + (pointCount - 1) * step);
+		auto area = ops.set(0);
+		auto bottomLeftX = prevX;
+		auto bottomLeftY = prevY;
+		auto topRightX = prevX;
+		auto topRightY = prevY;
+		for (int i {0}; i < pointCount; i++) {
+			const auto currX = ops.load(xs + i * step);
+			const auto currY = ops.load(ys + i * step);
+			area = ops.add(area, ops.mulSub(prevX, currY, ops.mul(currX, prevY)));
+
+			bottomLeftX = ops.min(bottomLeftX, currX);
+			bottomLeftY = ops.min(bottomLeftY, currY);
+			topRightX = ops.max(topRightX, currX);
+			topRightY = ops.max(topRightY, currY);
+
+			prevX = currX;
+			prevY = currY;
+		}
+		const auto boundingBoxArea = ops.mul(ops.sub(topRightX, bottomLeftX), ops.sub(topRightY, bottomLeftY));
+		return ops.div(ops.mul(ops.abs(area), ops.set(0.5)), boundingBoxArea);
+	}
+};
+
+/**
+ * Closed-form area and extents of a triangle, from SimulationEugene4.
+ */
+struct TriangleKernel {
+	static constexpr bool supports(int pointCount) {
+		return pointCount == 3;
+	}
+
+	static constexpr int dimension(int) {
+		return 6;
+	}
+
+	template <typename Ops>
+	static typename Ops::Vector evaluate(const Ops& ops, const typename Ops::Scalar* xs, const typename Ops::Scalar* ys, int step, int) {
+		const auto aX = ops.load(xs);
+		const auto aY = ops.load(ys);
+		const auto bX = ops.load(xs + step);
+		const auto bY = ops.load(ys + step);
+		const auto cX = ops.load(xs + 2 * step);
+		const auto cY = ops.load(ys + 2 * step);
+
+		const auto doubleArea = ops.add(ops.add(ops.mul(aX, ops.sub(bY, cY)), ops.mul(bX, ops.sub(cY, aY))), ops.mul(cX, ops.sub(aY, bY)));
+		const auto width = ops.max(ops.abs(ops.sub(aX, bX)), ops.max(ops.abs(ops.sub(aX, cX)), ops.abs(ops.sub(bX, cX))));
+		const auto height = ops.max(ops.abs(ops.sub(aY, bY)), ops.max(ops.abs(ops.sub(aY, cY)), ops.abs(ops.sub(bY, cY))));
+		return ops.div(ops.mul(ops.abs(doubleArea), ops.set(0.5)), ops.mul(width, height));
+	}
+};
+
+/**
+ * The triangle kernel for triangles, the shoelace kernel for everything else.
+ */
+struct PolygonKernel {
+	static constexpr bool supports(int pointCount) {
+		return pointCount >= 3;
+	}
+
+	static constexpr int dimension(int pointCount) {
+		return 2 * pointCount;
+	}
+
+	template <typename Ops>
+	static typename Ops::Vector evaluate(const Ops& ops, const typename Ops::Scalar* xs, const typename Ops::Scalar* ys, int step, int pointCount) {
+		return pointCount == 3 ? TriangleKernel::evaluate(ops, xs, ys, step, pointCount) : ShoelaceKernel::evaluate(ops, xs, ys, step, pointCount);
+	}
+};
+
+/**
+ * Ratio of a triangle's area to the area of its axis-aligned bounding box.
+ * Uses the closed-form area and extents from SimulationEugene4.
+ * @param coords Interleaved vertex coordinates {aX, aY, bX, bY, cX, cY}.
+ * @return The area ratio.
+ */
+template <std::floating_point FloatType>
+inline FloatType triangleRatio(const FloatType* coords) {
+	return TriangleKernel::evaluate(ScalarOps<FloatType> {}, coords, coords + 1, 2, 3);
+}
+
+/**
+ * Ratio of a polygon's area (shoelace formula) to the area of its axis-aligned bounding box.
+ * @param coords Interleaved vertex coordinates {x0, y0, x1, y1, ...}.
+ * @param pointCount Number of vertices.
+ * @return The area ratio.
+ */
+template <std::floating_point FloatType>
+inline FloatType polygonRatio(const FloatType* coords, int pointCount) {
+	return ShoelaceKernel::evaluate(ScalarOps<FloatType> {}, coords, coords + 1, 2, pointCount);
+}
+
+/**
+ * Expected triangle-to-bounding-box ratio given two vertices, with the third vertex uniform on
+ * [1, 2] x [1, 2] and integrated out in closed form (conditional Monte Carlo).
+ *
+ * Reflecting y if needed, A and B are the bottom-left and top-right corners of their w x h box.
+ * Around that box the square splits into 9 regions in which the bounding box extents are affine
+ * in the third vertex C.  With s, t the extents of the enlarged box, the ratio is |a - b|/2 inside
+ * (a, b the normalized position of C), 1/2 - w*t/(2*h*s) beside an edge and 1/2 * |w/s - h/t| in
+ * a corner.  Each region integrates to logarithms; only the two corners on the diagonal through
+ * A and B need the |.| split.
+ * @param coords Interleaved coordinates of the two sampled vertices {aX, aY, bX, bY}.
+ * @return E[ratio | A, B].
+ */
+template <std::floating_point FloatType>
+inline FloatType conditionalTriangleRatio(const FloatType* coords) {
+	// work in the unit square
+	const FloatType aX {coords[0] - static_cast<FloatType>(1.0)};
+	FloatType aY {coords[1] - static_cast<FloatType>(1.0)};
+	const FloatType bX {coords[2] - static_cast<FloatType>(1.0)};
+	FloatType bY {coords[3] - static_cast<FloatType>(1.0)};
+	if ((bX - aX) * (bY - aY) < 0) {
+		aY = static_cast<FloatType>(1.0) - aY;
+		bY = static_cast<FloatType>(1.0) - bY;
+	}
+	const FloatType x0 {std::min(aX, bX)};
+	const FloatType x1 {std::max(aX, bX)};
+	const FloatType y0 {std::min(aY, bY)};
+	const FloatType y1 {std::max(aY, bY)};
+	// a zero-width box has probability zero, but keep the logarithms finite
+	const FloatType w {std::max(x1 - x0, std::numeric_limits<FloatType>::min())};
+	const FloatType h {std::max(y1 - y0, std::numeric_limits<FloatType>::min())};
+	const FloatType half {static_cast<FloatType>(0.5)};
+
+	// only four distinct logarithms occur: the extents of the square beyond A and B relative to w and h
+	const FloatType one {static_cast<FloatType>(1.0)};
+	const FloatType logRight {std::log((one - x0) / w)};
+	const FloatType logLeft {std::log(x1 / w)};
+	const FloatType logUp {std::log((one - y0) / h)};
+	const FloatType logDown {std::log(y1 / h)};
+
+	// third vertex beside the box: extension up to `extent` along the axis of size a, b the other axis
+	const auto edge = [half](FloatType a, FloatType b, FloatType extent, FloatType logExtent) {
+		return half * b * (extent - a) - half * half * a * b * logExtent;
+	};
+	// off-diagonal corners, where the ratio is 1/2 * (h/v + w/s - w*h/(s*v)) everywhere
+	const auto offDiagonalCorner = [half, w, h](FloatType s, FloatType v, FloatType logS, FloatType logV) {
+		return half * (h * (s - w) * logV + w * (v - h) * logS - w * h * logS * logV);
+	};
+	// diagonal corners: 1/2 * |w/s - h/t| over [w, s] x [h, t], split along t = (h/w) * s
+	const auto diagonalCorner = [half, w, h](FloatType s, FloatType t, FloatType logS, FloatType logT) {
+		const FloatType signedIntegral {w * (t - h) * logS - h * (s - w) * logT};
+		const FloatType sCross {t * w / h}; // where the dividing line leaves through the top, log(sCross / w) == logT
+		FloatType below {};
+		if (sCross < s) {
+			below = 2 * h * (sCross - w) - w * h * logT - h * sCross * logT
+				+ w * (t - h) * (logS - logT) - h * logT * (s - sCross);
+		} else {
+			below = 2 * h * (s - w) - w * h * logS - h * s * logS;
+		}
+		return half * (signedIntegral - 2 * below);
+	};
+
+	return w * h / static_cast<FloatType>(6.0)
+		+ edge(w, h, one - x0, logRight) + edge(w, h, x1, logLeft)
+		+ edge(h, w, one - y0, logUp) + edge(h, w, y1, logDown)
+		+ offDiagonalCorner(one - x0, y1, logRight, logDown) + offDiagonalCorner(x1, one - y0, logLeft, logUp)
+		+ diagonalCorner(one - x0, one - y0, logRight, logUp) + diagonalCorner(x1, y1, logLeft, logDown);
+}
+
+/**
+ * Conditional Monte Carlo for triangles: consumes two vertices and integrates the third out with
+ * conditionalTriangleRatio().  Scalar only, the logarithms have no SIMD counterpart here.
+ */
+struct ConditionalTriangleKernel {
+	static constexpr bool supports(int pointCount) {
+		return pointCount == 3;
+	}
+
+	static constexpr int dimension(int) {
+		return 4;
+	}
+
+	template <typename Ops>
+	static typename Ops::Vector evaluate(const Ops&, const typename Ops::Scalar* xs, const typename Ops::Scalar* ys, int step, int) {
+		using FloatType = typename Ops::Scalar;
+		static_assert(std::is_same_v<Ops, ScalarOps<FloatType>>, "The conditional kernel is scalar only.");
+		const FloatType coords[] {xs[0], ys[0], xs[step], ys[step]};
+		return conditionalTriangleRatio(coords);
+	}
+};
+
+} // namespace simulation
+
+#endif // SIMULATION_KERNELS_H
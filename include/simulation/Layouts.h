@@ -0,0 +1,412 @@
+#ifndef SIMULATION_LAYOUTS_H
+#define SIMULATION_LAYOUTS_H
+
+#include <algorithm>
+#include <array>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+#include <vector>
+
+#include "common/PhaseProfiler.h"
+#include "simulation/Kernels.h"
+#include "hwy/highway.h"
+
+namespace simulation {
+
+/*
+ * Layout policies: how a Simulation arranges the points it pulls from its sample source before the
+ * kernel sees them, and how the kernel is applied (one polygon at a time or one per SIMD lane).
+ *
+ * Every layout provides
+ *   a constructor taking the memory resource its buffers come from,
+ *   makeSource<Source>(dimension)        the source a Simulation builds when it is not given one,
+ *   prepare(runCount, dimension)         allocating and touching its buffers, so that run() allocates nothing,
+ *   run<Kernel>(source, accumulator, runCount, pointCount).
+ */
+
+// ratios a layout buffers before handing them to an accumulator that takes batches
+constexpr int kRatioBatch {256};
+
+/**
+ * Hands a layout's ratios to an accumulator: in buffers of kRatioBatch if it takes batches, one by
+ * one if it wants every sample otherwise, and else summed locally and handed over once.
+ */
+template <std::floating_point FloatType, typename Accumulator>
+class RatioCollector {
+public:
+	static constexpr bool kBatched {Accumulator::kPerSample
+		&& requires(Accumulator& accumulator, const FloatType* ratios) { accumulator.addBatch(ratios, 0); }};
+
+	explicit RatioCollector(Accumulator& accumulator) :
+		m_accumulator {accumulator}
+	{}
+
+	void add(FloatType ratio) {
+		if constexpr (kBatched) {
+			m_ratios[m_count++] = ratio;
+			if (m_count == kRatioBatch) {
+				handOver();
+			}
+		} else if constexpr (Accumulator::kPerSample) {
+			m_accumulator.add(ratio);
+		} else {
+			m_sum += ratio;
+		}
+	}
+
+	void flush(std::int64_t count) {
+		if constexpr (kBatched) {
+			if (m_count > 0) {
+				handOver();
+			}
+		} else if constexpr (!Accumulator::kPerSample) {
+			PROFILE_PHASE("reduce");
+			m_accumulator.addSum(m_sum, count);
+			m_sum = 0;
+		}
+	}
+
+private:
+	// Out of line so that add() stays small enough to inline into the layouts' loops: a call there
+	// on every ratio would spill the sample window, since every vector register is caller-saved.
+	[[gnu::noinline]] void handOver() {
+		m_accumulator.addBatch(m_ratios.data(), m_count);
+		m_count = 0;
+	}
+
+	Accumulator& m_accumulator;
+	FloatType m_sum {0};
+	// filled before it is read, not worth zeroing per run
+	std::array<FloatType, kBatched ? kRatioBatch : 0> m_ratios;
+	int m_count {0};
+};
+
+/**
+ * One point at a time, straight from the source (Adrian1, Eugene1).
+ */
+template <std::floating_point FloatType>
+class PerSampleLayout {
+public:
+	explicit PerSampleLayout(std::pmr::memory_resource* = std::pmr::get_default_resource()) {}
+
+	template <typename Source>
+	static Source makeSource(int dimension) {
+		return Source {dimension};
+	}
+
+	void prepare(int, int) {}
+
+	template <typename Kernel, typename Source, typename Accumulator>
+	void run(Source& source, Accumulator& accumulator, int runCount, int pointCount) {
+		const ScalarOps<FloatType> ops {};
+		RatioCollector<FloatType, Accumulator> collector {accumulator};
+		{
+			// the source's "rng" phase nests inside
+			PROFILE_PHASE("kernel");
+			for (int r {0}; r < runCount; ++r) {
+				const FloatType* coords {source.next()};
+				collector.add(Kernel::evaluate(ops, coords, coords + 1, 2, pointCount));
+			}
+		}
+		collector.flush(runCount);
+	}
+};
+
+/**
+ * A window of Dimension coordinates slid one coordinate per polygon through locals, for sources that
+ * hand out their stream with draw() (Eugene4): once the kernel is inlined the window lives in
+ * registers and every polygon costs one draw and a register shuffle, with no loads or stores.
+ */
+template <std::floating_point FloatType, int Dimension>
+class RegisterWindowLayout {
+public:
+	explicit RegisterWindowLayout(std::pmr::memory_resource* = std::pmr::get_default_resource()) {}
+
+	template <typename Source>
+	static Source makeSource(int dimension) {
+		return Source {dimension};
+	}
+
+	void prepare(int, int) {}
+
+	template <typename Kernel, typename Source, typename Accumulator>
+	void run(Source& source, Accumulator& accumulator, int runCount, int pointCount) {
+		const ScalarOps<FloatType> ops {};
+		RatioCollector<FloatType, Accumulator> collector {accumulator};
+		std::array<FloatType, Dimension> window;
+		for (auto& coord : window) {
+			coord = source.draw();
+		}
+		{
+			PROFILE_PHASE("kernel");
+			for (int r {0}; r < runCount; ++r) {
+				collector.add(Kernel::evaluate(ops, window.data(), window.data() + 1, 2, pointCount));
+				for (int i {0}; i + 1 < Dimension; i++) {
+					window[i] = window[i + 1];
+				}
+				window[Dimension - 1] = source.draw();
+			}
+		}
+		collector.flush(runCount);
+	}
+};
+
+/**
+ * All points of a run drawn up front into separate x and y rows, polygon after polygon (Eugene2):
+ * vertex p of polygon r is at index r * vertices + p.
+ */
+template <std::floating_point FloatType>
+class RowLayout {
+public:
+	explicit RowLayout(std::pmr::memory_resource* memory = std::pmr::get_default_resource()) :
+		m_xs(memory),
+		m_ys(memory)
+	{}
+
+	template <typename Source>
+	static Source makeSource(int dimension) {
+		return Source {dimension};
+	}
+
+	void prepare(int runCount, int dimension) {
+		// value-initialization writes every page
+		m_xs.resize(static_cast<std::size_t>(runCount) * (dimension / 2));
+		m_ys.resize(static_cast<std::size_t>(runCount) * (dimension / 2));
+	}
+
+	template <typename Kernel, typename Source, typename Accumulator>
+	void run(Source& source, Accumulator& accumulator, int runCount, int pointCount) {
+		const int vertices {source.dimension() / 2};
+		prepare(runCount, source.dimension());
+		{
+			PROFILE_PHASE("fill");
+			for (int r {0}; r < runCount; ++r) {
+				const FloatType* coords {source.next()};
+				for (int p {0}; p < vertices; p++) {
+					m_xs[static_cast<std::size_t>(r) * vertices + p] = coords[2 * p];
+					m_ys[static_cast<std::size_t>(r) * vertices + p] = coords[2 * p + 1];
+				}
+			}
+		}
+
+		const ScalarOps<FloatType> ops {};
+		RatioCollector<FloatType, Accumulator> collector {accumulator};
+		{
+			PROFILE_PHASE("kernel");
+			for (int r {0}; r < runCount; ++r) {
+				const std::size_t offset {static_cast<std::size_t>(r) * vertices};
+				collector.add(Kernel::evaluate(ops, m_xs.data() + offset, m_ys.data() + offset, 1, pointCount));
+			}
+		}
+		collector.flush(runCount);
+	}
+
+private:
+	std::pmr::vector<FloatType> m_xs;
+	std::pmr::vector<FloatType> m_ys;
+};
+
+/**
+ * All points of a run drawn up front into vertex-major columns (Eugene3): vertex p of polygon r is
+ * at index p * runCount + r, so the kernel walks every column with unit stride across polygons.
+ */
+template <std::floating_point FloatType>
+class ColumnLayout {
+public:
+	explicit ColumnLayout(std::pmr::memory_resource* memory = std::pmr::get_default_resource()) :
+		m_xs(memory),
+		m_ys(memory)
+	{}
+
+	template <typename Source>
+	static Source makeSource(int dimension) {
+		return Source {dimension};
+	}
+
+	void prepare(int runCount, int dimension) {
+		// value-initialization writes every page
+		m_xs.resize(static_cast<std::size_t>(runCount) * (dimension / 2));
+		m_ys.resize(static_cast<std::size_t>(runCount) * (dimension / 2));
+	}
+
+	template <typename Kernel, typename Source, typename Accumulator>
+	void run(Source& source, Accumulator& accumulator, int runCount, int pointCount) {
+		const int vertices {source.dimension() / 2};
+		prepare(runCount, source.dimension());
+		{
+			PROFILE_PHASE("fill");
+			for (int r {0}; r < runCount; ++r) {
+				const FloatType* coords {source.next()};
+				for (int p {0}; p < vertices; p++) {
+					m_xs[static_cast<std::size_t>(p) * runCount + r] = coords[2 * p];
+					m_ys[static_cast<std::size_t>(p) * runCount + r] = coords[2 * p + 1];
+				}
+			}
+		}
+
+		const ScalarOps<FloatType> ops {};
+		RatioCollector<FloatType, Accumulator> collector {accumulator};
+		{
+			PROFILE_PHASE("kernel");
+			for (int r {0}; r < runCount; ++r) {
+				collector.add(Kernel::evaluate(ops, m_xs.data() + r, m_ys.data() + r, runCount, pointCount));
+			}
+		}
+		collector.flush(runCount);
+	}
+
+private:
+	std::pmr::vector<FloatType> m_xs;
+	std::pmr::vector<FloatType> m_ys;
+};
+
+/**
+ * Kernel arithmetic on Highway vectors, lane j holding the polygon whose coordinates start at
+ * offset j * stride of the loaded address (consecutive sliding windows).
+ */
+template <class D, bool Contiguous>
+struct HighwayOps {
+	using Scalar = hwy::HWY_NAMESPACE::TFromD<D>;
+	using IndexTag = hwy::HWY_NAMESPACE::RebindToSigned<D>;
+	using Vector = decltype(hwy::HWY_NAMESPACE::Zero(D {}));
+	using IndexVector = decltype(hwy::HWY_NAMESPACE::Zero(IndexTag {}));
+
+	D d;
+	IndexVector laneOffsets;
+
+	Vector load(const Scalar* p) const {
+		if constexpr (Contiguous) {
+			return hwy::HWY_NAMESPACE::LoadU(d, p);
+		} else {
+			return hwy::HWY_NAMESPACE::GatherIndex(d, p, laneOffsets);
+		}
+	}
+	Vector set(Scalar x) const { return hwy::HWY_NAMESPACE::Set(d, x); }
+	Vector add(Vector a, Vector b) const { return hwy::HWY_NAMESPACE::Add(a, b); }
+	Vector sub(Vector a, Vector b) const { return hwy::HWY_NAMESPACE::Sub(a, b); }
+	Vector mul(Vector a, Vector b) const { return hwy::HWY_NAMESPACE::Mul(a, b); }
+	Vector div(Vector a, Vector b) const { return hwy::HWY_NAMESPACE::Div(a, b); }
+	Vector min(Vector a, Vector b) const { return hwy::HWY_NAMESPACE::Min(a, b); }
+	Vector max(Vector a, Vector b) const { return hwy::HWY_NAMESPACE::Max(a, b); }
+	Vector abs(Vector a) const { return hwy::HWY_NAMESPACE::Abs(a); }
+	Vector mulSub(Vector a, Vector b, Vector c) const { return hwy::HWY_NAMESPACE::MulSub(a, b, c); }
+};
+
+/**
+ * Consecutive windows of a SlidingWindowSampleSource side by side, one per SIMD lane (Eugene5).
+ * The source must hand out blocks of lanes() windows; the polygons left over after the last whole
+ * block are evaluated one by one.
+ */
+template <std::floating_point FloatType>
+class SimdLaneLayout {
+public:
+	static int lanes() {
+		return static_cast<int>(hwy::HWY_NAMESPACE::Lanes(hwy::HWY_NAMESPACE::ScalableTag<FloatType> {}));
+	}
+
+	explicit SimdLaneLayout(std::pmr::memory_resource* memory = std::pmr::get_default_resource()) :
+		m_laneOffsets(memory),
+		m_laneRatios(memory)
+	{}
+
+	template <typename Source>
+	static Source makeSource(int dimension) {
+		return Source {dimension, 1, lanes()};
+	}
+
+	void prepare(int, int) {
+		m_laneOffsets.resize(lanes());
+		// whole blocks, at least one
+		m_laneRatios.resize(std::max(1, kRatioBatch / lanes()) * lanes());
+	}
+
+	template <typename Kernel, typename Source, typename Accumulator>
+	void run(Source& source, Accumulator& accumulator, int runCount, int pointCount) {
+		prepare(runCount, source.dimension());
+		if (source.stride() == 1) {
+			runLanes<Kernel, true>(source, accumulator, runCount, pointCount);
+		} else {
+			runLanes<Kernel, false>(source, accumulator, runCount, pointCount);
+		}
+	}
+
+private:
+	using IndexType = hwy::HWY_NAMESPACE::TFromD<hwy::HWY_NAMESPACE::RebindToSigned<hwy::HWY_NAMESPACE::ScalableTag<FloatType>>>;
+
+	// per-lane scratch and the ratios of the blocks not yet handed over, kept across runs
+	std::pmr::vector<IndexType> m_laneOffsets;
+	std::pmr::vector<FloatType> m_laneRatios;
+
+	template <typename Kernel, bool Contiguous, typename Source, typename Accumulator>
+	void runLanes(Source& source, Accumulator& accumulator, int runCount, int pointCount) {
+		namespace hn = hwy::HWY_NAMESPACE;
+		using D = hn::ScalableTag<FloatType>;
+		using Ops = HighwayOps<D, Contiguous>;
+		const D d;
+		const typename Ops::IndexTag di;
+		const int lanes {static_cast<int>(hn::Lanes(d))};
+		const int stride {source.stride()};
+
+		// lane j evaluates the window starting j * stride coordinates into the block
+		for (int j {0}; j < lanes; j++) {
+			m_laneOffsets[j] = static_cast<IndexType>(j * stride);
+		}
+		const Ops ops {d, hn::LoadU(di, m_laneOffsets.data())};
+
+		auto vRatioSum = hn::Zero(d);
+		const int blockCount {runCount / lanes};
+		const int batchSize {static_cast<int>(m_laneRatios.size())};
+		int buffered {0};
+		{
+			PROFILE_PHASE("kernel");
+			for (int b {0}; b < blockCount; ++b) {
+				const FloatType* block {source.next()};
+				const auto ratio = Kernel::evaluate(ops, block, block + 1, 2, pointCount);
+				if constexpr (RatioCollector<FloatType, Accumulator>::kBatched) {
+					hn::StoreU(ratio, d, m_laneRatios.data() + buffered);
+					buffered += lanes;
+					if (buffered == batchSize) {
+						accumulator.addBatch(m_laneRatios.data(), buffered);
+						buffered = 0;
+					}
+				} else if constexpr (Accumulator::kPerSample) {
+					hn::StoreU(ratio, d, m_laneRatios.data());
+					for (int j {0}; j < lanes; j++) {
+						accumulator.add(m_laneRatios[j]);
+					}
+				} else {
+					vRatioSum = hn::Add(vRatioSum, ratio);
+				}
+			}
+		}
+		if constexpr (RatioCollector<FloatType, Accumulator>::kBatched) {
+			if (buffered > 0) {
+				accumulator.addBatch(m_laneRatios.data(), buffered);
+			}
+		} else if constexpr (!Accumulator::kPerSample) {
+			PROFILE_PHASE("reduce");
+			accumulator.addSum(hn::GetLane(hn::SumOfLanes(d, vRatioSum)), static_cast<std::int64_t>(blockCount) * lanes);
+		}
+
+		// remaining polygons, fewer than one block
+		const int remaining {runCount - blockCount * lanes};
+		if (remaining > 0) {
+			const FloatType* block {source.next()};
+			const ScalarOps<FloatType> scalarOps {};
+			RatioCollector<FloatType, Accumulator> collector {accumulator};
+			{
+				PROFILE_PHASE("kernel");
+				for (int j {0}; j < remaining; j++) {
+					collector.add(Kernel::evaluate(scalarOps, block + j * stride, block + j * stride + 1, 2, pointCount));
+				}
+			}
+			collector.flush(remaining);
+		}
+	}
+};
+
+} // namespace simulation
+
+#endif // SIMULATION_LAYOUTS_H
@@ -0,0 +1,177 @@
+#ifndef SIMULATION_PARALLELBACKENDS_H
+#define SIMULATION_PARALLELBACKENDS_H
+
+#include <algorithm>
+#include <array>
+#include <concepts>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <numeric>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef SIM_PARALLEL_STL
+#include <execution>
+#if __has_include(<tbb/global_control.h>)
+#include <tbb/global_control.h>
+#endif
+#endif
+
+#include "common/Concurrency.h"
+#include "simulation/Kernels.h"
+#include "simulation/PhiloxEngine.h"
+
+namespace simulation {
+
+/*
+ * Execution backends for the plain Monte Carlo estimate (uniform vertices on [1, 2], the polygon
+ * kernel), to compare parallel runtimes on one sample loop: every run draws its vertices from its
+ * own Philox stream, keyed by the run's index, so the loop carries no state between runs and the
+ * samples do not depend on the backend, the thread count or the schedule.  Only the order of the
+ * summation does.
+ *
+ * - Threads: std::threads, each pinned and given a contiguous range, like the harness's workers.
+ * - ParallelStl: std::transform_reduce(std::execution::par_unseq) over blocks of runs, which
+ *   libstdc++ runs on TBB.  Needs SIM_PARALLEL_STL and TBB (bazel --config=pstl).
+ * - OpenMp: `omp parallel for simd reduction` over the runs.  Needs -fopenmp (bazel --config=openmp).
+ */
+
+enum class ParallelBackend { Threads, ParallelStl, OpenMp };
+
+// the vertices of a run live on the stack
+constexpr int kMaxBackendPoints {64};
+// runs per task of the parallel STL: enough to amortise the scheduling, many more tasks than threads
+constexpr std::int64_t kBackendBlockRuns {4096};
+
+/**
+ * @param name "threads", "pstl" or "openmp".
+ * @return The backend, or std::nullopt if the name is unknown.
+ */
+inline std::optional<ParallelBackend> parseParallelBackend(const std::string& name) {
+	if (name == "threads") {
+		return ParallelBackend::Threads;
+	} else if (name == "pstl") {
+		return ParallelBackend::ParallelStl;
+	} else if (name == "openmp") {
+		return ParallelBackend::OpenMp;
+	}
+	return std::nullopt;
+}
+
+/**
+ * @return Empty if the backend is compiled in, otherwise what the build needs for it.
+ */
+inline std::string getParallelBackendError(ParallelBackend backend) {
+	switch (backend) {
+		case ParallelBackend::Threads:
+			return "";
+		case ParallelBackend::ParallelStl:
+#ifdef SIM_PARALLEL_STL
+			return "";
+#else
+			return "built without the parallel STL, build with --config=pstl";
+#endif
+		case ParallelBackend::OpenMp:
+#ifdef _OPENMP
+			return "";
+#else
+			return "built without OpenMP, build with --config=openmp";
+#endif
+	}
+	return "unknown backend";
+}
+
+/**
+ * @return The area ratio of run `run`, from the Philox stream (seed, run): one block per vertex.
+ */
+template <std::floating_point FloatType>
+FloatType evaluateCounterRun(std::uint64_t seed, std::uint64_t run, int pointCount) {
+	// also tells the compiler that every vertex the kernel reads was written
+	if (pointCount < 3 || pointCount > kMaxBackendPoints) {
+		return std::numeric_limits<FloatType>::quiet_NaN();
+	}
+	std::array<FloatType, kMaxBackendPoints> xs;
+	std::array<FloatType, kMaxBackendPoints> ys;
+	for (int i {0}; i < pointCount; i++) {
+		const PhiloxEngine::Block words {PhiloxEngine::block(static_cast<std::uint64_t>(i), run, seed)};
+		xs[i] = 1 + PhiloxEngine::toUnit<FloatType>(words[0], words[1]);
+		ys[i] = 1 + PhiloxEngine::toUnit<FloatType>(words[2], words[3]);
+	}
+	return PolygonKernel::evaluate(ScalarOps<FloatType> {}, xs.data(), ys.data(), 1, pointCount);
+}
+
+/**
+ * @return The sum of the ratios of runs [begin, end).
+ */
+template <std::floating_point FloatType>
+double sumCounterRuns(std::uint64_t seed, std::int64_t begin, std::int64_t end, int pointCount) {
+	double sum {0};
+	for (std::int64_t run {begin}; run < end; run++) {
+		sum += evaluateCounterRun<FloatType>(seed, static_cast<std::uint64_t>(run), pointCount);
+	}
+	return sum;
+}
+
+/**
+ * Runs the counter-based sample loop on a backend.  The backend must be compiled in
+ * (getParallelBackendError()); one that is not runs the loop serially.
+ * @param threads Threads to use; the runtimes of ParallelStl and OpenMp place them themselves.
+ * @param cpus For Threads, the CPUs to pin the threads to, in order; empty to leave them unpinned.
+ * @return The sum of the ratios of runs [0, runs).
+ */
+template <std::floating_point FloatType>
+double sumRatios(ParallelBackend backend, std::int64_t runs, int pointCount, std::uint64_t seed, int threads,
+		const std::vector<int>& cpus = {}) {
+	threads = std::max(1, threads);
+	switch (backend) {
+		case ParallelBackend::Threads: {
+			std::vector<double> sums(static_cast<std::size_t>(threads), 0.0);
+			std::vector<std::thread> workers {};
+			for (int t {0}; t < threads; t++) {
+				workers.emplace_back([&, t] {
+					if (!cpus.empty()) {
+						Concurrency::pin_to_core(cpus[t % cpus.size()]);
+					}
+					sums[t] = sumCounterRuns<FloatType>(seed, runs * t / threads, runs * (t + 1) / threads, pointCount);
+				});
+			}
+			for (auto& worker : workers) {
+				worker.join();
+			}
+			return std::accumulate(sums.begin(), sums.end(), 0.0);
+		}
+		case ParallelBackend::ParallelStl: {
+			std::vector<std::int64_t> blocks(static_cast<std::size_t>((runs + kBackendBlockRuns - 1) / kBackendBlockRuns));
+			std::iota(blocks.begin(), blocks.end(), std::int64_t {0});
+			auto sumBlock = [seed, runs, pointCount](std::int64_t block) {
+				return sumCounterRuns<FloatType>(seed, block * kBackendBlockRuns, std::min(runs, (block + 1) * kBackendBlockRuns), pointCount);
+			};
+#ifdef SIM_PARALLEL_STL
+#if __has_include(<tbb/global_control.h>)
+			tbb::global_control parallelism {tbb::global_control::max_allowed_parallelism, static_cast<std::size_t>(threads)};
+#endif
+			return std::transform_reduce(std::execution::par_unseq, blocks.begin(), blocks.end(), 0.0, std::plus<> {}, sumBlock);
+#else
+			return std::transform_reduce(blocks.begin(), blocks.end(), 0.0, std::plus<> {}, sumBlock);
+#endif
+		}
+		case ParallelBackend::OpenMp: {
+			double sum {0};
+#ifdef _OPENMP
+			#pragma omp parallel for simd reduction(+ : sum) num_threads(threads) schedule(static)
+#endif
+			for (std::int64_t run = 0; run < runs; run++) {
+				sum += evaluateCounterRun<FloatType>(seed, static_cast<std::uint64_t>(run), pointCount);
+			}
+			return sum;
+		}
+	}
+	return 0;
+}
+
+} // namespace simulation
+
+#endif // SIMULATION_PARALLELBACKENDS_H
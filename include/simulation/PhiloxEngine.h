@@ -0,0 +1,99 @@
+#ifndef SIMULATION_PHILOXENGINE_H
+#define SIMULATION_PHILOXENGINE_H
+
+#include <array>
+#include <concepts>
+#include <cstdint>
+#include <limits>
+
+#include "simulation/SeedSource.h"
+
+namespace simulation {
+
+/**
+ * Philox4x32-10 (Salmon et al., "Parallel random numbers: as easy as 1, 2, 3", SC 2011), a
+ * counter-based generator: block(counter, key) is a keyed bijection of a 128-bit counter, so any
+ * draw can be computed from its position alone.  A parallel loop can then give every iteration its
+ * own stream, keyed by the iteration, and draw the same numbers whichever thread runs it, with no
+ * state shared or carried between iterations.
+ *
+ * As an engine it walks the counter of one stream, four words per block, so it can also stand in
+ * for std::mt19937 in the sample sources.
+ */
+class PhiloxEngine {
+public:
+	using result_type = std::uint32_t;
+	using Block = std::array<std::uint32_t, 4>;
+
+	/**
+	 * @param key Seed, by default from the thread's seed source (SeedSource.h).
+	 * @param stream Which stream of the key: the high half of the counter.
+	 */
+	explicit PhiloxEngine(std::uint64_t key = drawSeed(), std::uint64_t stream = 0) :
+		m_key {key},
+		m_stream {stream}
+	{}
+
+	static constexpr result_type min() {
+		return 0;
+	}
+
+	static constexpr result_type max() {
+		return std::numeric_limits<result_type>::max();
+	}
+
+	result_type operator()() {
+		if (m_index == 4) {
+			m_block = block(m_position++, m_stream, m_key);
+			m_index = 0;
+		}
+		return m_block[m_index++];
+	}
+
+	/**
+	 * @param position Low half of the counter, the block within the stream.
+	 * @param stream High half of the counter.
+	 * @return The four words of the block.
+	 */
+	static Block block(std::uint64_t position, std::uint64_t stream, std::uint64_t key) {
+		Block counter {static_cast<std::uint32_t>(position), static_cast<std::uint32_t>(position >> 32),
+			static_cast<std::uint32_t>(stream), static_cast<std::uint32_t>(stream >> 32)};
+		std::uint32_t key0 {static_cast<std::uint32_t>(key)};
+		std::uint32_t key1 {static_cast<std::uint32_t>(key >> 32)};
+		for (int round {0}; round < 10; round++) {
+			const std::uint64_t product0 {std::uint64_t {kMultiplier0} * counter[0]};
+			const std::uint64_t product1 {std::uint64_t {kMultiplier1} * counter[2]};
+			counter = {static_cast<std::uint32_t>(product1 >> 32) ^ counter[1] ^ key0, static_cast<std::uint32_t>(product1),
+				static_cast<std::uint32_t>(product0 >> 32) ^ counter[3] ^ key1, static_cast<std::uint32_t>(product0)};
+			key0 += kWeyl0;
+			key1 += kWeyl1;
+		}
+		return counter;
+	}
+
+	/**
+	 * @return A uniform draw on [0, 1) from two words, with the precision of the type.
+	 */
+	template <std::floating_point FloatType>
+	static FloatType toUnit(std::uint32_t high, std::uint32_t low) {
+		constexpr int kBits {std::numeric_limits<FloatType>::digits};
+		const std::uint64_t bits {((std::uint64_t {high} << 32) | low) >> (64 - kBits)};
+		return static_cast<FloatType>(bits) * (FloatType {1} / static_cast<FloatType>(std::uint64_t {1} << kBits));
+	}
+
+private:
+	static constexpr std::uint32_t kMultiplier0 {0xD2511F53};
+	static constexpr std::uint32_t kMultiplier1 {0xCD9E8D57};
+	static constexpr std::uint32_t kWeyl0 {0x9E3779B9};
+	static constexpr std::uint32_t kWeyl1 {0xBB67AE85};
+
+	std::uint64_t m_key;
+	std::uint64_t m_stream;
+	std::uint64_t m_position {0};
+	Block m_block {};
+	int m_index {4};
+};
+
+} // namespace simulation
+
+#endif // SIMULATION_PHILOXENGINE_H
@@ -0,0 +1,241 @@
+#ifndef SIMULATION_REPLAYSOURCE_H
+#define SIMULATION_REPLAYSOURCE_H
+
+#include <cassert>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <string>
+#include <sys/mman.h>
+
+#include "common/AmbientScope.h"
+#include "common/MappedFile.h"
+
+namespace simulation {
+
+/*
+ * Replay of pre-generated randomness from a memory-mapped entropy file, so that runs can be
+ * repeated bit for bit and the kernels timed without any RNG cost.  An entropy file holds either
+ * 32-bit random words, which ReplayEngine hands out in place of a live engine's output (every
+ * simulation takes an Engine), or coordinates in [1, 2], which ReplaySampleSource hands out in
+ * place, without copying or converting anything.
+ *
+ * The stream is ambient (common/AmbientScope.h): the harness gives every worker its own stretch of
+ * the file, and all engines and sources of a worker read it one after the other, in the order they
+ * draw.
+ */
+
+/**
+ * Header of an entropy file, in native byte order, padded to kDataStart bytes.
+ */
+struct EntropyFileHeader {
+	enum class Kind : std::uint32_t { Words = 1, Coordinates = 2 };
+
+	static constexpr char kMagic[8] {'E', 'N', 'T', 'R', 'O', 'P', 'Y', '\0'};
+	static constexpr std::uint32_t kVersion {1};
+	static constexpr std::uint64_t kDataStart {4096};
+
+	char magic[8] {};
+	std::uint32_t version {kVersion};
+	Kind kind {Kind::Words};
+	std::uint32_t valueBytes {0};   // 4 for words, 4 or 8 for coordinates
+	std::uint32_t reserved {0};
+	std::uint64_t count {0};        // values
+	std::uint64_t dataStart {kDataStart};
+	std::uint64_t seed {0};         // of the generator that wrote the file
+	char padding[16] {};
+
+	static EntropyFileHeader make(Kind kind, std::uint32_t valueBytes, std::uint64_t count, std::uint64_t seed) {
+		EntropyFileHeader header {};
+		std::memcpy(header.magic, kMagic, sizeof(kMagic));
+		header.kind = kind;
+		header.valueBytes = valueBytes;
+		header.count = count;
+		header.seed = seed;
+		return header;
+	}
+
+	std::uint64_t getFileSize() const {
+		return dataStart + count * valueBytes;
+	}
+};
+
+static_assert(sizeof(EntropyFileHeader) == 64);
+
+/**
+ * An entropy file mapped into memory, read only.
+ */
+class EntropyFile {
+public:
+	explicit EntropyFile(const std::string& path) :
+		m_file {path}
+	{
+		if (!m_file.isOpen()) {
+			m_error = m_file.getError();
+			return;
+		}
+		if (m_file.size() < EntropyFileHeader::kDataStart) {
+			m_error = path + ": too short for an entropy file";
+			return;
+		}
+		std::memcpy(&m_header, m_file.data(), sizeof(m_header));
+		if (std::memcmp(m_header.magic, EntropyFileHeader::kMagic, sizeof(m_header.magic)) != 0) {
+			m_error = path + ": not an entropy file";
+		} else if (m_header.version != EntropyFileHeader::kVersion) {
+			m_error = path + ": unsupported version " + std::to_string(m_header.version);
+		} else if (m_header.getFileSize() > m_file.size()) {
+			m_error = path + ": truncated";
+		} else if (m_header.count == 0) {
+			m_error = path + ": no values";
+		}
+		if (m_error.empty()) {
+			m_file.advise(MADV_SEQUENTIAL);
+		}
+	}
+
+	bool isOpen() const {
+		return m_error.empty();
+	}
+
+	const std::string& getError() const {
+		return m_error;
+	}
+
+	const EntropyFileHeader& getHeader() const {
+		return m_header;
+	}
+
+	const std::byte* getValues() const {
+		return m_file.data() + m_header.dataStart;
+	}
+
+private:
+	MappedFile m_file;
+	EntropyFileHeader m_header {};
+	std::string m_error {};
+};
+
+/**
+ * A thread's read position in an entropy file.  At the end it starts over from the beginning, so a
+ * run never fails for want of entropy; getTaken() tells whether it read further than it should have.
+ */
+class ReplayStream {
+public:
+	/**
+	 * @param first Value to start at, e.g. a worker's share of the file.
+	 */
+	ReplayStream(const EntropyFile& file, std::uint64_t first = 0) :
+		m_values {file.getValues()},
+		m_valueBytes {file.getHeader().valueBytes},
+		m_count {file.getHeader().count},
+		m_position {first % file.getHeader().count}
+	{}
+
+	/**
+	 * @return count consecutive values, wrapping around first if fewer than count are left.
+	 */
+	template <typename T>
+	const T* take(std::uint64_t count) {
+		assert(sizeof(T) == m_valueBytes && "Value type does not match the entropy file.");
+		assert(count <= m_count && "Entropy file too small for one sample.");
+		if (m_position + count > m_count) {
+			m_position = 0;
+		}
+		const T* values {reinterpret_cast<const T*>(m_values + m_position * sizeof(T))};
+		m_position += count;
+		m_taken += count;
+		return values;
+	}
+
+	/**
+	 * @return Values handed out so far.
+	 */
+	std::uint64_t getTaken() const {
+		return m_taken;
+	}
+
+	/**
+	 * @return The calling thread's stream, nullptr if it has none.
+	 */
+	static ReplayStream* get() {
+		return ThreadLocalSlot<ReplayStream>::get();
+	}
+
+	/**
+	 * Makes a stream the calling thread's until the end of the scope.
+	 */
+	using Scope = AmbientScope<ReplayStream>;
+
+private:
+	const std::byte* m_values;
+	std::uint32_t m_valueBytes;
+	std::uint64_t m_count;
+	std::uint64_t m_position;
+	std::uint64_t m_taken {0};
+};
+
+/**
+ * Random engine that replays the 32-bit words of the constructing thread's stream, a drop-in for
+ * std::mt19937 wherever a simulation takes an Engine.  The seed is ignored: the stream decides.
+ */
+class ReplayEngine {
+public:
+	using result_type = std::uint32_t;
+
+	explicit ReplayEngine(result_type = 0) :
+		m_stream {ReplayStream::get()}
+	{
+		assert(m_stream && "ReplayEngine needs a ReplayStream on the constructing thread.");
+	}
+
+	static constexpr result_type min() {
+		return 0;
+	}
+
+	static constexpr result_type max() {
+		return std::numeric_limits<result_type>::max();
+	}
+
+	result_type operator()() {
+		return *m_stream->take<result_type>(1);
+	}
+
+private:
+	ReplayStream* m_stream;
+};
+
+/**
+ * Sample source that hands out the coordinates of the constructing thread's stream in place: each
+ * point is the next dimension() values of the file, which must hold FloatType coordinates in [1, 2].
+ */
+template <std::floating_point FloatType>
+class ReplaySampleSource {
+public:
+	/**
+	 * @param dimension Number of coordinates per sample point.
+	 */
+	explicit ReplaySampleSource(int dimension, std::uint32_t = 0) :
+		m_dimension {dimension},
+		m_stream {ReplayStream::get()}
+	{
+		assert(m_stream && "ReplaySampleSource needs a ReplayStream on the constructing thread.");
+	}
+
+	int dimension() const {
+		return m_dimension;
+	}
+
+	const FloatType* next() {
+		return m_stream->take<FloatType>(static_cast<std::uint64_t>(m_dimension));
+	}
+
+private:
+	int m_dimension;
+	ReplayStream* m_stream;
+};
+
+} // namespace simulation
+
+#endif // SIMULATION_REPLAYSOURCE_H
@@ -0,0 +1,102 @@
+#ifndef SIMULATION_RINGSAMPLESOURCE_H
+#define SIMULATION_RINGSAMPLESOURCE_H
+
+#include <cassert>
+#include <concepts>
+#include <random>
+
+#include "common/PhaseProfiler.h"
+#include "common/SpscRing.h"
+
+namespace simulation {
+
+/**
+ * Sample source fed by a producer thread through an SpscRing of uniform [1, 2] coordinates.
+ * Sample points are handed out in place from the current block; the coordinates at the end of a
+ * block that do not make up a whole point are skipped.
+ */
+template <std::floating_point FloatType>
+class RingSampleSource {
+public:
+	/**
+	 * @param dimension Number of coordinates per sample point.
+	 * @param ring Ring filled by produceUniformBlocks(), must outlive the source.
+	 */
+	RingSampleSource(int dimension, SpscRing<FloatType>& ring) :
+		m_ring {&ring},
+		m_dimension {dimension},
+		m_pointsPerBlock {static_cast<int>(ring.getBlockSize()) / dimension}
+	{
+		assert(m_pointsPerBlock > 0 && "Ring blocks must hold at least one sample point.");
+	}
+
+	RingSampleSource(RingSampleSource&& other) noexcept :
+		m_ring {other.m_ring},
+		m_dimension {other.m_dimension},
+		m_pointsPerBlock {other.m_pointsPerBlock},
+		m_block {other.m_block},
+		m_pointsLeft {other.m_pointsLeft}
+	{
+		other.m_block = nullptr;
+	}
+
+	~RingSampleSource() {
+		if (m_block) {
+			m_ring->releaseRead();
+		}
+	}
+
+	int dimension() const {
+		return m_dimension;
+	}
+
+	const FloatType* next() {
+		if (m_pointsLeft == 0) {
+			PROFILE_PHASE("ring_wait");
+			if (m_block) {
+				m_ring->releaseRead();
+			}
+			while (!(m_block = m_ring->tryAcquireRead())) {
+				SpscRing<FloatType>::relax();
+			}
+			m_pointsLeft = m_pointsPerBlock;
+		}
+		const FloatType* point {m_block + (m_pointsPerBlock - m_pointsLeft) * m_dimension};
+		m_pointsLeft--;
+		return point;
+	}
+
+private:
+	SpscRing<FloatType>* m_ring;
+	int m_dimension;
+	int m_pointsPerBlock;
+	const FloatType* m_block {nullptr};
+	int m_pointsLeft {0};
+};
+
+/**
+ * Producer loop: fills ring blocks with uniform [1, 2] coordinates until the ring is closed.
+ * @param ring The ring to fill.
+ * @param seed Seed for the producer's engine.
+ */
+template <std::floating_point FloatType, typename Engine = std::mt19937>
+void produceUniformBlocks(SpscRing<FloatType>& ring, typename Engine::result_type seed = std::random_device{}()) {
+	Engine engine {seed};
+	std::uniform_real_distribution<FloatType> dist {1.0, 2.0};
+	const std::size_t blockSize {ring.getBlockSize()};
+	while (!ring.isClosed()) {
+		FloatType* block {ring.tryAcquireWrite()};
+		if (!block) {
+			SpscRing<FloatType>::relax();
+			continue;
+		}
+		for (std::size_t i {0}; i < blockSize; i++) {
+			block[i] = dist(engine);
+		}
+		ring.commitWrite();
+	}
+}
+
+} // namespace simulation
+
+#endif // SIMULATION_RINGSAMPLESOURCE_H
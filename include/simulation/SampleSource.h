@@ -0,0 +1,62 @@
+#ifndef SIMULATION_SAMPLESOURCE_H
+#define SIMULATION_SAMPLESOURCE_H
+
+#include <concepts>
+#include <memory_resource>
+#include <random>
+#include <vector>
+
+#include "common/MemoryResource.h"
+#include "common/PhaseProfiler.h"
+#include "simulation/SeedSource.h"
+
+namespace simulation {
+
+/**
+ * A source of sample points for the simulations.
+ * Each call to next() yields one point of dimension() coordinates, each in [1, 2].  For polygon
+ * simulations a point holds the interleaved vertex coordinates {x0, y0, x1, y1, ...}.
+ * The returned pointer is only valid until the next call to next().
+ */
+template <typename Source, typename FloatType>
+concept SampleSource = std::floating_point<FloatType> && requires(Source& source) {
+	{ source.next() } -> std::same_as<const FloatType*>;
+	{ source.dimension() } -> std::convertible_to<int>;
+};
+
+/**
+ * Plain Monte Carlo sample source: every coordinate is an independent uniform draw on [1, 2].
+ */
+template <std::floating_point FloatType, typename Engine = std::mt19937>
+class UniformSampleSource {
+public:
+	/**
+	 * @param dimension Number of coordinates per sample point.
+	 * @param seed Seed for the underlying engine, by default from the thread's seed source (SeedSource.h).
+	 */
+	explicit UniformSampleSource(int dimension, typename Engine::result_type seed = drawSeed()) :
+		m_engine {seed},
+		m_point(dimension, ThreadMemoryResource::get())
+	{}
+
+	int dimension() const {
+		return static_cast<int>(m_point.size());
+	}
+
+	const FloatType* next() {
+		PROFILE_PHASE("rng");
+		for (auto& coord : m_point) {
+			coord = m_dist(m_engine);
+		}
+		return m_point.data();
+	}
+
+private:
+	Engine m_engine;
+	std::uniform_real_distribution<FloatType> m_dist {1.0, 2.0};
+	std::pmr::vector<FloatType> m_point;
+};
+
+} // namespace simulation
+
+#endif // SIMULATION_SAMPLESOURCE_H
@@ -0,0 +1,61 @@
+#ifndef SIMULATION_SEEDSOURCE_H
+#define SIMULATION_SEEDSOURCE_H
+
+#include <cstdint>
+#include <random>
+
+#include "common/AmbientScope.h"
+
+namespace simulation {
+
+/**
+ * Where the sample sources draw their default seeds from, an ambient one per thread
+ * (common/AmbientScope.h): without one every source seeds itself from std::random_device, with one
+ * the seeds follow from a single job seed, so that a run can be repeated without any simulation
+ * knowing about seeds.
+ */
+class SeedSource {
+public:
+	/**
+	 * @param seed Seed of the job.
+	 * @param stream Which of the job's independent streams, e.g. its slice of the runs.
+	 */
+	SeedSource(std::uint64_t seed, std::uint64_t stream) {
+		std::seed_seq sequence {static_cast<std::uint32_t>(seed), static_cast<std::uint32_t>(seed >> 32),
+			static_cast<std::uint32_t>(stream), static_cast<std::uint32_t>(stream >> 32)};
+		m_engine.seed(sequence);
+	}
+
+	std::uint32_t next() {
+		return static_cast<std::uint32_t>(m_engine());
+	}
+
+	/**
+	 * @return The calling thread's seed source, nullptr if it has none.
+	 */
+	static SeedSource* get() {
+		return ThreadLocalSlot<SeedSource>::get();
+	}
+
+	/**
+	 * Makes a seed source the calling thread's until the end of the scope.
+	 */
+	using Scope = AmbientScope<SeedSource>;
+
+private:
+	std::mt19937 m_engine {};
+};
+
+/**
+ * @return The next seed of the calling thread's seed source, or a fresh one from std::random_device.
+ */
+inline std::uint32_t drawSeed() {
+	if (SeedSource* source {SeedSource::get()}) {
+		return source->next();
+	}
+	return std::random_device {}();
+}
+
+} // namespace simulation
+
+#endif // SIMULATION_SEEDSOURCE_H
@@ -0,0 +1,81 @@
+#ifndef SIMULATION_SIMULATION_H
+#define SIMULATION_SIMULATION_H
+
+#include <cassert>
+#include <concepts>
+#include <utility>
+
+#include "simulation/Accumulators.h"
+#include "simulation/ISimulation.h"
+#include "simulation/Kernels.h"
+#include "simulation/Layouts.h"
+#include "simulation/SampleSource.h"
+
+namespace simulation {
+
+/**
+ * A simulation composed from policies, resolved at compile time:
+ * - Source      where the points come from (SampleSource.h, SobolSampleSource.h, SlidingWindowSampleSource.h, ...),
+ * - Layout      how they are arranged and fed to the kernel (Layouts.h),
+ * - Kernel      the area ratio of one polygon (Kernels.h),
+ * - Accumulator what is kept of the ratios (Accumulators.h).
+ * The harness simulations are aliases of this template; any other combination, e.g. the triangle
+ * kernel on the column layout, needs no code of its own.
+ */
+template <std::floating_point FloatType, typename Source, typename Layout, typename Kernel, typename Accumulator = SumAccumulator<FloatType>>
+	requires SampleSource<Source, FloatType>
+class Simulation : public ISimulation<FloatType> {
+public:
+
+	/**
+	 * Builds the source the layout asks for, of the dimension the kernel needs.
+	 */
+	Simulation(int runCount, int polygonPointCount = 3) :
+		Simulation(runCount, polygonPointCount, Layout::template makeSource<Source>(Kernel::dimension(polygonPointCount)))
+	{}
+
+	/**
+	 * @param source Source of Kernel::dimension(polygonPointCount) dimensional points, for sources that need more than a dimension.
+	 * @param accumulator Accumulator, for accumulators that need parameters.
+	 */
+	Simulation(int runCount, int polygonPointCount, Source source, Accumulator accumulator = {}) :
+		ISimulation<FloatType>(runCount, polygonPointCount),
+		m_source {std::move(source)},
+		m_accumulator {std::move(accumulator)}
+	{
+		assert(Kernel::supports(polygonPointCount) && "The kernel does not support this number of points.");
+		assert(m_source.dimension() == Kernel::dimension(polygonPointCount) && "Source dimension does not match the kernel.");
+	}
+
+
+	FloatType getAverageRatio() const override {
+		assert(ISimulation<FloatType>::getRunCount() > 0 && "Must run at least once.");
+		return getSumOfRatios() / ISimulation<FloatType>::getRunCount();
+	}
+
+	void prepare() override {
+		m_layout.prepare(ISimulation<FloatType>::getRunCount(), m_source.dimension());
+	}
+
+	void run() override {
+		m_accumulator.reset();
+		m_layout.template run<Kernel>(m_source, m_accumulator, ISimulation<FloatType>::getRunCount(), ISimulation<FloatType>::getPolygonPointCount());
+	}
+
+	FloatType getSumOfRatios() const override {
+		return m_accumulator.getSum();
+	}
+
+	const Accumulator& getAccumulator() const {
+		return m_accumulator;
+	}
+
+private:
+	Source m_source;
+	Layout m_layout {ISimulation<FloatType>::getMemoryResource()};
+	Accumulator m_accumulator;
+};
+
+} // namespace simulation
+
+#endif // SIMULATION_SIMULATION_H
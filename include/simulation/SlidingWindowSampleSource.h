@@ -0,0 +1,120 @@
+#ifndef SIMULATION_SLIDINGWINDOWSAMPLESOURCE_H
+#define SIMULATION_SLIDINGWINDOWSAMPLESOURCE_H
+
+#include <cassert>
+#include <concepts>
+#include <memory_resource>
+#include <random>
+#include <vector>
+
+#include "common/MemoryResource.h"
+#include "common/PhaseProfiler.h"
+#include "simulation/SeedSource.h"
+
+namespace simulation {
+
+/**
+ * Sample source that amortizes random number generation by sliding a window over a stream of
+ * coordinates, as SimulationEugene4 and SimulationEugene5 do: consecutive samples share all but
+ * `stride` of their coordinates.  stride == dimension gives independent samples.
+ *
+ * The stream lives in a ring of capacity C that is mirrored into a second copy right behind it
+ * (every coordinate is written to p and p + C), so any window starting in [0, C) is contiguous in
+ * memory.  Reads need no modulo and no wrap-around branch.
+ *
+ * next() returns a block of windowsPerBlock consecutive windows at once, window j starting at
+ * offset j * stride, so a SIMD kernel can evaluate one window per lane.  With the default of one
+ * window per block this is a plain SampleSource.
+ *
+ * draw() hands out the stream one coordinate at a time instead, for a layout that slides the window
+ * through registers.
+ */
+template <std::floating_point FloatType, typename Engine = std::mt19937>
+class SlidingWindowSampleSource {
+public:
+	/**
+	 * @param dimension Number of coordinates per window (sample point).
+	 * @param stride New coordinates per window, in [1, dimension].
+	 * @param windowsPerBlock Consecutive windows returned by each call to next().
+	 * @param seed Seed for the underlying engine, by default from the thread's seed source (SeedSource.h).
+	 */
+	explicit SlidingWindowSampleSource(int dimension, int stride = 1, int windowsPerBlock = 1,
+			typename Engine::result_type seed = drawSeed()) :
+		m_dimension {dimension},
+		m_stride {stride},
+		m_windowsPerBlock {windowsPerBlock},
+		m_capacity {dimension + (windowsPerBlock - 1) * stride},
+		m_engine {seed},
+		m_buffer(ThreadMemoryResource::get())
+	{
+		assert(stride >= 1 && stride <= dimension && "Stride must be in [1, dimension].");
+		assert(windowsPerBlock >= 1 && "Need at least one window per block.");
+		m_buffer.resize(2 * static_cast<std::size_t>(m_capacity));
+		// the first block needs the whole capacity filled; every later one replaces windowsPerBlock * stride
+		generate(0, m_capacity);
+		m_head = m_capacity - m_windowsPerBlock * m_stride; // so the first next() lands on position 0
+	}
+
+	int dimension() const {
+		return m_dimension;
+	}
+
+	int stride() const {
+		return m_stride;
+	}
+
+	int windowsPerBlock() const {
+		return m_windowsPerBlock;
+	}
+
+	/**
+	 * Slides to the next block of windows.
+	 * @return Pointer to the first window; window j starts at offset j * stride().
+	 */
+	const FloatType* next() {
+		PROFILE_PHASE("rng");
+		const int advance {m_windowsPerBlock * m_stride};
+		if (m_primed) {
+			// the coordinates after the current block overwrite the ones the current block starts with
+			generate(m_head, advance);
+		}
+		m_primed = true;
+		m_head += advance;
+		m_head -= m_capacity * (m_head >= m_capacity);
+		return m_buffer.data() + m_head;
+	}
+
+	/**
+	 * The next coordinate of the stream, for layouts that keep the window in registers themselves
+	 * (RegisterWindowLayout).  A source is read either through next() or through draw(), not both.
+	 */
+	FloatType draw() {
+		return m_dist(m_engine);
+	}
+
+private:
+	int m_dimension;
+	int m_stride;
+	int m_windowsPerBlock;
+	int m_capacity;
+	int m_head {0};
+	bool m_primed {false};
+	Engine m_engine;
+	std::uniform_real_distribution<FloatType> m_dist {1.0, 2.0};
+	std::pmr::vector<FloatType> m_buffer;
+
+	void generate(int position, int count) {
+		FloatType* mirror {m_buffer.data() + m_capacity};
+		for (int i {0}; i < count; i++) {
+			const FloatType coord {m_dist(m_engine)};
+			m_buffer[position] = coord;
+			mirror[position] = coord;
+			position++;
+			position -= m_capacity * (position >= m_capacity);
+		}
+	}
+};
+
+} // namespace simulation
+
+#endif // SIMULATION_SLIDINGWINDOWSAMPLESOURCE_H
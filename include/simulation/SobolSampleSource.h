@@ -0,0 +1,176 @@
+#ifndef SIMULATION_SOBOLSAMPLESOURCE_H
+#define SIMULATION_SOBOLSAMPLESOURCE_H
+
+#include <bit>
+#include <cassert>
+#include <concepts>
+#include <cstdint>
+#include <memory_resource>
+#include <random>
+#include <vector>
+
+#include "common/MemoryResource.h"
+#include "common/PhaseProfiler.h"
+#include "simulation/SeedSource.h"
+
+namespace simulation {
+
+/**
+ * Randomized quasi-Monte Carlo sample source: an Owen-scrambled Sobol sequence over the
+ * dimension()-dimensional unit cube, mapped to [1, 2].
+ *
+ * Every instance draws its own scramble seed, so two sources are independent randomizations of
+ * the same net.  The spread of the estimates obtained from several such replicates is what gives
+ * the error bar; a single replicate carries no usable variance information of its own.
+ *
+ * Direction numbers come from primitive polynomials over GF(2) enumerated at construction, with
+ * initial values drawn from a fixed-seed generator (dimension 0 is the van der Corput sequence).
+ * Nested uniform scrambling is the hash-based variant of Burley (2020).
+ * Convergence is best when the number of points drawn is a power of two.
+ */
+template <std::floating_point FloatType>
+class SobolSampleSource {
+public:
+	static constexpr int kBits {32};
+
+	/**
+	 * @param dimension Number of coordinates per sample point.
+	 * @param seed Scramble seed; distinct seeds give independent randomizations.  By default from the
+	 * thread's seed source (SeedSource.h).
+	 */
+	explicit SobolSampleSource(int dimension, std::uint32_t seed = drawSeed()) :
+		m_directions(static_cast<std::size_t>(dimension) * kBits, ThreadMemoryResource::get()),
+		m_state(dimension, 0, ThreadMemoryResource::get()),
+		m_seeds(dimension, ThreadMemoryResource::get()),
+		m_point(dimension, ThreadMemoryResource::get())
+	{
+		assert(dimension > 0 && "Sobol sequence needs at least one dimension.");
+		initDirections(dimension);
+		for (int j {0}; j < dimension; j++) {
+			m_seeds[j] = hash(seed ^ hash(static_cast<std::uint32_t>(j) + 0x9e3779b9u));
+		}
+	}
+
+	int dimension() const {
+		return static_cast<int>(m_point.size());
+	}
+
+	const FloatType* next() {
+		PROFILE_PHASE("qrng");
+		// Gray code order: going from index k-1 to k flips the direction number of the lowest set bit of k
+		if (m_index != 0) {
+			const std::uint32_t* directions {m_directions.data() + std::countr_zero(m_index)};
+			for (std::size_t j {0}; j < m_state.size(); j++) {
+				m_state[j] ^= directions[j * kBits];
+			}
+		}
+		m_index++;
+
+		constexpr FloatType scale {static_cast<FloatType>(1.0) / static_cast<FloatType>(4294967296.0)};
+		for (std::size_t j {0}; j < m_state.size(); j++) {
+			const std::uint32_t scrambled {nestedUniformScramble(m_state[j], m_seeds[j])};
+			m_point[j] = static_cast<FloatType>(1.0) + (static_cast<FloatType>(scrambled) + static_cast<FloatType>(0.5)) * scale;
+		}
+		return m_point.data();
+	}
+
+private:
+	std::pmr::vector<std::uint32_t> m_directions; // kBits direction numbers per dimension
+	std::pmr::vector<std::uint32_t> m_state;      // unscrambled current point
+	std::pmr::vector<std::uint32_t> m_seeds;      // per-dimension scramble seeds
+	std::pmr::vector<FloatType> m_point;
+	std::uint32_t m_index {0};
+
+	static std::uint32_t hash(std::uint32_t x) {
+		x ^= x >> 16;
+		x *= 0x21f0aaadu;
+		x ^= x >> 15;
+		x *= 0xd35a2d97u;
+		x ^= x >> 15;
+		return x;
+	}
+
+	static std::uint32_t laineKarrasPermutation(std::uint32_t x, std::uint32_t seed) {
+		x += seed;
+		x ^= x * 0x6c50b47cu;
+		x ^= x * 0xb82f1e52u;
+		x ^= x * 0xc7afe638u;
+		x ^= x * 0x8d22f6e6u;
+		return x;
+	}
+
+	static std::uint32_t reverseBits(std::uint32_t x) {
+		x = ((x >> 1) & 0x55555555u) | ((x & 0x55555555u) << 1);
+		x = ((x >> 2) & 0x33333333u) | ((x & 0x33333333u) << 2);
+		x = ((x >> 4) & 0x0f0f0f0fu) | ((x & 0x0f0f0f0fu) << 4);
+		x = ((x >> 8) & 0x00ff00ffu) | ((x & 0x00ff00ffu) << 8);
+		return (x >> 16) | (x << 16);
+	}
+
+	static std::uint32_t nestedUniformScramble(std::uint32_t x, std::uint32_t seed) {
+		return reverseBits(laineKarrasPermutation(reverseBits(x), seed));
+	}
+
+	/**
+	 * Checks whether the polynomial (bit k holds the coefficient of x^k) of the given degree is
+	 * primitive over GF(2), i.e. x has multiplicative order exactly 2^degree - 1 modulo it.
+	 */
+	static bool isPrimitive(std::uint32_t polynomial, int degree) {
+		const std::uint32_t period {(1u << degree) - 1};
+		std::uint32_t power {1};
+		for (std::uint32_t k {1}; k <= period; k++) {
+			power <<= 1;
+			if (power & (1u << degree)) {
+				power ^= polynomial;
+			}
+			if (power == 1) {
+				return k == period;
+			}
+		}
+		return false;
+	}
+
+	void initDirections(int dimension) {
+		// dimension 0: van der Corput
+		for (int i {0}; i < kBits; i++) {
+			m_directions[i] = 1u << (kBits - 1 - i);
+		}
+
+		std::mt19937 initialValues {0x50b01u};
+		int degree {1};
+		std::uint32_t tail {0}; // the middle coefficients a_1 .. a_{degree-1}
+		for (int j {1}; j < dimension; j++) {
+			// next primitive polynomial, in order of degree and then coefficients
+			std::uint32_t polynomial {};
+			while (true) {
+				if (tail >= (1u << (degree - 1))) {
+					degree++;
+					tail = 0;
+				}
+				polynomial = (1u << degree) | (tail << 1) | 1u;
+				tail++;
+				if (isPrimitive(polynomial, degree)) {
+					break;
+				}
+			}
+			const std::uint32_t a {(polynomial >> 1) & ((1u << (degree - 1)) - 1)};
+
+			std::uint32_t* v {m_directions.data() + static_cast<std::size_t>(j) * kBits};
+			for (int i {0}; i < degree && i < kBits; i++) {
+				// odd m_i < 2^(i+1)
+				const std::uint32_t m {(static_cast<std::uint32_t>(initialValues()) & ((2u << i) - 1)) | 1u};
+				v[i] = m << (kBits - 1 - i);
+			}
+			for (int i {degree}; i < kBits; i++) {
+				v[i] = v[i - degree] ^ (v[i - degree] >> degree);
+				for (int k {1}; k < degree; k++) {
+					v[i] ^= ((a >> (degree - 1 - k)) & 1u) * v[i - k];
+				}
+			}
+		}
+	}
+};
+
+} // namespace simulation
+
+#endif // SIMULATION_SOBOLSAMPLESOURCE_H